@@ -0,0 +1,134 @@
+#include "batch.hpp"
+#include "input.hpp"
+#include "solver.hpp"
+#include "trace.hpp"
+#include "utility.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::literals::string_view_literals::operator""sv;
+
+static constexpr auto usage =
+    "Usage: sudoku_bench [options] <file>\n"
+    "\n"
+    "Solves every puzzle in <file> with each backend, and with the hybrid\n"
+    "backend once more in SIMD lanes, and reports the best\n"
+    "throughput out of all repetitions.\n"
+    "\n"
+    "Options:\n"
+    "  --repeat <n>        Repetitions per backend (default 5)\n"
+    "  --threads <n>       Worker threads, 0 for one per hardware thread (default 1)\n"
+    "  --perf-counters     Also report hardware counters per puzzle and phase\n"sv;
+
+struct bench_options {
+    std::string_view input;
+    unsigned repeat = 5;
+    unsigned threads = 1;
+    bool perf_counters = false;
+};
+
+static auto parse_arguments(int argc, char const** argv) -> std::optional<bench_options> {
+    auto result = bench_options();
+
+    for (int i = 1; i < argc; ++i) {
+        auto const arg = std::string_view(argv[i]);
+
+        if ((arg == "--repeat"sv || arg == "--threads"sv) && i + 1 < argc) {
+            auto const value = solve::util::parse_number<unsigned>(argv[++i]);
+            if (!value.has_value()) {
+                return std::nullopt;
+            }
+
+            (arg == "--repeat"sv ? result.repeat : result.threads) = *value;
+        } else if (arg == "--perf-counters"sv) {
+            result.perf_counters = true;
+        } else if (arg.empty() || arg[0] == '-' || !result.input.empty()) {
+            return std::nullopt;
+        } else {
+            result.input = arg;
+        }
+    }
+
+    if (result.input.empty() || result.repeat == 0) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+struct configuration {
+    std::string_view name;
+    solve::backend engine;
+    bool lanes;
+};
+
+static constexpr configuration configurations[] = {
+    {"dancing_links"sv, solve::backend::dancing_links, false},
+    {"hybrid"sv, solve::backend::hybrid, false},
+    {"hybrid+lanes"sv, solve::backend::hybrid, true},
+};
+
+auto main(int argc, char const** argv) -> int {
+    auto const options = parse_arguments(argc, argv);
+
+    if (!options.has_value()) {
+        fmt::print(stderr, "{}", usage);
+        return 1;
+    }
+
+    auto result = solve::read_from_file(options->input);
+
+    if (!result.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", std::move(result).error());
+        return 1;
+    }
+
+    auto const puzzles = std::move(result).value();
+    auto solutions = std::vector<solve::sudoku>(puzzles.size());
+
+    if (options->perf_counters) {
+        solve::trace::enable_counters();
+    }
+
+    fmt::print("{} puzzles, {} repetitions, {} threads\n",
+            puzzles.size(), options->repeat, options->threads);
+
+    for (auto const& config : configurations) {
+        auto batch_options = solve::batch_options();
+        batch_options.thread_count = options->threads;
+        batch_options.engine = config.engine;
+        // Lanes on for any batch size, or not at all.
+        batch_options.lane_threshold = config.lanes ? 1 : 0;
+
+        auto best = 0.0;
+        auto solved = std::size_t{0};
+
+        solve::trace::reset_counters();
+
+        for (unsigned run = 0; run < options->repeat; ++run) {
+            auto const start = std::chrono::steady_clock::now();
+            solved = solve::solve_batch(puzzles, solutions, batch_options);
+            auto const seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+
+        fmt::print("{:<14} {:>10.0f} puzzles/s  {:>8.2f} us/puzzle  ({} solved)\n",
+                config.name, best > 0 ? puzzles.size() / best : 0.0,
+                puzzles.empty() ? 0.0 : best * 1e6 / puzzles.size(), solved);
+
+        if (options->perf_counters) {
+            fmt::print("{}\n", solve::trace::format_counter_report(
+                        solve::trace::collect_counters()));
+        }
+    }
+}
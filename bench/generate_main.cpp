@@ -0,0 +1,166 @@
+#include "file_io.hpp"
+#include "utility.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using std::literals::string_view_literals::operator""sv;
+
+static constexpr auto usage =
+    "Usage: sudoku_generate [options]\n"
+    "\n"
+    "Writes random puzzles, one per line. Each one is a shuffled solution grid\n"
+    "with a random number of givens left in, so the output mixes puzzles that\n"
+    "fall to singles with ones that need a long search. Every puzzle has at\n"
+    "least one solution, but not necessarily exactly one.\n"
+    "\n"
+    "Options:\n"
+    "  -o <file>           Write to <file> instead of stdout\n"
+    "  --count <n>         Number of puzzles (default 100000)\n"
+    "  --seed <n>          Seed for the random number generator (default 1)\n"
+    "  --givens <a>-<b>    Range of givens per puzzle (default 22-50)\n"sv;
+
+struct generate_options {
+    std::optional<std::string_view> output;
+    std::uint64_t count = 100000;
+    std::uint64_t seed = 1;
+    unsigned min_givens = 22;
+    unsigned max_givens = 50;
+};
+
+static auto parse_arguments(int argc, char const** argv) -> std::optional<generate_options> {
+    auto result = generate_options();
+
+    for (int i = 1; i < argc; ++i) {
+        auto const arg = std::string_view(argv[i]);
+
+        if (i + 1 >= argc) {
+            return std::nullopt;
+        }
+
+        auto const value = std::string_view(argv[++i]);
+
+        if (arg == "-o"sv) {
+            result.output = value;
+        } else if (arg == "--count"sv || arg == "--seed"sv) {
+            auto const number = solve::util::parse_number<std::uint64_t>(value);
+            if (!number.has_value()) {
+                return std::nullopt;
+            }
+
+            (arg == "--count"sv ? result.count : result.seed) = *number;
+        } else if (arg == "--givens"sv) {
+            auto const dash = value.find('-');
+            auto const low = solve::util::parse_number<unsigned>(value.substr(0, dash));
+            auto const high = dash == std::string_view::npos ? low
+                : solve::util::parse_number<unsigned>(value.substr(dash + 1));
+
+            if (!low.has_value() || !high.has_value() || *low > *high || *high > 81) {
+                return std::nullopt;
+            }
+
+            result.min_givens = *low;
+            result.max_givens = *high;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    return result;
+}
+
+// A random solution grid: a fixed valid grid with its digits relabeled, rows
+// shuffled within bands, bands shuffled, columns and stacks likewise, and
+// transposed half of the time. All of these keep the grid valid.
+template <typename Random>
+static auto random_grid(Random& random) -> std::array<char, 81> {
+    auto shuffled = [&random] {
+        auto result = std::array<unsigned, 9>();
+        auto groups = std::array<unsigned, 3>{0, 1, 2};
+        std::shuffle(groups.begin(), groups.end(), random);
+
+        for (unsigned group = 0; group < 3; ++group) {
+            auto within = std::array<unsigned, 3>{0, 1, 2};
+            std::shuffle(within.begin(), within.end(), random);
+
+            for (unsigned i = 0; i < 3; ++i) {
+                result[3 * group + i] = 3 * groups[group] + within[i];
+            }
+        }
+
+        return result;
+    };
+
+    auto digits = std::array<char, 9>();
+    std::iota(digits.begin(), digits.end(), '1');
+    std::shuffle(digits.begin(), digits.end(), random);
+
+    auto const rows = shuffled();
+    auto const columns = shuffled();
+    auto const transpose = (random() & 1) != 0;
+
+    auto grid = std::array<char, 81>();
+    for (unsigned y = 0; y < 9; ++y) {
+        for (unsigned x = 0; x < 9; ++x) {
+            auto const r = transpose ? columns[x] : rows[y];
+            auto const c = transpose ? rows[y] : columns[x];
+            grid[x + 9 * y] = digits[(r * 3 + r / 3 + c) % 9];
+        }
+    }
+
+    return grid;
+}
+
+auto main(int argc, char const** argv) -> int {
+    auto const options = parse_arguments(argc, argv);
+
+    if (!options.has_value()) {
+        fmt::print(stderr, "{}", usage);
+        return 1;
+    }
+
+    auto writer = options->output.has_value()
+        ? solve::file_writer::open(std::string(*options->output))
+        : solve::file_writer::standard_output();
+
+    if (!writer.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", std::move(writer).error());
+        return 1;
+    }
+
+    auto random = std::mt19937_64(options->seed);
+    auto givens = std::uniform_int_distribution<unsigned>(options->min_givens,
+            options->max_givens);
+    auto cells = std::array<unsigned, 81>();
+    auto line = std::string(82, '\n');
+
+    for (std::uint64_t i = 0; i < options->count; ++i) {
+        auto const grid = random_grid(random);
+        std::iota(cells.begin(), cells.end(), 0u);
+        std::shuffle(cells.begin(), cells.end(), random);
+
+        std::fill(line.begin(), line.begin() + 81, '.');
+        for (unsigned k = 0, n = givens(random); k < n; ++k) {
+            line[cells[k]] = grid[cells[k]];
+        }
+
+        if (auto written = writer->write(line); !written.has_value()) {
+            fmt::print(stderr, "An error occured:\n{}", std::move(written).error());
+            return 1;
+        }
+    }
+
+    if (auto flushed = writer->flush(); !flushed.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", std::move(flushed).error());
+        return 1;
+    }
+}
@@ -0,0 +1,105 @@
+# Profile-guided optimization.
+#
+# PGO=Generate builds instrumented binaries that write profiles to
+# PGO_PROFILE_DIR when they exit, PGO=Use builds with whatever profiles were
+# collected there. With GCC, profiles are matched up by object file path, so
+# both stages have to happen in the same build directory. Clang profiles are
+# merged into a single default.profdata with llvm-profdata first.
+#
+# The pgo target runs all of this in a separate build tree under
+# <build_dir>/pgo: it builds the instrumented stage, trains it on a generated
+# corpus, then reconfigures the same tree for the optimized stage.
+# pgo_compare benchmarks that against the regular build.
+
+set(PGO "Off" CACHE STRING "Profile-guided optimization stage: Off, Generate or Use")
+set_property(CACHE PGO PROPERTY STRINGS Off Generate Use)
+set(PGO_PROFILE_DIR ${CMAKE_BINARY_DIR}/pgo-profile CACHE PATH
+    "Directory profiles are written to and read from")
+
+if(CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+    get_filename_component(_pgo_compiler_dir ${CMAKE_CXX_COMPILER} DIRECTORY)
+    string(REGEX MATCH "^[0-9]+" _pgo_clang_major ${CMAKE_CXX_COMPILER_VERSION})
+    find_program(LLVM_PROFDATA
+        NAMES llvm-profdata-${_pgo_clang_major} llvm-profdata
+        HINTS ${_pgo_compiler_dir})
+endif()
+
+if(PGO STREQUAL "Generate")
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        # Workers update the counters concurrently.
+        set(_pgo_flags -fprofile-generate=${PGO_PROFILE_DIR} -fprofile-update=prefer-atomic)
+    elseif(CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+        set(_pgo_flags -fprofile-generate=${PGO_PROFILE_DIR})
+    else()
+        message(FATAL_ERROR "PGO is only supported with GCC and Clang.")
+    endif()
+elseif(PGO STREQUAL "Use")
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        # Code that never ran during training, like the error paths, has no
+        # profile and is optimized as usual.
+        set(_pgo_flags -fprofile-use=${PGO_PROFILE_DIR} -fprofile-correction
+            -Wno-missing-profile)
+    elseif(CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+        if(NOT EXISTS ${PGO_PROFILE_DIR}/default.profdata)
+            message(FATAL_ERROR "No ${PGO_PROFILE_DIR}/default.profdata, merge the "
+                "profiles with llvm-profdata first.")
+        endif()
+
+        set(_pgo_flags -fprofile-use=${PGO_PROFILE_DIR}/default.profdata
+            -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date)
+    else()
+        message(FATAL_ERROR "PGO is only supported with GCC and Clang.")
+    endif()
+elseif(NOT PGO STREQUAL "Off")
+    message(FATAL_ERROR "PGO must be Off, Generate or Use, not ${PGO}.")
+endif()
+
+if(_pgo_flags)
+    add_compile_options(${_pgo_flags})
+    # The instrumented binaries need the profiling runtime.
+    string(REPLACE ";" " " _pgo_link_flags "${_pgo_flags}")
+    string(APPEND CMAKE_EXE_LINKER_FLAGS " ${_pgo_link_flags}")
+    string(APPEND CMAKE_SHARED_LINKER_FLAGS " ${_pgo_link_flags}")
+endif()
+
+set(PGO_TRAINING_PUZZLES 200000 CACHE STRING "Number of puzzles to train PGO builds on")
+set(_pgo_train_script ${CMAKE_CURRENT_LIST_DIR}/PGOTrain.cmake)
+
+# Called from bench/, which has the generator and the benchmark driver.
+function(ssolve_add_pgo_targets)
+    if(NOT PGO STREQUAL "Off")
+        return()
+    endif()
+
+    set(corpus ${CMAKE_BINARY_DIR}/pgo-training.txt)
+    set(pgo_dir ${CMAKE_BINARY_DIR}/pgo)
+
+    add_custom_command(OUTPUT ${corpus}
+        COMMAND sudoku_generate --count ${PGO_TRAINING_PUZZLES} -o ${corpus}
+        DEPENDS sudoku_generate
+        COMMENT "Generating the PGO training corpus"
+        VERBATIM)
+
+    add_custom_target(pgo
+        COMMAND ${CMAKE_COMMAND}
+            -DSOURCE_DIR=${CMAKE_SOURCE_DIR}
+            -DBINARY_DIR=${pgo_dir}
+            -DCORPUS=${corpus}
+            -DCXX_COMPILER=${CMAKE_CXX_COMPILER}
+            -DCXX_COMPILER_ID=${CMAKE_CXX_COMPILER_ID}
+            -DLLVM_PROFDATA=${LLVM_PROFDATA}
+            -DGENERATOR=${CMAKE_GENERATOR}
+            -P ${_pgo_train_script}
+        DEPENDS ${corpus}
+        COMMENT "Building, training and rebuilding with profile guided optimization"
+        VERBATIM)
+
+    add_custom_target(pgo_compare
+        COMMAND ${CMAKE_COMMAND} -E echo "Regular build:"
+        COMMAND $<TARGET_FILE:sudoku_bench> --threads 0 ${corpus}
+        COMMAND ${CMAKE_COMMAND} -E echo "PGO build:"
+        COMMAND ${pgo_dir}/bin/sudoku_bench --threads 0 ${corpus}
+        DEPENDS pgo sudoku_bench ${corpus}
+        COMMENT "Comparing the regular and the PGO build"
+        VERBATIM)
+endfunction()
@@ -0,0 +1,48 @@
+# Runs the whole PGO cycle in BINARY_DIR, see PGO.cmake. Invoked by the pgo
+# target with SOURCE_DIR, BINARY_DIR, CORPUS, CXX_COMPILER, CXX_COMPILER_ID,
+# LLVM_PROFDATA and GENERATOR set.
+
+set(profile_dir ${BINARY_DIR}/profile)
+
+function(run)
+    execute_process(COMMAND ${ARGV} RESULT_VARIABLE result)
+
+    if(NOT result EQUAL 0)
+        string(REPLACE ";" " " command "${ARGV}")
+        message(FATAL_ERROR "Failed: ${command}")
+    endif()
+endfunction()
+
+function(build stage)
+    message(STATUS "PGO: building the ${stage} stage")
+    run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BINARY_DIR} -G ${GENERATOR}
+        -DCMAKE_BUILD_TYPE=Release
+        -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+        -DBuildBenchmarks=On
+        -DPGO=${stage}
+        -DPGO_PROFILE_DIR=${profile_dir})
+    run(${CMAKE_COMMAND} --build ${BINARY_DIR} --config Release)
+endfunction()
+
+# Stale profiles from an earlier run would be mixed in with the new ones.
+file(REMOVE_RECURSE ${profile_dir})
+build(Generate)
+
+# Trains on what production runs look like: the streaming pipeline on all
+# threads, with the SIMD lanes, the propagation and the search all taking
+# their share of the puzzles.
+message(STATUS "PGO: training on ${CORPUS}")
+run(${BINARY_DIR}/bin/sudoku_solve ${CORPUS} -o ${BINARY_DIR}/pgo-training.out)
+file(REMOVE ${BINARY_DIR}/pgo-training.out)
+
+if(CXX_COMPILER_ID STREQUAL "Clang")
+    if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "llvm-profdata is needed to merge Clang profiles.")
+    endif()
+
+    file(GLOB raw_profiles ${profile_dir}/*.profraw)
+    run(${LLVM_PROFDATA} merge -output=${profile_dir}/default.profdata ${raw_profiles})
+endif()
+
+build(Use)
+message(STATUS "PGO: optimized binaries are in ${BINARY_DIR}/bin")
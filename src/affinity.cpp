@@ -0,0 +1,121 @@
+#include "affinity.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(__linux__)
+// Parses a sysfs CPU list like "0-3,8-11" and records `node` for each CPU
+// in it.
+static void read_node_cpus(unsigned node, std::vector<unsigned>& node_of) {
+    auto const path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    auto* const file = std::fopen(path.c_str(), "r");
+
+    if (file == nullptr) {
+        return;
+    }
+
+    unsigned first = 0;
+    while (std::fscanf(file, "%u", &first) == 1) {
+        auto last = first;
+        auto separator = std::fgetc(file);
+
+        if (separator == '-') {
+            if (std::fscanf(file, "%u", &last) != 1) {
+                break;
+            }
+
+            separator = std::fgetc(file);
+        }
+
+        for (auto cpu = first; cpu <= last && cpu < node_of.size(); ++cpu) {
+            node_of[cpu] = node;
+        }
+
+        if (separator != ',') {
+            break;
+        }
+    }
+
+    std::fclose(file);
+}
+#endif
+
+namespace solve {
+    auto allowed_cpus() -> std::vector<unsigned> {
+        auto cpus = std::vector<unsigned>();
+
+#if defined(__linux__)
+        auto set = cpu_set_t();
+        CPU_ZERO(&set);
+
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            return cpus;
+        }
+
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        // Machines without NUMA have no node directories, and everything
+        // stays on node 0.
+        auto node_of = std::vector<unsigned>(CPU_SETSIZE, 0);
+        for (unsigned node = 0; node < 64; ++node) {
+            read_node_cpus(node, node_of);
+        }
+
+        std::stable_sort(cpus.begin(), cpus.end(), [&node_of] (auto a, auto b) {
+            return node_of[a] < node_of[b];
+        });
+#endif
+
+        return cpus;
+    }
+
+    auto pin_current_thread(util::span<unsigned const> cpus) noexcept -> bool {
+#if defined(__linux__)
+        auto set = cpu_set_t();
+        CPU_ZERO(&set);
+
+        for (auto cpu : cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+
+        return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void) cpus;
+        return false;
+#endif
+    }
+
+    affinity_scope::affinity_scope() {
+#if defined(__linux__)
+        auto set = cpu_set_t();
+        CPU_ZERO(&set);
+
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            return;
+        }
+
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                m_cpus.push_back(cpu);
+            }
+        }
+#endif
+    }
+
+    affinity_scope::~affinity_scope() {
+        if (!m_cpus.empty()) {
+            (void)pin_current_thread(m_cpus);
+        }
+    }
+} /* namespace solve */
@@ -0,0 +1,40 @@
+#ifndef AFFINITY_HPP
+#define AFFINITY_HPP
+
+#include "utility.hpp"
+
+#include <vector>
+
+namespace solve {
+    // The CPUs the calling thread may run on, grouped by NUMA node and
+    // ascending within each node. Consecutive workers pinned in this order
+    // fill up one node before moving on to the next, and splitting the list
+    // into equal slices gives one slice per node on symmetric machines.
+    // Empty where affinity isn't supported.
+    [[nodiscard]] auto allowed_cpus() -> std::vector<unsigned>;
+
+    // Restricts the calling thread to the given CPUs. Threads it starts
+    // afterwards inherit the restriction. Returns false if that's not
+    // possible, in which case nothing changed.
+    auto pin_current_thread(util::span<unsigned const> cpus) noexcept -> bool;
+
+    inline auto pin_current_thread(unsigned cpu) noexcept -> bool {
+        return pin_current_thread(util::span<unsigned const>(&cpu, 1));
+    }
+
+    // Remembers the CPUs the calling thread may run on and gives them back
+    // to it on destruction, for code that pins a thread it doesn't own.
+    class affinity_scope {
+        private:
+        std::vector<unsigned> m_cpus;
+
+        public:
+        affinity_scope();
+        ~affinity_scope();
+
+        affinity_scope(affinity_scope const&) = delete;
+        auto operator=(affinity_scope const&) -> affinity_scope& = delete;
+    };
+} /* namespace solve */
+
+#endif // AFFINITY_HPP
@@ -0,0 +1,448 @@
+#include "affinity.hpp"
+#include "batch.hpp"
+#include "input.hpp"
+#include "lanes.hpp"
+#include "propagation.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Puzzles handed out per grab when scheduling dynamically. Small enough that
+// a run of hard puzzles gets spread over all workers, large enough that the
+// shared cursor doesn't turn into a point of contention. One chunk fills
+// all SIMD lanes.
+static constexpr auto dynamic_chunk_size = std::size_t{solve::lane_width};
+
+[[nodiscard]] static auto resolve_workers(unsigned requested, std::size_t count) noexcept
+    -> unsigned {
+
+    if (requested == 0) {
+        requested = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    return static_cast<unsigned>(std::min<std::size_t>(requested, count));
+}
+
+// Runs `f(worker_index)` on `workers` threads, one of which is the calling
+// thread itself. If starting a thread fails or a worker throws, the first
+// exception is rethrown once every worker that did start is done.
+template <typename Fun>
+static void run_workers(unsigned workers, Fun const& f) {
+    auto failure = std::exception_ptr();
+    auto failure_mutex = std::mutex();
+
+    auto run = [&] (unsigned worker) {
+#if defined(__cpp_exceptions)
+        try {
+            f(worker);
+        } catch (...) {
+            auto const lock = std::lock_guard(failure_mutex);
+            if (failure == nullptr) {
+                failure = std::current_exception();
+            }
+        }
+#else
+        f(worker);
+#endif
+    };
+
+    // A std::thread that is destroyed before it is joined ends the process,
+    // so the threads are joined on the way out no matter what.
+    struct joiner {
+        std::vector<std::thread> threads;
+
+        ~joiner() {
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    } started;
+
+    started.threads.reserve(workers > 1 ? workers - 1 : 0);
+
+    for (unsigned worker = 1; worker < workers; ++worker) {
+        started.threads.emplace_back([&run, worker] {
+            run(worker);
+        });
+    }
+
+    run(0u);
+
+    for (auto& thread : started.threads) {
+        thread.join();
+    }
+
+    started.threads.clear();
+
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// Splits [0, count) into `workers` contiguous ranges and runs
+// `f(begin, end, worker_index)` on each of them in parallel.
+template <typename Fun>
+static void run_partitioned(std::size_t count, unsigned workers, Fun const& f) {
+    if (workers <= 1) {
+        f(std::size_t{0}, count, 0u);
+        return;
+    }
+
+    auto const chunk = count / workers;
+    auto const remainder = count % workers;
+
+    auto range_begin = [chunk, remainder] (unsigned worker) {
+        return worker * chunk + std::min<std::size_t>(worker, remainder);
+    };
+
+    run_workers(workers, [&f, &range_begin] (unsigned worker) {
+        f(range_begin(worker), range_begin(worker + 1), worker);
+    });
+}
+
+// Orders puzzle indices so that the ones which look hardest come first. Ties
+// keep their input order to stay friendly to the caches. Reuses the
+// arena's buffers, which only ever grow.
+[[nodiscard]] static auto schedule_by_difficulty(
+        solve::util::span<solve::sudoku const> puzzles, unsigned workers,
+        solve::solver_arena& arena) -> std::vector<std::size_t> const& {
+
+    auto& estimates = arena.estimates();
+    estimates.resize(puzzles.size());
+
+    run_partitioned(puzzles.size(), workers,
+        [&] (std::size_t begin, std::size_t end, unsigned) {
+            for (auto i = begin; i < end; ++i) {
+                estimates[i] = solve::estimate_difficulty(puzzles[i]);
+            }
+        });
+
+    auto& order = arena.order();
+    order.resize(puzzles.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    // Ties are broken by index by hand, as std::stable_sort would allocate
+    // a buffer of its own.
+    std::sort(order.begin(), order.end(), [&estimates] (auto a, auto b) {
+        return estimates[a] != estimates[b] ? estimates[a] > estimates[b] : a < b;
+    });
+
+    return order;
+}
+
+namespace solve {
+    void solver_arena::reserve(unsigned workers) {
+        if (m_contexts.size() < workers) {
+            m_contexts.resize(workers);
+        }
+    }
+
+    auto solver_arena::context(unsigned worker) -> solver_context& {
+        assert(worker < m_contexts.size() && "Arena has no room for this worker.");
+
+        if (m_contexts[worker] == nullptr) {
+            m_contexts[worker] = std::make_unique<solver_context>();
+        }
+
+        return *m_contexts[worker];
+    }
+
+    auto solve_batch(util::span<sudoku const> puzzles, util::span<sudoku> solutions,
+            batch_options const& options) -> std::size_t {
+
+        assert(solutions.size() == puzzles.size()
+                && "Solution span does not match puzzle span.");
+        assert((options.status.empty() || options.status.size() == puzzles.size())
+                && "Status span does not match puzzle span.");
+        assert((options.items.empty() || options.items.size() == puzzles.size())
+                && "Item span does not match puzzle span.");
+
+        auto const workers = resolve_workers(options.thread_count != 0 ? options.thread_count
+                : static_cast<unsigned>(options.cpus.size()), puzzles.size());
+        auto solved = std::atomic<std::size_t>{0};
+        auto local_arena = solver_arena();
+        auto& arena = options.arena != nullptr ? *options.arena : local_arena;
+        arena.reserve(std::max(workers, 1u));
+
+        // The calling thread doubles as worker 0 and gets the CPUs it ran on
+        // before back once the batch is done, even if it throws.
+        auto restore_affinity = std::optional<affinity_scope>();
+        if (!options.cpus.empty()) {
+            restore_affinity.emplace();
+        }
+
+        // Runs first thing on every worker, so that nothing it allocates is
+        // touched from anywhere else.
+        auto start_worker = [&] (unsigned worker) -> solver_context& {
+            if (!options.cpus.empty()) {
+                pin_current_thread(options.cpus[worker % options.cpus.size()]);
+            }
+
+            trace::set_worker(worker);
+
+            auto& context = arena.context(worker);
+            context.prepare(options.variant);
+            return context;
+        };
+
+        auto latencies = std::vector<latency_histogram>(
+                options.latency != nullptr ? std::max(workers, 1u) : 0);
+
+        auto const use_lanes = options.engine == backend::hybrid
+            && options.lane_threshold != 0 && puzzles.size() >= options.lane_threshold;
+
+        auto now = [&latencies] {
+            return latencies.empty() ? std::chrono::steady_clock::time_point()
+                : std::chrono::steady_clock::now();
+        };
+
+        // Verifies and records the solution already stored for puzzle i.
+        // `elapsed` is the time spent on it before `start`.
+        auto finish = [&] (std::size_t i, unsigned worker,
+                std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::duration elapsed) -> bool {
+
+            auto const ok = verify_sudoku(solutions[i], options.variant);
+
+            if (!options.status.empty()) {
+                options.status[i] = ok ? puzzle_status::ok : puzzle_status::unsolvable;
+            }
+
+            if (!latencies.empty()) {
+                latencies[worker].record(static_cast<std::uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                elapsed + (std::chrono::steady_clock::now() - start)).count()));
+            }
+
+            return ok;
+        };
+
+        // The id puzzle i goes by in the trace.
+        auto item = [&options] (std::size_t i) -> std::uint64_t {
+            return options.first_item + (options.items.empty() ? i : options.items[i]);
+        };
+
+        auto solve_one = [&] (solver_context& context, std::size_t i, unsigned worker) -> bool {
+            auto const solve_scope = trace::scope(trace::phase::solve, item(i));
+            auto const start = now();
+
+            solutions[i] = context.solve(puzzles[i], options.engine, options.variant);
+            return finish(i, worker, start, {});
+        };
+
+        // Propagates up to lane_width puzzles side by side and finishes
+        // whatever is left of each on its own. Each puzzle's latency gets an
+        // equal share of the time spent in the lanes.
+        auto solve_lanes = [&] (solver_context& context, std::size_t const* indices,
+                std::size_t count, unsigned worker) -> std::size_t {
+
+            auto group = std::array<sudoku, lane_width>();
+            auto partial = std::array<sudoku, lane_width>();
+            auto outcomes = std::array<propagation_result, lane_width>();
+
+            for (std::size_t k = 0; k < count; ++k) {
+                group[k] = puzzles[indices[k]];
+            }
+
+            auto const start = now();
+            {
+                auto const propagate_scope = trace::scope(trace::phase::propagate);
+                propagate_lanes(util::span(group.data(), count),
+                        util::span(partial.data(), count), util::span(outcomes.data(), count));
+            }
+
+            auto const shared = (now() - start) / static_cast<int>(count);
+            auto local_solved = std::size_t{0};
+
+            for (std::size_t k = 0; k < count; ++k) {
+                auto const i = indices[k];
+                auto const solve_scope = trace::scope(trace::phase::solve, item(i));
+                auto const own_start = now();
+
+                switch (outcomes[k]) {
+                    case propagation_result::solved:
+                        solutions[i] = partial[k];
+                        break;
+                    case propagation_result::stuck:
+                        // Everything found so far counts as given, as with
+                        // the scalar hybrid path.
+                        solutions[i] = context.solve(partial[k], backend::hybrid,
+                                options.variant);
+                        break;
+                    case propagation_result::contradiction:
+                        solutions[i] = puzzles[i];
+                        break;
+                }
+
+                local_solved += finish(i, worker, own_start, shared);
+            }
+
+            return local_solved;
+        };
+
+        if (workers <= 1 || !options.schedule_by_difficulty) {
+            run_partitioned(puzzles.size(), workers,
+                [&] (std::size_t begin, std::size_t end, unsigned worker) {
+                    auto& context = start_worker(worker);
+                    auto local_solved = std::size_t{0};
+
+                    if (use_lanes) {
+                        auto indices = std::array<std::size_t, lane_width>();
+
+                        for (auto i = begin; i < end; i += lane_width) {
+                            auto const count = std::min<std::size_t>(lane_width, end - i);
+                            std::iota(indices.begin(), indices.begin() + count, i);
+                            local_solved += solve_lanes(context, indices.data(), count, worker);
+                        }
+                    } else {
+                        for (auto i = begin; i < end; ++i) {
+                            local_solved += solve_one(context, i, worker);
+                        }
+                    }
+
+                    solved.fetch_add(local_solved, std::memory_order_relaxed);
+                });
+        } else {
+            // With hard puzzles up front and small chunks handed out on
+            // demand, nobody ends up alone with a pile of hard puzzles at the
+            // very end.
+            auto const& order = schedule_by_difficulty(puzzles, workers, arena);
+            auto cursor = std::atomic<std::size_t>{0};
+
+            run_workers(workers, [&] (unsigned worker) {
+                auto& context = start_worker(worker);
+                auto local_solved = std::size_t{0};
+
+                for (auto begin = cursor.fetch_add(dynamic_chunk_size, std::memory_order_relaxed);
+                        begin < order.size();
+                        begin = cursor.fetch_add(dynamic_chunk_size, std::memory_order_relaxed)) {
+
+                    auto const end = std::min(begin + dynamic_chunk_size, order.size());
+
+                    if (use_lanes) {
+                        local_solved += solve_lanes(context, order.data() + begin, end - begin,
+                                worker);
+                        continue;
+                    }
+
+                    for (auto i = begin; i < end; ++i) {
+                        local_solved += solve_one(context, order[i], worker);
+                    }
+                }
+
+                solved.fetch_add(local_solved, std::memory_order_relaxed);
+            });
+        }
+
+        for (auto const& histogram : latencies) {
+            options.latency->merge(histogram);
+        }
+
+        return solved.load(std::memory_order_relaxed);
+    }
+
+    auto verify_batch(util::span<sudoku const> sudokus,
+            batch_options const& options) -> std::size_t {
+
+        assert((options.status.empty() || options.status.size() == sudokus.size())
+                && "Status span does not match sudoku span.");
+
+        auto const workers = resolve_workers(options.thread_count, sudokus.size());
+        auto valid = std::atomic<std::size_t>{0};
+
+        run_partitioned(sudokus.size(), workers,
+            [&] (std::size_t begin, std::size_t end, unsigned) {
+                auto local_valid = std::size_t{0};
+
+                for (auto i = begin; i < end; ++i) {
+                    auto const ok = verify_sudoku(sudokus[i], options.variant);
+                    local_valid += ok;
+
+                    if (!options.status.empty()) {
+                        options.status[i] = ok ? puzzle_status::ok
+                            : puzzle_status::invalid;
+                    }
+                }
+
+                valid.fetch_add(local_valid, std::memory_order_relaxed);
+            });
+
+        return valid.load(std::memory_order_relaxed);
+    }
+
+    auto verify_solutions(util::span<sudoku const> puzzles, util::span<sudoku const> solutions,
+            batch_options const& options) -> std::size_t {
+
+        assert(solutions.size() == puzzles.size()
+                && "Solution span does not match puzzle span.");
+        assert((options.status.empty() || options.status.size() == puzzles.size())
+                && "Status span does not match puzzle span.");
+
+        auto const workers = resolve_workers(options.thread_count, puzzles.size());
+        auto valid = std::atomic<std::size_t>{0};
+
+        run_partitioned(puzzles.size(), workers,
+            [&] (std::size_t begin, std::size_t end, unsigned) {
+                auto local_valid = std::size_t{0};
+
+                for (auto i = begin; i < end; ++i) {
+                    auto const ok = keeps_givens(puzzles[i], solutions[i])
+                        && verify_sudoku(solutions[i], options.variant);
+                    local_valid += ok;
+
+                    if (!options.status.empty()) {
+                        options.status[i] = ok ? puzzle_status::ok
+                            : puzzle_status::invalid;
+                    }
+                }
+
+                valid.fetch_add(local_valid, std::memory_order_relaxed);
+            });
+
+        return valid.load(std::memory_order_relaxed);
+    }
+
+    auto verify_solutions(std::string_view puzzles, std::string_view solutions,
+            batch_options const& options) -> std::size_t {
+
+        constexpr auto line_size = std::size_t{sudoku::field_size};
+        auto const count = options.status.size();
+
+        assert(puzzles.size() == count * line_size && solutions.size() == count * line_size
+                && "Text does not match status span.");
+
+        auto const workers = resolve_workers(options.thread_count, count);
+        auto valid = std::atomic<std::size_t>{0};
+
+        run_partitioned(count, workers,
+            [&] (std::size_t begin, std::size_t end, unsigned) {
+                auto local_valid = std::size_t{0};
+
+                for (auto i = begin; i < end; ++i) {
+                    auto const puzzle = parse_sudoku(puzzles.substr(i * line_size, line_size));
+                    auto const solution = parse_sudoku(
+                            solutions.substr(i * line_size, line_size));
+
+                    auto const ok = puzzle.has_value() && solution.has_value()
+                        && keeps_givens(*puzzle, *solution)
+                        && verify_sudoku(*solution, options.variant);
+                    local_valid += ok;
+                    options.status[i] = ok ? puzzle_status::ok : puzzle_status::invalid;
+                }
+
+                valid.fetch_add(local_valid, std::memory_order_relaxed);
+            });
+
+        return valid.load(std::memory_order_relaxed);
+    }
+} /* namespace solve */
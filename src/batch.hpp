@@ -0,0 +1,124 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "data.hpp"
+#include "histogram.hpp"
+#include "solver.hpp"
+#include "utility.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace solve {
+    enum class puzzle_status : std::uint8_t {
+        ok,
+        unsolvable,
+        invalid
+    };
+
+    // Solver contexts that outlive a single batch, one per worker index. A
+    // context is only created once its worker first needs it, on that
+    // worker's thread, so its matrix is first touched on the worker's NUMA
+    // node. With pinned workers the same index runs on the same core every
+    // batch and finds its matrix still in that core's cache.
+    class solver_arena {
+        private:
+        std::vector<std::unique_ptr<solver_context>> m_contexts;
+        // Scratch space for scheduling by difficulty, kept so that batches
+        // no larger than an earlier one don't allocate it again.
+        std::vector<std::uint16_t> m_estimates;
+        std::vector<std::size_t> m_order;
+
+        public:
+        // Makes room for `workers` contexts without creating any. Must not be
+        // called while a batch is using the arena.
+        void reserve(unsigned workers);
+
+        // The context of the given worker, created on first use. Only ever
+        // call this from the worker's own thread.
+        [[nodiscard]] auto context(unsigned worker) -> solver_context&;
+
+        // Buffers solve_batch orders the puzzles of a batch in.
+        [[nodiscard]] auto estimates() noexcept -> std::vector<std::uint16_t>& {
+            return m_estimates;
+        }
+
+        [[nodiscard]] auto order() noexcept -> std::vector<std::size_t>& {
+            return m_order;
+        }
+    };
+
+    struct batch_options {
+        // Number of worker threads to use. Zero means one per hardware thread.
+        unsigned thread_count = 0;
+        // Receives the outcome for each puzzle if non-empty. Has to be exactly
+        // as long as the span of puzzles passed in.
+        util::span<puzzle_status> status = {};
+        backend engine = backend::hybrid;
+        // Rules the puzzles follow. Solutions and verification both honour
+        // the extra rules of variants.
+        puzzle_variant variant = puzzle_variant::classic;
+        // With the hybrid backend, batches of at least this many puzzles are
+        // propagated lane_width at a time in SIMD lanes, and only puzzles
+        // that are still open afterwards are solved one by one. Zero turns
+        // this off, which is faster for builds without AVX2, where the lanes
+        // fall back to plain loops.
+        std::size_t lane_threshold = 1024;
+        // Solve the puzzles that look hardest first and hand out work in
+        // small chunks, which keeps single slow puzzles from holding up the
+        // end of a large batch. Only has an effect with more than one thread.
+        bool schedule_by_difficulty = true;
+        // If set, the time each puzzle took to solve and verify is added to
+        // this histogram, in nanoseconds. Every worker records into its own
+        // histogram and these are merged in once the batch is done.
+        latency_histogram* latency = nullptr;
+        // If set, worker contexts come from here instead of being created for
+        // this batch alone. Worth it when solving many batches in a row.
+        solver_arena* arena = nullptr;
+        // If non-empty, worker i pins itself to cpus[i % cpus.size()] before
+        // touching anything, and the default thread count is the number of
+        // CPUs given. The calling thread is worker 0 and is only pinned
+        // until the batch is done.
+        util::span<unsigned const> cpus = {};
+        // The puzzle ids trace scopes are tagged with: puzzles[i] is
+        // first_item + i, or first_item + items[i] if items is non-empty.
+        // Lets callers that solve a larger input in pieces keep the ids of
+        // their other phases. If non-empty, has to be exactly as long as the
+        // span of puzzles passed in.
+        std::uint64_t first_item = 0;
+        util::span<std::size_t const> items = {};
+    };
+
+    // Solves all puzzles and writes the solution for puzzles[i] to
+    // solutions[i]. Every solution is verified before it is stored, puzzles
+    // without a valid solution are marked as unsolvable. Returns the number of
+    // puzzles that were solved successfully.
+    //
+    // These functions allocate and start threads, so they throw
+    // std::bad_alloc or std::system_error when that fails, once all workers
+    // that did start have finished.
+    auto solve_batch(util::span<sudoku const> puzzles, util::span<sudoku> solutions,
+            batch_options const& options = {}) -> std::size_t;
+
+    // Checks all given sudokus with verify_sudoku under the rules of
+    // `options.variant`, marking failing ones as invalid. Returns the number of valid sudokus.
+    auto verify_batch(util::span<sudoku const> sudokus,
+            batch_options const& options = {}) -> std::size_t;
+
+    // Checks that solutions[i] keeps the givens of puzzles[i] and passes
+    // verify_sudoku under the rules of `options.variant`, marking failing
+    // ones as invalid. Returns the number of correct solutions.
+    auto verify_solutions(util::span<sudoku const> puzzles, util::span<sudoku const> solutions,
+            batch_options const& options = {}) -> std::size_t;
+    // Same for puzzles and solutions that are still text, 81 characters each
+    // and back to back, which spreads parsing over the workers as well.
+    // `options.status` has to hold one entry per puzzle. Text that doesn't
+    // parse counts as invalid.
+    auto verify_solutions(std::string_view puzzles, std::string_view solutions,
+            batch_options const& options) -> std::size_t;
+} /* namespace solve */
+
+#endif // BATCH_HPP
@@ -0,0 +1,342 @@
+#include "ssolve.h"
+
+#include "batch.hpp"
+#include "solver.hpp"
+#include "variants.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+struct ssolve_context {
+    ssolve_options options;
+    // Worker 0 runs on the calling thread and also solves single puzzles.
+    solve::solver_arena arena;
+    // Batches are converted into these, which only ever grow.
+    std::vector<solve::sudoku> puzzles;
+    std::vector<solve::sudoku> solutions;
+    std::vector<solve::puzzle_status> status;
+    // Index in the caller's batch of each puzzle in `puzzles`.
+    std::vector<std::size_t> positions;
+};
+
+namespace {
+    constexpr auto packed_size = std::size_t{(solve::sudoku::field_size + 1) / 2};
+
+    [[nodiscard]] auto decode(ssolve_format format, unsigned char const* bytes,
+            solve::sudoku& result) noexcept -> bool {
+
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            auto value = 0;
+
+            if (format == SSOLVE_FORMAT_TEXT) {
+                auto const c = bytes[cell];
+                if (c == '.' || c == '0') {
+                    value = 0;
+                } else if (c >= '1' && c <= '9') {
+                    value = c - '0';
+                } else {
+                    return false;
+                }
+            } else {
+                auto const byte = bytes[cell / 2];
+                value = cell % 2 == 0 ? byte & 0xf : byte >> 4;
+                if (value > 9) {
+                    return false;
+                }
+            }
+
+            result.data[cell] = static_cast<std::int8_t>(value);
+        }
+
+        return true;
+    }
+
+    void encode(ssolve_format format, solve::sudoku const& s, unsigned char* bytes) noexcept {
+        if (format == SSOLVE_FORMAT_TEXT) {
+            for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+                bytes[cell] = static_cast<unsigned char>('0' + s.data[cell]);
+            }
+
+            return;
+        }
+
+        std::fill(bytes, bytes + packed_size, 0);
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            auto const value = static_cast<unsigned char>(s.data[cell] & 0xf);
+            bytes[cell / 2] |= static_cast<unsigned char>(cell % 2 == 0 ? value : value << 4);
+        }
+    }
+
+    [[nodiscard]] auto valid_format(ssolve_format format) noexcept -> bool {
+        return format == SSOLVE_FORMAT_TEXT || format == SSOLVE_FORMAT_PACKED;
+    }
+
+    [[nodiscard]] auto to_variant(ssolve_variant variant) noexcept -> solve::puzzle_variant {
+        switch (variant) {
+            case SSOLVE_VARIANT_X:
+                return solve::puzzle_variant::x;
+            case SSOLVE_VARIANT_WINDOKU:
+                return solve::puzzle_variant::windoku;
+            case SSOLVE_VARIANT_ANTI_KNIGHT:
+                return solve::puzzle_variant::anti_knight;
+            case SSOLVE_VARIANT_CLASSIC:
+                break;
+        }
+
+        return solve::puzzle_variant::classic;
+    }
+
+    [[nodiscard]] auto to_backend(ssolve_backend backend) noexcept -> solve::backend {
+        return backend == SSOLVE_BACKEND_DANCING_LINKS ? solve::backend::dancing_links
+            : solve::backend::hybrid;
+    }
+
+    // Created along with the context, matrix and all, so this never
+    // allocates.
+    [[nodiscard]] auto worker_context(ssolve_context& context) -> solve::solver_context& {
+        return context.arena.context(0);
+    }
+
+    // Runs `f` and turns anything it throws into an error code, since no
+    // exception may unwind into the C caller. Builds without exceptions
+    // have nothing to catch and end the process instead.
+    template <typename Fun>
+    [[nodiscard]] auto guarded(Fun const& f) noexcept -> ssolve_error {
+#if defined(__cpp_exceptions)
+        try {
+            return f();
+        } catch (std::bad_alloc const&) {
+            return SSOLVE_OUT_OF_MEMORY;
+        } catch (...) {
+            return SSOLVE_INTERNAL_ERROR;
+        }
+#else
+        return f();
+#endif
+    }
+} /* namespace */
+
+extern "C" {
+    unsigned ssolve_abi_version(void) {
+        return SSOLVE_ABI_VERSION;
+    }
+
+    char const* ssolve_error_string(ssolve_error error) {
+        switch (error) {
+            case SSOLVE_OK:
+                return "ok";
+            case SSOLVE_UNSOLVABLE:
+                return "puzzle has no solution";
+            case SSOLVE_INVALID_PUZZLE:
+                return "puzzle is not in the given format";
+            case SSOLVE_INVALID_ARGUMENT:
+                return "invalid argument";
+            case SSOLVE_OUT_OF_MEMORY:
+                return "out of memory";
+            case SSOLVE_INTERNAL_ERROR:
+                return "internal error";
+        }
+
+        return "unknown error";
+    }
+
+    size_t ssolve_format_size(ssolve_format format) {
+        switch (format) {
+            case SSOLVE_FORMAT_TEXT:
+                return solve::sudoku::field_size;
+            case SSOLVE_FORMAT_PACKED:
+                return packed_size;
+        }
+
+        return 0;
+    }
+
+    void ssolve_default_options(ssolve_options* options) {
+        if (options == nullptr) {
+            return;
+        }
+
+        *options = ssolve_options{sizeof(ssolve_options), 1, SSOLVE_VARIANT_CLASSIC,
+            SSOLVE_BACKEND_HYBRID};
+    }
+
+    ssolve_error ssolve_context_create(ssolve_options const* options,
+            ssolve_context** context) {
+
+        if (context == nullptr) {
+            return SSOLVE_INVALID_ARGUMENT;
+        }
+
+        *context = nullptr;
+
+        auto resolved = ssolve_options();
+        ssolve_default_options(&resolved);
+
+        if (options != nullptr) {
+            if (options->struct_size < sizeof(options->struct_size)) {
+                return SSOLVE_INVALID_ARGUMENT;
+            }
+
+            // Callers built against an older header pass a shorter struct,
+            // whose missing fields keep their defaults.
+            std::memcpy(&resolved, options, std::min(options->struct_size, sizeof(resolved)));
+            resolved.struct_size = sizeof(resolved);
+        }
+
+        auto const variant = static_cast<int>(resolved.variant);
+
+        if (variant < SSOLVE_VARIANT_CLASSIC || variant > SSOLVE_VARIANT_ANTI_KNIGHT
+                || (resolved.backend != SSOLVE_BACKEND_HYBRID
+                    && resolved.backend != SSOLVE_BACKEND_DANCING_LINKS)) {
+
+            return SSOLVE_INVALID_ARGUMENT;
+        }
+
+        auto created = std::unique_ptr<ssolve_context>(new (std::nothrow) ssolve_context());
+        if (created == nullptr) {
+            return SSOLVE_OUT_OF_MEMORY;
+        }
+
+        created->options = resolved;
+
+        auto const error = guarded([&created] {
+            created->arena.reserve(1);
+            worker_context(*created).prepare(to_variant(created->options.variant));
+            return SSOLVE_OK;
+        });
+
+        if (error == SSOLVE_OK) {
+            *context = created.release();
+        }
+
+        return error;
+    }
+
+    void ssolve_context_destroy(ssolve_context* context) {
+        delete context;
+    }
+
+    ssolve_error ssolve_solve(ssolve_context* context, ssolve_format format,
+            void const* puzzle, void* solution) {
+
+        if (context == nullptr || puzzle == nullptr || solution == nullptr
+                || !valid_format(format)) {
+
+            return SSOLVE_INVALID_ARGUMENT;
+        }
+
+        auto s = solve::sudoku();
+        if (!decode(format, static_cast<unsigned char const*>(puzzle), s)) {
+            return SSOLVE_INVALID_PUZZLE;
+        }
+
+        return guarded([&] {
+            auto const variant = to_variant(context->options.variant);
+            auto const result = worker_context(*context).solve(s,
+                    to_backend(context->options.backend), variant);
+
+            if (!solve::verify_sudoku(result, variant)) {
+                return SSOLVE_UNSOLVABLE;
+            }
+
+            encode(format, result, static_cast<unsigned char*>(solution));
+            return SSOLVE_OK;
+        });
+    }
+
+    ssolve_error ssolve_solve_batch(ssolve_context* context, ssolve_format format,
+            void const* puzzles, size_t puzzle_stride, size_t count, void* solutions,
+            size_t solution_stride, ssolve_error* errors, size_t* solved) {
+
+        auto const size = ssolve_format_size(format);
+
+        if (context == nullptr || size == 0 || puzzle_stride < size || solution_stride < size
+                || (count > 0 && (puzzles == nullptr || solutions == nullptr))) {
+
+            return SSOLVE_INVALID_ARGUMENT;
+        }
+
+        return guarded([&] {
+            auto const* const in = static_cast<unsigned char const*>(puzzles);
+            auto* const out = static_cast<unsigned char*>(solutions);
+            auto result = SSOLVE_OK;
+
+            context->puzzles.clear();
+            context->positions.clear();
+
+            for (std::size_t i = 0; i < count; ++i) {
+                auto s = solve::sudoku();
+
+                if (!decode(format, in + i * puzzle_stride, s)) {
+                    result = SSOLVE_INVALID_PUZZLE;
+                    if (errors != nullptr) {
+                        errors[i] = SSOLVE_INVALID_PUZZLE;
+                    }
+
+                    continue;
+                }
+
+                context->puzzles.push_back(s);
+                context->positions.push_back(i);
+            }
+
+            context->solutions.resize(context->puzzles.size());
+            context->status.resize(context->puzzles.size());
+
+            auto options = solve::batch_options();
+            options.thread_count = context->options.threads;
+            options.engine = to_backend(context->options.backend);
+            options.variant = to_variant(context->options.variant);
+            options.status = context->status;
+            options.arena = &context->arena;
+
+            auto const solved_count = solve::solve_batch(context->puzzles, context->solutions,
+                    options);
+
+            for (std::size_t k = 0; k < context->puzzles.size(); ++k) {
+                auto const i = context->positions[k];
+                auto const ok = context->status[k] == solve::puzzle_status::ok;
+
+                // Written from the decoded puzzle rather than the input, which
+                // may already be overwritten if the buffers overlap.
+                encode(format, ok ? context->solutions[k] : context->puzzles[k],
+                        out + i * solution_stride);
+
+                if (errors != nullptr) {
+                    errors[i] = ok ? SSOLVE_OK : SSOLVE_UNSOLVABLE;
+                }
+            }
+
+            if (solved != nullptr) {
+                *solved = solved_count;
+            }
+
+            return result;
+        });
+    }
+
+    ssolve_error ssolve_count_solutions(ssolve_context* context, ssolve_format format,
+            void const* puzzle, uint64_t limit, uint64_t* count) {
+
+        if (context == nullptr || puzzle == nullptr || count == nullptr
+                || !valid_format(format)) {
+
+            return SSOLVE_INVALID_ARGUMENT;
+        }
+
+        auto s = solve::sudoku();
+        if (!decode(format, static_cast<unsigned char const*>(puzzle), s)) {
+            return SSOLVE_INVALID_PUZZLE;
+        }
+
+        return guarded([&] {
+            *count = worker_context(*context).count_solutions(s, limit,
+                    to_variant(context->options.variant));
+            return SSOLVE_OK;
+        });
+    }
+}
@@ -0,0 +1,81 @@
+#include "checkpoint.hpp"
+
+#include <fmt/core.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+#include <unistd.h>
+
+// A single line of text, so that a checkpoint can be inspected and, in a
+// pinch, edited by hand.
+static constexpr auto checkpoint_magic = "ssolve-checkpoint";
+static constexpr auto checkpoint_version = 1;
+
+namespace solve {
+    auto write_checkpoint(std::filesystem::path const& path, checkpoint const& state)
+        -> tl::expected<void, io_error> {
+
+        auto temporary = path;
+        temporary += ".tmp";
+
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+                std::fopen(temporary.c_str(), "w"), &std::fclose);
+
+        if (file == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not open {} for writing.", temporary.string())));
+        }
+
+        fmt::print(file.get(), "{} {} {} {} {} {}\n", checkpoint_magic, checkpoint_version,
+                state.input_offset, state.line, state.output_size, state.input_size);
+
+        if (std::fflush(file.get()) != 0 || fsync(fileno(file.get())) != 0
+                || std::fclose(file.release()) != 0) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not write {}.", temporary.string())));
+        }
+
+        auto error = std::error_code();
+        std::filesystem::rename(temporary, path, error);
+
+        if (error) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not replace {}: {}", path.string(),
+                            error.message())));
+        }
+
+        return {};
+    }
+
+    auto read_checkpoint(std::filesystem::path const& path)
+        -> tl::expected<checkpoint, io_error> {
+
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+                std::fopen(path.c_str(), "r"), &std::fclose);
+
+        if (file == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE,
+                        fmt::format("Could not open checkpoint {}.", path.string())));
+        }
+
+        char magic[32] = {};
+        auto version = 0;
+        auto state = checkpoint();
+
+        auto const fields = std::fscanf(file.get(),
+                "%31s %d %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64, magic, &version,
+                &state.input_offset, &state.line, &state.output_size, &state.input_size);
+
+        if (fields != 6 || std::string_view(magic) != checkpoint_magic
+                || version != checkpoint_version) {
+            return tl::unexpected(io_error(io_error::err_code::FORMAT_ERROR,
+                        fmt::format("{} is not a checkpoint.", path.string())));
+        }
+
+        return state;
+    }
+} /* namespace solve */
@@ -0,0 +1,35 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "input.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <filesystem>
+
+namespace solve {
+    // How far a run over an input file got. Everything before `input_offset`
+    // has been solved, and its solutions make up the first `output_size`
+    // bytes of the output.
+    struct checkpoint {
+        std::uint64_t input_offset = 0;
+        // Lines of input before `input_offset`.
+        std::uint64_t line = 0;
+        std::uint64_t output_size = 0;
+        // Size of the input file at the time, to catch resuming against a
+        // different file.
+        std::uint64_t input_size = 0;
+    };
+
+    // Replaces the checkpoint at `path` atomically and durably: it's written
+    // to a temporary file, synced and renamed over the old one, so a crash at
+    // any point leaves either the old or the new checkpoint behind.
+    [[nodiscard]] auto write_checkpoint(std::filesystem::path const& path,
+            checkpoint const& state) -> tl::expected<void, io_error>;
+
+    [[nodiscard]] auto read_checkpoint(std::filesystem::path const& path)
+        -> tl::expected<checkpoint, io_error>;
+} /* namespace solve */
+
+#endif // CHECKPOINT_HPP
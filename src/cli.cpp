@@ -0,0 +1,202 @@
+#include "cli.hpp"
+#include "utility.hpp"
+
+#include <fmt/core.h>
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+using std::literals::string_view_literals::operator""sv;
+
+namespace solve::cli {
+    auto usage() noexcept -> std::string_view {
+        return "Usage: sudoku_solve [options] <file>\n"
+            "       sudoku_solve --verify [options] <puzzles> <solutions>\n"
+            "\n"
+            "Options:\n"
+            "  -o, --output <file>     Write solutions to <file> instead of stdout\n"
+            "  --io <auto|uring|posix> I/O backend, io_uring by default where available\n"
+            "  --variant <rules>       classic, x, windoku or anti-knight (default classic)\n"
+            "  --shard <k>/<n>         Only solve the k-th of n line aligned byte ranges\n"
+            "  --fork <n>              Solve n shards in n processes and merge the output\n"
+            "  --pin                   Pin one worker thread to each allowed CPU\n"
+            "  --checkpoint <file>     Record progress in <file> every 10 seconds\n"
+            "  --resume                Continue where the checkpoint left off\n"
+            "  --store <file>          Reuse and record solutions in a store at <file>\n"
+            "  --trace <file>          Write a Chrome trace of all solver phases to <file>\n"
+            "  --latency               Print per-puzzle latency percentiles and throughput\n"
+            "  --latency-json <file>   Also dump the latency histogram to <file> as JSON\n"
+            "  --perf-counters         Print hardware counters per puzzle and phase (Linux)\n"
+            "  --verify                Report lines of <solutions> that don't solve the\n"
+            "                          puzzle on the same line of <puzzles>\n"sv;
+    }
+
+    auto parse_arguments(int argc, char const** argv)
+        -> tl::expected<options, std::string> {
+
+        auto result = options();
+        auto positional = std::vector<std::filesystem::path>();
+        auto verify = false;
+
+        for (int i = 1; i < argc; ++i) {
+            auto const arg = std::string_view(argv[i]);
+
+            // Fetches the value of an option that takes one.
+            auto value = [&] () -> std::optional<std::string_view> {
+                if (i + 1 >= argc) {
+                    return std::nullopt;
+                }
+
+                return std::string_view(argv[++i]);
+            };
+
+            if (arg == "-o"sv || arg == "--output"sv) {
+                auto path = value();
+                if (!path.has_value()) {
+                    return tl::unexpected(fmt::format("Option {} expects a file path.", arg));
+                }
+
+                result.output = std::filesystem::path(*path);
+            } else if (arg == "--io"sv) {
+                auto backend = value();
+                if (backend == "auto"sv) {
+                    result.io = io_backend::automatic;
+                } else if (backend == "uring"sv) {
+                    result.io = io_backend::io_uring;
+                } else if (backend == "posix"sv) {
+                    result.io = io_backend::posix;
+                } else {
+                    return tl::unexpected(std::string(
+                                "Option --io expects one of auto, uring or posix."));
+                }
+            } else if (arg == "--variant"sv) {
+                auto const variant = parse_variant(value().value_or(""sv));
+                if (!variant.has_value()) {
+                    return tl::unexpected(std::string("Option --variant expects one of "
+                                "classic, x, windoku or anti-knight."));
+                }
+
+                result.variant = *variant;
+            } else if (arg == "--shard"sv) {
+                auto const spec = value().value_or(""sv);
+                auto const slash = spec.find('/');
+                auto const index = util::parse_number<unsigned>(spec.substr(0, slash));
+                auto const count = slash == std::string_view::npos ? std::nullopt
+                    : util::parse_number<unsigned>(spec.substr(slash + 1));
+
+                if (!index.has_value() || !count.has_value() || *index >= *count) {
+                    return tl::unexpected(std::string("Option --shard expects <k>/<n> "
+                                "with k < n, counting from 0."));
+                }
+
+                result.shard = shard_spec{*index, *count};
+            } else if (arg == "--fork"sv) {
+                auto const count = util::parse_number<unsigned>(value().value_or(""sv));
+
+                if (!count.has_value() || *count == 0) {
+                    return tl::unexpected(std::string(
+                                "Option --fork expects a positive number of processes."));
+                }
+
+                result.fork = *count;
+            } else if (arg == "--checkpoint"sv) {
+                auto path = value();
+                if (!path.has_value()) {
+                    return tl::unexpected(std::string(
+                                "Option --checkpoint expects a file path."));
+                }
+
+                result.checkpoint = std::filesystem::path(*path);
+            } else if (arg == "--store"sv) {
+                auto path = value();
+                if (!path.has_value()) {
+                    return tl::unexpected(std::string("Option --store expects a file path."));
+                }
+
+                result.store = std::filesystem::path(*path);
+            } else if (arg == "--resume"sv) {
+                result.resume = true;
+            } else if (arg == "--pin"sv) {
+                result.pin = true;
+            } else if (arg == "--trace"sv) {
+                auto path = value();
+                if (!path.has_value()) {
+                    return tl::unexpected(std::string("Option --trace expects a file path."));
+                }
+
+                result.trace = std::filesystem::path(*path);
+            } else if (arg == "--latency"sv) {
+                result.latency = true;
+            } else if (arg == "--latency-json"sv) {
+                auto path = value();
+                if (!path.has_value()) {
+                    return tl::unexpected(std::string(
+                                "Option --latency-json expects a file path."));
+                }
+
+                result.latency = true;
+                result.latency_json = std::filesystem::path(*path);
+            } else if (arg == "--perf-counters"sv) {
+                result.perf_counters = true;
+            } else if (arg == "--verify"sv) {
+                verify = true;
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                return tl::unexpected(fmt::format("Unknown option '{}'.", arg));
+            } else {
+                positional.emplace_back(arg);
+            }
+        }
+
+        if (verify) {
+            if (positional.size() != 2) {
+                return tl::unexpected(std::string("Option --verify expects a puzzle file "
+                            "and a solution file."));
+            }
+
+            // Nothing gets solved, and the two files don't share byte ranges.
+            if (result.shard.has_value() || result.fork > 0 || result.pin
+                    || result.checkpoint.has_value() || result.resume
+                    || result.store.has_value() || result.trace.has_value()
+                    || result.latency || result.perf_counters) {
+
+                return tl::unexpected(std::string("Option --verify can only be combined "
+                            "with --output, --io and --variant."));
+            }
+
+            result.input = std::move(positional[0]);
+            result.verify = std::move(positional[1]);
+            return result;
+        }
+
+        if (positional.size() > 1) {
+            return tl::unexpected(std::string("More than one data file given. Invoke "
+                        "the program with a single data file path as argument."));
+        }
+
+        if (positional.empty()) {
+            return tl::unexpected(std::string("No data file given. Invoke the program "
+                        "with a single data file path as argument."));
+        }
+
+        if (result.fork > 0 && result.shard.has_value()) {
+            return tl::unexpected(std::string("Options --fork and --shard can't be combined."));
+        }
+
+        // Every process would overwrite the same file.
+        if (result.fork > 0 && (result.trace.has_value() || result.latency_json.has_value()
+                    || result.checkpoint.has_value())) {
+            return tl::unexpected(std::string("Options --trace, --latency-json and "
+                        "--checkpoint can't be combined with --fork."));
+        }
+
+        // Output written to stdout can't be taken back.
+        if (result.resume && (!result.checkpoint.has_value() || !result.output.has_value())) {
+            return tl::unexpected(std::string(
+                        "Option --resume needs both --checkpoint and --output."));
+        }
+
+        result.input = std::move(positional.front());
+        return result;
+    }
+} /* namespace solve::cli */
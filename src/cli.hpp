@@ -0,0 +1,51 @@
+#ifndef CLI_HPP
+#define CLI_HPP
+
+#include "file_io.hpp"
+#include "variants.hpp"
+
+#include <tl/expected.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace solve::cli {
+    struct shard_spec {
+        unsigned index = 0;
+        unsigned count = 1;
+    };
+
+    struct options {
+        std::filesystem::path input;
+        // Standard output if not set.
+        std::optional<std::filesystem::path> output;
+        io_backend io = io_backend::automatic;
+        puzzle_variant variant = puzzle_variant::classic;
+        // Only solve this part of the input.
+        std::optional<shard_spec> shard;
+        // Number of processes to split the input over, zero for just this one.
+        unsigned fork = 0;
+        bool pin = false;
+        std::optional<std::filesystem::path> checkpoint;
+        // Continue from the checkpoint instead of starting over.
+        bool resume = false;
+        // Look puzzles up here before solving them, and record new ones.
+        std::optional<std::filesystem::path> store;
+        std::optional<std::filesystem::path> trace;
+        bool latency = false;
+        std::optional<std::filesystem::path> latency_json;
+        bool perf_counters = false;
+        // Check the solutions in this file against the puzzles in `input`
+        // instead of solving anything.
+        std::optional<std::filesystem::path> verify;
+    };
+
+    [[nodiscard]] auto usage() noexcept -> std::string_view;
+
+    [[nodiscard]] auto parse_arguments(int argc, char const** argv)
+        -> tl::expected<options, std::string>;
+} /* namespace solve::cli */
+
+#endif // CLI_HPP
@@ -1,4 +1,5 @@
 #include "data.hpp"
+#include "utility.hpp"
 
 #include <cassert>
 
@@ -63,4 +64,29 @@ namespace solve {
         return iterator_range{const_block_iterator(block_start),
             const_block_iterator(block_end)};
     }
+
+    bitboard::bitboard(sudoku const& s) noexcept {
+        for (unsigned y = 0; y < 9; ++y) {
+            for (unsigned x = 0; x < 9; ++x) {
+                cells[index(x, y)] = digit_mask(s.data[x + 9 * y]);
+            }
+        }
+    }
+
+    auto bitboard::to_sudoku() const noexcept -> sudoku {
+        auto result = sudoku{};
+
+        for (unsigned y = 0; y < 9; ++y) {
+            for (unsigned x = 0; x < 9; ++x) {
+                auto const mask = cells[index(x, y)];
+
+                if (mask != 0 && (mask & (mask - 1)) == 0) {
+                    result.data[x + 9 * y] =
+                        static_cast<std::int8_t>(util::count_trailing_zeros(mask) + 1);
+                }
+            }
+        }
+
+        return result;
+    }
 } /* namespace solve */
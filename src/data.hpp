@@ -5,6 +5,7 @@
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <utility>
 
@@ -234,5 +235,37 @@ namespace solve {
         [[nodiscard]] auto iterate_from(block_tag, unsigned index) const noexcept
             -> iterator_range<const_block_iterator>;
     }; 
+
+    // Packed representation of a sudoku in which every cell is a bit mask of
+    // the digits it can hold, i.e. bit n stands for digit n + 1. Filled cells
+    // have exactly one bit set, empty ones none. Rows are padded to 16 cells
+    // so that a whole row fits into a single 256 bit register; the padding is
+    // always zero.
+    struct bitboard {
+        constexpr static inline auto row_stride = 16u;
+        constexpr static inline auto all_digits = std::uint16_t{0b00000001'11111111};
+
+        alignas(32) std::array<std::uint16_t, 9 * row_stride> cells = {};
+
+        bitboard() = default;
+        explicit bitboard(sudoku const& s) noexcept;
+
+        [[nodiscard]] constexpr static auto index(unsigned x, unsigned y) noexcept
+            -> unsigned {
+
+            assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+            return x + y * row_stride;
+        }
+
+        [[nodiscard]] constexpr static auto digit_mask(std::int8_t value) noexcept
+            -> std::uint16_t {
+
+            return (value >= 1 && value <= 9)
+                ? static_cast<std::uint16_t>(1u << (value - 1)) : std::uint16_t{0};
+        }
+
+        // Cells which do not hold exactly one digit come out empty.
+        [[nodiscard]] auto to_sudoku() const noexcept -> sudoku;
+    };
 }
 #endif // DATA_HPP
@@ -0,0 +1,448 @@
+#include "exact_cover.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace solve {
+
+    auto cover_matrix::node::left() const noexcept -> cover_matrix::node* {
+        return m_left;
+    }
+
+    auto cover_matrix::node::right() const noexcept -> cover_matrix::node* {
+        return m_right;
+    }
+
+    auto cover_matrix::node::header() const noexcept -> cover_matrix::column_head* {
+        return m_header;
+    }
+
+    auto cover_matrix::node::up() const noexcept
+        -> std::variant<cover_matrix::node*, cover_matrix::column_head*> {
+
+        return m_up;
+    }
+
+    auto cover_matrix::node::down() const noexcept
+        -> std::variant<cover_matrix::node*, cover_matrix::column_head*> {
+
+        return m_down;
+    }
+
+    void cover_matrix::node::unlink_vertically() noexcept {
+        // Order is important: First up, then down...
+        std::visit([this] (auto* up) {
+                up->m_down = m_down;
+            }, m_up);
+
+        std::visit([this] (auto* down) {
+                down->m_up = m_up;
+            }, m_down);
+
+        m_header->decrease_count();
+    }
+
+    void cover_matrix::node::relink_vertically() noexcept {
+        //...to undo: First down, then up.
+        std::visit([this] (auto* down) {
+                down->m_up = this;
+            }, m_down);
+
+        std::visit([this] (auto* up) {
+                up->m_down = this;
+            }, m_up);
+
+        m_header->increase_count();
+    }
+
+    void cover_matrix::column_head::increase_count() noexcept {
+        m_count += 1;
+    }
+
+    void cover_matrix::column_head::decrease_count() noexcept {
+        assert(m_count > 0 && "Trying to decrement count beyond zero");
+        m_count -= 1;
+    }
+
+    void cover_matrix::column_head::unlink() noexcept {
+        m_right->m_left = m_left;
+        m_left->m_right = m_right;
+    }
+
+    void cover_matrix::column_head::relink() noexcept {
+        m_left->m_right = this;
+        m_right->m_left = this;
+    }
+
+    void cover_matrix::column_head::cover() noexcept {
+        unlink();
+
+        traverse(down_tag{}, [] (auto& down) {
+            down.traverse(right_tag{}, [] (auto& right) {
+                right.unlink_vertically();
+            });
+        });
+    }
+
+    void cover_matrix::column_head::uncover() noexcept {
+
+        traverse(up_tag{}, [] (auto& up) {
+            up.traverse(left_tag{}, [] (auto& left) {
+                left.relink_vertically();
+            });
+        });
+
+        relink();
+    }
+
+    void cover_matrix::attach(column_head* headers, node* nodes, int* row_starts,
+            int primary, int secondary, int row_capacity, int node_capacity) {
+
+        assert(primary >= 0 && secondary >= 0 && "Negative column count.");
+        assert(row_starts[0] == 0 && "Rows have to start at the first node.");
+
+        m_headers = headers;
+        m_nodes = nodes;
+        m_row_starts = row_starts;
+        m_primary = primary;
+        m_secondary = secondary;
+        m_rows = 0;
+        m_row_capacity = row_capacity;
+        m_node_capacity = node_capacity;
+        m_stack.reserve(std::min(primary, row_capacity));
+
+        make_columns();
+    }
+
+    void cover_matrix::make_columns() noexcept {
+        auto link = [] (column_head& left, column_head& right) {
+            left.m_right = &right;
+            right.m_left = &left;
+        };
+
+        auto const secondary_root = m_primary + m_secondary + 1;
+
+        for (int i = 0; i <= secondary_root; ++i) {
+            auto& head = m_headers[i];
+            head.m_up = &head;
+            head.m_down = &head;
+            head.m_count = 0;
+        }
+
+        // Primary columns hang off the root at index 0, which the search
+        // walks. Secondary ones get a ring of their own, with its root at the
+        // very end, so that covering them works the same way but nothing
+        // ever selects them.
+        for (int i = 0; i < m_primary; ++i) {
+            link(m_headers[i], m_headers[i + 1]);
+        }
+
+        link(m_headers[m_primary], m_headers[0]);
+
+        for (int i = m_primary + 1; i < secondary_root; ++i) {
+            link(m_headers[i], m_headers[i + 1]);
+        }
+
+        link(m_headers[secondary_root], m_headers[m_primary + 1]);
+    }
+
+    void cover_matrix::link_row(int row) noexcept {
+        auto* const first = m_nodes + m_row_starts[row];
+        auto* const last = m_nodes + m_row_starts[row + 1];
+
+        for (auto* n = first; n != last; ++n) {
+            n->m_left = n == first ? last - 1 : n - 1;
+            n->m_right = n + 1 == last ? first : n + 1;
+
+            // Append to the bottom of the column.
+            auto* const head = n->m_header;
+            n->m_up = head->m_up;
+            n->m_down = head;
+
+            std::visit([n] (auto* up) {
+                    up->m_down = n;
+                }, head->m_up);
+
+            head->m_up = n;
+            head->increase_count();
+        }
+    }
+
+    auto cover_matrix::root() noexcept -> column_head& {
+        return m_headers[0];
+    }
+
+    auto cover_matrix::max_depth() const noexcept -> int {
+        return std::min(m_primary, m_rows);
+    }
+
+    auto cover_matrix::primary_columns() const noexcept -> int {
+        return m_primary;
+    }
+
+    auto cover_matrix::secondary_columns() const noexcept -> int {
+        return m_secondary;
+    }
+
+    auto cover_matrix::row_count() const noexcept -> int {
+        return m_rows;
+    }
+
+    auto cover_matrix::nodes_visited() const noexcept -> std::uint64_t {
+        return m_nodes_visited;
+    }
+
+    void cover_matrix::reset() noexcept {
+        make_columns();
+
+        // Cover and uncover never touch the horizontal links or the header
+        // of a node, so relinking the rows in order rebuilds every column.
+        for (int row = 0; row < m_rows; ++row) {
+            link_row(row);
+        }
+    }
+
+    void cover_matrix::cover_row(int index) noexcept {
+        assert(index >= 0 && index < m_rows && "Row index out of range.");
+
+        auto& node = m_nodes[m_row_starts[index]];
+
+        node.traverse(right_tag{}, [] (auto& right) {
+            right.m_header->cover();
+        });
+
+        node.m_header->cover();
+    }
+
+    void cover_matrix::uncover_row(int index) noexcept {
+        assert(index >= 0 && index < m_rows && "Row index out of range.");
+
+        auto& node = m_nodes[m_row_starts[index]];
+
+        node.m_header->uncover();
+
+        node.traverse(left_tag{}, [] (auto& left) {
+            left.m_header->uncover();
+        });
+    }
+
+    auto cover_matrix::row_available(int index) const noexcept -> bool {
+        assert(index >= 0 && index < m_rows && "Row index out of range.");
+
+        auto const* first = m_nodes + m_row_starts[index];
+        auto const* last = m_nodes + m_row_starts[index + 1];
+
+        // Covered columns are skipped by their neighbours, uncovered ones
+        // never are.
+        return std::all_of(first, last, [] (auto const& n) {
+            return n.m_header->m_left->m_right == n.m_header;
+        });
+    }
+
+    auto cover_matrix::select_next_head() noexcept -> cover_matrix::column_head& {
+        auto min_count = std::numeric_limits<int>::max();
+        column_head* min_head = &root();
+
+        min_head->traverse(right_tag{}, [&min_count, &min_head] (auto& right) mutable {
+
+            // Sadly, we need this because std::tie takes lvalue references so
+            // simply passing &right does not work.
+            auto* right_ptr = &right;
+            std::tie(min_count, min_head) = std::min(std::tie(min_count, min_head),
+                    std::tie(right.m_count, right_ptr),
+                    [] (auto a, auto b) {
+                        return std::get<0>(a) < std::get<0>(b);
+            });
+        });
+
+        return *min_head;
+    }
+
+    auto cover_matrix::solve_impl(std::vector<node*>& solutions, int index) noexcept
+        -> bool {
+
+        auto& root = this->root();
+
+        if (&root == root.m_right) {
+            return true;
+        }
+
+        column_head* next_column = &select_next_head();
+        next_column->cover();
+
+        auto found_solution = next_column->traverse_until(down_tag{}, [&] (auto& down) {
+            auto* down_ptr = &down;
+
+            solutions[index] = down_ptr;
+            ++m_nodes_visited;
+
+            down.traverse(right_tag{}, [] (auto& right) {
+                right.m_header->cover();
+            });
+
+            if (solve_impl(solutions, index + 1)) {
+                return true;
+            }
+
+            down_ptr = solutions[index];
+            next_column = down_ptr->m_header;
+
+            down_ptr->traverse(left_tag{}, [] (auto& left) {
+                left.m_header->uncover();
+            });
+
+            return false;
+        });
+
+        if (found_solution) {
+            return true;
+        }
+
+        next_column->uncover();
+        return false;
+    }
+
+    auto cover_matrix::solve() noexcept -> std::vector<int> {
+        auto indices = std::vector<int>();
+        solve(indices);
+        return indices;
+    }
+
+    auto cover_matrix::solve(std::vector<int>& indices) noexcept -> bool {
+        indices.clear();
+        m_stack.assign(max_depth(), nullptr);
+
+        // A failed search leaves the rows it tried last behind.
+        if (!solve_impl(m_stack, 0)) {
+            return false;
+        }
+
+        for (auto* node : m_stack) {
+            if (node == nullptr) {
+                break;
+            }
+
+            indices.push_back(node->m_row);
+        }
+
+        return true;
+    }
+
+    cover_matrix::solution_cursor::solution_cursor(cover_matrix& matrix)
+        : m_matrix{&matrix}, m_stack(std::move(matrix.m_stack)) {
+
+        m_stack.clear();
+    }
+
+    cover_matrix::solution_cursor::solution_cursor(solution_cursor&& other) noexcept
+        : m_matrix{other.m_matrix}, m_stack(std::move(other.m_stack)),
+          m_yielded{other.m_yielded}, m_done{other.m_done} {
+
+        other.m_matrix = nullptr;
+    }
+
+    cover_matrix::solution_cursor::~solution_cursor() {
+        if (m_matrix == nullptr) {
+            return;
+        }
+
+        // Undo every choice still on the stack, deepest first.
+        while (!m_stack.empty()) {
+            auto* row = m_stack.back();
+
+            row->traverse(left_tag{}, [] (auto& left) {
+                left.m_header->uncover();
+            });
+
+            row->m_header->uncover();
+            m_stack.pop_back();
+        }
+
+        m_matrix->m_stack = std::move(m_stack);
+    }
+
+    auto cover_matrix::solution_cursor::backtrack() noexcept -> bool {
+        while (!m_stack.empty()) {
+            auto* row = m_stack.back();
+
+            row->traverse(left_tag{}, [] (auto& left) {
+                left.m_header->uncover();
+            });
+
+            if (std::holds_alternative<node*>(row->m_down)) {
+                row = std::get<node*>(row->m_down);
+                m_stack.back() = row;
+                ++m_matrix->m_nodes_visited;
+
+                row->traverse(right_tag{}, [] (auto& right) {
+                    right.m_header->cover();
+                });
+
+                return true;
+            }
+
+            row->m_header->uncover();
+            m_stack.pop_back();
+        }
+
+        return false;
+    }
+
+    auto cover_matrix::solution_cursor::next() noexcept -> bool {
+        if (m_done) {
+            return false;
+        }
+
+        if (m_yielded) {
+            m_yielded = false;
+
+            if (!backtrack()) {
+                m_done = true;
+                return false;
+            }
+        }
+
+        auto& root = m_matrix->root();
+
+        while (&root != root.m_right) {
+            auto& column = m_matrix->select_next_head();
+            column.cover();
+
+            if (std::holds_alternative<column_head*>(column.m_down)) {
+                // Nothing can satisfy this column, so the last choice was bad.
+                column.uncover();
+
+                if (!backtrack()) {
+                    m_done = true;
+                    return false;
+                }
+
+                continue;
+            }
+
+            auto* row = std::get<node*>(column.m_down);
+            m_stack.push_back(row);
+            ++m_matrix->m_nodes_visited;
+
+            row->traverse(right_tag{}, [] (auto& right) {
+                right.m_header->cover();
+            });
+        }
+
+        m_yielded = true;
+        return true;
+    }
+
+    void cover_matrix::solution_cursor::current(std::vector<int>& indices) const {
+        assert(m_yielded && "Cursor does not point at a solution.");
+
+        for (auto* row : m_stack) {
+            indices.push_back(row->m_row);
+        }
+    }
+} /* namespace solve */
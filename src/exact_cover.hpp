@@ -0,0 +1,347 @@
+#ifndef EXACT_COVER_HPP
+#define EXACT_COVER_HPP
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace solve {
+
+    // The dancing links machinery behind every exact cover matrix: covering
+    // and uncovering columns, picking the column with the fewest rows left
+    // and searching, either for a single solution or one solution at a time
+    // through a solution_cursor. It works on storage owned by exact_cover,
+    // which decides whether that storage is sized at compile time or at
+    // runtime.
+    //
+    // Columns are numbered from 0. The first `primary_columns` of them have
+    // to be covered exactly once by a solution, the `secondary_columns` after
+    // them at most once. Rows are numbered in the order they were added.
+    class cover_matrix {
+        protected:
+        struct up_tag {};
+        struct down_tag {};
+        struct left_tag {};
+        struct right_tag {};
+
+        class column_head;
+
+        class node {
+            private:
+            column_head* m_header;
+            node* m_left;
+            node* m_right;
+            std::variant<node*, column_head*> m_up;
+            std::variant<node*, column_head*> m_down;
+            int m_row;
+
+            // Ugly, but I can't think of a better solution right now
+            friend class cover_matrix;
+
+            public:
+            node() = default;
+
+            [[nodiscard]] auto left() const noexcept -> node*;
+            [[nodiscard]] auto right() const noexcept -> node*;
+            [[nodiscard]] auto header() const noexcept -> column_head*;
+            [[nodiscard]] auto up() const noexcept -> std::variant<node*, column_head*>;
+            [[nodiscard]] auto down() const noexcept -> std::variant<node*, column_head*>;
+
+            void unlink_vertically() noexcept;
+            void relink_vertically() noexcept;
+
+            template <typename Fun>
+            void traverse(right_tag, Fun&& f) {
+                for (auto* right = m_right; right != this; right = right->right()) {
+                    std::invoke(std::forward<Fun>(f), *right);
+                }
+            }
+
+            template <typename Fun>
+            void traverse(left_tag, Fun&& f) {
+                for (auto* left = m_left; left != this; left = left->left()) {
+                    std::invoke(std::forward<Fun>(f), *left);
+                }
+            }
+        };
+
+        class column_head {
+            private:
+            column_head* m_left;
+            column_head* m_right;
+            std::variant<node*, column_head*> m_up;
+            std::variant<node*, column_head*> m_down;
+            int m_count = 0;
+
+            friend class cover_matrix;
+
+            public:
+            column_head() noexcept
+                : m_left{}, m_right{}, m_up{}, m_down{} {}
+
+            void increase_count() noexcept;
+            void decrease_count() noexcept;
+
+            void unlink() noexcept;
+            void relink() noexcept;
+
+            void cover() noexcept;
+            void uncover() noexcept;
+
+            template <typename Fun>
+            void traverse(up_tag, Fun&& f) {
+                for (auto up = m_up; !std::holds_alternative<column_head*>(up);
+                        up = std::get<node*>(up)->up()) {
+
+                    std::invoke(std::forward<Fun>(f), *std::get<node*>(up));
+                }
+            }
+
+            template <typename Fun>
+            void traverse(down_tag, Fun&& f) {
+                for (auto down = m_down; !std::holds_alternative<column_head*>(down);
+                        down = std::get<node*>(down)->down()) {
+
+                    std::invoke(std::forward<Fun>(f), *std::get<node*>(down));
+                }
+            }
+
+            template <typename Fun>
+            void traverse(right_tag, Fun&& f) {
+                for (auto* right = m_right; right != this; right = right->m_right) {
+
+                    std::invoke(std::forward<Fun>(f), *right);
+                }
+            }
+
+            template <typename Fun>
+            auto traverse_until(down_tag, Fun&& f) -> bool {
+                for (auto down = m_down; !std::holds_alternative<column_head*>(down);
+                        down = std::get<node*>(down)->down()) {
+
+                    if (std::invoke(std::forward<Fun>(f), *std::get<node*>(down))) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        };
+
+        // Hands the matrix its storage: `primary + secondary + 2` headers,
+        // room for `node_capacity` nodes and `row_capacity + 1` row starts,
+        // the first of which has to be 0. None of it may move afterwards.
+        void attach(column_head* headers, node* nodes, int* row_starts, int primary,
+                int secondary, int row_capacity, int node_capacity);
+
+        // Appends a row covering the columns in [first, last). Every column
+        // must be in range and occur at most once.
+        template <typename Iterator>
+        void add_row(Iterator first, Iterator last) noexcept {
+            assert(m_rows < m_row_capacity && "Too many rows for this matrix.");
+            assert(first != last && "Rows must cover at least one column.");
+
+            auto const start = m_row_starts[m_rows];
+            auto end = start;
+
+            for (; first != last; ++first, ++end) {
+                auto const column = static_cast<int>(*first);
+
+                assert(end < m_node_capacity && "Too many nodes for this matrix.");
+                assert(column >= 0 && column < m_primary + m_secondary
+                        && "Column index out of range.");
+
+                m_nodes[end].m_header = &m_headers[column + 1];
+                m_nodes[end].m_row = m_rows;
+            }
+
+            m_row_starts[++m_rows] = end;
+            link_row(m_rows - 1);
+        }
+
+        private:
+        column_head* m_headers = nullptr;
+        node* m_nodes = nullptr;
+        int* m_row_starts = nullptr;
+        int m_primary = 0;
+        int m_secondary = 0;
+        int m_rows = 0;
+        int m_row_capacity = 0;
+        int m_node_capacity = 0;
+        // Search stack, allocated once up front and lent to every search and
+        // cursor, so searching never allocates.
+        std::vector<node*> m_stack;
+        std::uint64_t m_nodes_visited = 0;
+
+        void make_columns() noexcept;
+        void link_row(int row) noexcept;
+
+        [[nodiscard]] auto root() noexcept -> column_head&;
+        // No search ever picks more rows than there are primary columns.
+        [[nodiscard]] auto max_depth() const noexcept -> int;
+
+        auto select_next_head() noexcept -> column_head&;
+
+        auto solve_impl(std::vector<node*>& solutions, int index) noexcept -> bool;
+
+        public:
+        cover_matrix() = default;
+
+        cover_matrix(cover_matrix const&) = delete;
+        cover_matrix(cover_matrix&&) = default;
+
+        auto operator=(cover_matrix const&) -> cover_matrix& = delete;
+        auto operator=(cover_matrix&&) -> cover_matrix& = default;
+
+        ~cover_matrix() = default;
+
+        [[nodiscard]] auto primary_columns() const noexcept -> int;
+        [[nodiscard]] auto secondary_columns() const noexcept -> int;
+        [[nodiscard]] auto row_count() const noexcept -> int;
+        // Rows tried by all searches on this matrix so far, including those
+        // of solution cursors. The same searches always try the same rows,
+        // so this tells changes to the search apart from timing noise.
+        [[nodiscard]] auto nodes_visited() const noexcept -> std::uint64_t;
+
+        // Restores the full, uncovered matrix without reallocating its storage.
+        void reset() noexcept;
+
+        void cover_row(int index) noexcept;
+        // Exactly undoes cover_row. Rows covered after this one have to be
+        // uncovered first.
+        void uncover_row(int index) noexcept;
+        // A row can only be covered while none of its columns is covered.
+        [[nodiscard]] auto row_available(int index) const noexcept -> bool;
+
+        // The rows of the first solution found, or nothing if there is none.
+        auto solve() noexcept -> std::vector<int>;
+        // Same, but replaces the contents of `indices` instead of allocating.
+        // Returns whether there was a solution.
+        auto solve(std::vector<int>& indices) noexcept -> bool;
+
+        // Walks through all solutions of the matrix one by one. The search
+        // state lives on an explicit stack, so the cursor can stop after any
+        // solution and pick up from there on the next call. Once the cursor
+        // is destroyed, the matrix is back in the state it was found in.
+        // There may only be one cursor per matrix at a time, as it borrows the
+        // matrix's search stack.
+        class solution_cursor {
+            private:
+            cover_matrix* m_matrix;
+            std::vector<node*> m_stack;
+            bool m_yielded = false;
+            bool m_done = false;
+
+            auto backtrack() noexcept -> bool;
+
+            public:
+            explicit solution_cursor(cover_matrix& matrix);
+
+            solution_cursor(solution_cursor const&) = delete;
+            solution_cursor(solution_cursor&& other) noexcept;
+
+            auto operator=(solution_cursor const&) -> solution_cursor& = delete;
+            auto operator=(solution_cursor&&) -> solution_cursor& = delete;
+
+            ~solution_cursor();
+
+            // Advances to the next solution. Returns false once there are
+            // none left.
+            [[nodiscard]] auto next() noexcept -> bool;
+
+            // Appends the row indices making up the current solution.
+            void current(std::vector<int>& indices) const;
+        };
+    };
+
+    // Selects an exact_cover whose dimensions are only known at runtime.
+    struct dynamic_shape {};
+
+    // An exact cover problem, with the matrix wired up once on construction
+    // and reused for every search after that.
+    //
+    // `Shape` is either dynamic_shape, in which case the column counts are
+    // passed to the constructor and the storage is sized to fit the rows, or
+    // a type fixing the dimensions at compile time, which keeps the whole
+    // matrix in a single allocation:
+    //
+    //     struct queens_shape {
+    //         static constexpr int primary_columns = 16;
+    //         static constexpr int secondary_columns = 26;
+    //         static constexpr int rows = 64;
+    //         static constexpr int nodes = 4 * 64;
+    //     };
+    //
+    // `rows` and `nodes` are upper bounds. Rows are given as a range of
+    // ranges of column indices.
+    template <typename Shape = dynamic_shape>
+    class exact_cover : public cover_matrix {
+        private:
+        constexpr static inline auto header_count = Shape::primary_columns
+            + Shape::secondary_columns + 2;
+
+        struct storage {
+            std::array<column_head, header_count> headers;
+            std::array<node, Shape::nodes> nodes;
+            std::array<int, Shape::rows + 1> row_starts{};
+        };
+
+        std::unique_ptr<storage> m_storage = std::make_unique<storage>();
+
+        protected:
+        // For matrices adding their rows themselves.
+        exact_cover() {
+            attach(m_storage->headers.data(), m_storage->nodes.data(),
+                    m_storage->row_starts.data(), Shape::primary_columns,
+                    Shape::secondary_columns, Shape::rows, Shape::nodes);
+        }
+
+        public:
+        template <typename Rows>
+        explicit exact_cover(Rows const& rows) : exact_cover() {
+            for (auto const& row : rows) {
+                add_row(std::begin(row), std::end(row));
+            }
+        }
+    };
+
+    template <>
+    class exact_cover<dynamic_shape> : public cover_matrix {
+        private:
+        std::vector<column_head> m_headers;
+        std::vector<node> m_nodes;
+        std::vector<int> m_row_starts;
+
+        public:
+        template <typename Rows>
+        exact_cover(int primary_columns, int secondary_columns, Rows const& rows)
+            : m_headers(primary_columns + secondary_columns + 2) {
+
+            auto row_count = 0;
+            auto node_count = 0;
+
+            for (auto const& row : rows) {
+                row_count += 1;
+                node_count += static_cast<int>(std::distance(std::begin(row), std::end(row)));
+            }
+
+            m_nodes.resize(node_count);
+            m_row_starts.resize(row_count + 1);
+
+            attach(m_headers.data(), m_nodes.data(), m_row_starts.data(), primary_columns,
+                    secondary_columns, row_count, node_count);
+
+            for (auto const& row : rows) {
+                add_row(std::begin(row), std::end(row));
+            }
+        }
+    };
+} /* namespace solve */
+#endif // EXACT_COVER_HPP
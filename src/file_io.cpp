@@ -0,0 +1,869 @@
+#include "file_io.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define SSOLVE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#else
+#define SSOLVE_HAS_IO_URING 0
+#endif
+
+using std::literals::string_view_literals::operator""sv;
+
+[[nodiscard]] static auto errno_error(solve::io_error::err_code code, std::string_view what,
+        int error) -> solve::io_error {
+
+    return solve::io_error(code, fmt::format("{}: {}", what, std::strerror(error)));
+}
+
+// Reads until `size` bytes are in or the file ends. Returns the number of
+// bytes read or -errno.
+[[nodiscard]] static auto read_all(int fd, char* data, std::size_t size,
+        std::int64_t offset = -1) noexcept -> std::int64_t {
+
+    auto done = std::size_t{0};
+    while (done < size) {
+        auto const n = offset < 0 ? ::read(fd, data + done, size - done)
+            : ::pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            return -errno;
+        } else if (n == 0) {
+            break;
+        }
+
+        done += static_cast<std::size_t>(n);
+    }
+
+    return static_cast<std::int64_t>(done);
+}
+
+// Writes all of `data`. Returns 0 or -errno.
+[[nodiscard]] static auto write_all(int fd, char const* data, std::size_t size,
+        std::int64_t offset = -1) noexcept -> int {
+
+    auto done = std::size_t{0};
+    while (done < size) {
+        auto const n = offset < 0 ? ::write(fd, data + done, size - done)
+            : ::pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            return -errno;
+        }
+
+        done += static_cast<std::size_t>(n);
+    }
+
+    return 0;
+}
+
+#if SSOLVE_HAS_IO_URING
+namespace {
+    // Just enough of an io_uring wrapper for a handful of reads or writes in
+    // flight: every request is submitted right away and completions are
+    // reaped one at a time.
+    class uring {
+        private:
+        int m_fd = -1;
+        void* m_sq_ring = MAP_FAILED;
+        std::size_t m_sq_ring_size = 0;
+        void* m_cq_ring = MAP_FAILED;
+        std::size_t m_cq_ring_size = 0;
+        io_uring_sqe* m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        std::size_t m_sqes_size = 0;
+
+        unsigned* m_sq_tail = nullptr;
+        unsigned* m_sq_array = nullptr;
+        unsigned m_sq_mask = 0;
+        unsigned* m_cq_head = nullptr;
+        unsigned* m_cq_tail = nullptr;
+        unsigned m_cq_mask = 0;
+        io_uring_cqe* m_cqes = nullptr;
+
+        bool m_registered = false;
+
+        uring() noexcept = default;
+
+        public:
+        // Null if the kernel doesn't support io_uring or won't let us use it.
+        [[nodiscard]] static auto create(unsigned entries) noexcept -> std::unique_ptr<uring> {
+            auto params = io_uring_params();
+            auto const fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+            if (fd < 0) {
+                return nullptr;
+            }
+
+            auto ring = std::unique_ptr<uring>(new uring());
+            ring->m_fd = fd;
+            ring->m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            ring->m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            auto const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap) {
+                ring->m_sq_ring_size = ring->m_cq_ring_size
+                    = std::max(ring->m_sq_ring_size, ring->m_cq_ring_size);
+            }
+
+            ring->m_sq_ring = mmap(nullptr, ring->m_sq_ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (ring->m_sq_ring == MAP_FAILED) {
+                return nullptr;
+            }
+
+            ring->m_cq_ring = single_mmap ? ring->m_sq_ring
+                : mmap(nullptr, ring->m_cq_ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (ring->m_cq_ring == MAP_FAILED) {
+                return nullptr;
+            }
+
+            ring->m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            ring->m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->m_sqes_size,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQES));
+            if (ring->m_sqes == MAP_FAILED) {
+                return nullptr;
+            }
+
+            auto* const sq = static_cast<char*>(ring->m_sq_ring);
+            auto* const cq = static_cast<char*>(ring->m_cq_ring);
+
+            ring->m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            ring->m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            ring->m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            ring->m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            ring->m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            ring->m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            ring->m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            return ring;
+        }
+
+        uring(uring const&) = delete;
+        auto operator=(uring const&) -> uring& = delete;
+
+        ~uring() {
+            if (m_sqes != MAP_FAILED) {
+                munmap(m_sqes, m_sqes_size);
+            }
+
+            if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) {
+                munmap(m_cq_ring, m_cq_ring_size);
+            }
+
+            if (m_sq_ring != MAP_FAILED) {
+                munmap(m_sq_ring, m_sq_ring_size);
+            }
+
+            close(m_fd);
+        }
+
+        // Pins the buffers so the kernel doesn't have to map them for every
+        // request. Fails if that would exceed RLIMIT_MEMLOCK, in which case
+        // plain vectored requests do the job just as well.
+        auto register_buffers(std::vector<iovec> const& buffers) noexcept -> bool {
+            m_registered = syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS,
+                    buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+            return m_registered;
+        }
+
+        // Submits a read or write of buffer `index` at `offset`, -1 meaning
+        // the current file position. Returns 0 or -errno.
+        auto submit(bool write, int fd, iovec const& buffer, unsigned index,
+                std::uint64_t offset) noexcept -> int {
+
+            auto sqe = io_uring_sqe();
+            sqe.fd = fd;
+            sqe.off = offset;
+            sqe.user_data = index;
+
+            if (m_registered) {
+                sqe.opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe.addr = reinterpret_cast<std::uint64_t>(buffer.iov_base);
+                sqe.len = static_cast<std::uint32_t>(buffer.iov_len);
+                sqe.buf_index = static_cast<std::uint16_t>(index);
+            } else {
+                sqe.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe.addr = reinterpret_cast<std::uint64_t>(&buffer);
+                sqe.len = 1;
+            }
+
+            // We're the only producer, so the tail can be read plainly. The
+            // kernel must see the entry before it sees the new tail.
+            auto const tail = *m_sq_tail;
+            auto const slot = tail & m_sq_mask;
+            m_sqes[slot] = sqe;
+            m_sq_array[slot] = slot;
+            __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+            while (true) {
+                auto const submitted = syscall(__NR_io_uring_enter, m_fd, 1, 0, 0, nullptr, 0);
+
+                if (submitted >= 0) {
+                    return 0;
+                } else if (errno != EINTR) {
+                    return -errno;
+                }
+            }
+        }
+
+        // Blocks until a request completes. Returns 0 or -errno.
+        auto wait(io_uring_cqe& completion) noexcept -> int {
+            while (true) {
+                auto const head = *m_cq_head;
+
+                if (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+                    completion = m_cqes[head & m_cq_mask];
+                    __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+                    return 0;
+                }
+
+                if (syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS,
+                            nullptr, 0) < 0 && errno != EINTR) {
+                    return -errno;
+                }
+            }
+        }
+    };
+} /* namespace */
+#else
+namespace {
+    // Stand-in where io_uring doesn't exist, create always fails.
+    struct uring {
+        [[nodiscard]] static auto create(unsigned) noexcept -> std::unique_ptr<uring> {
+            return nullptr;
+        }
+
+        auto register_buffers(std::vector<iovec> const&) noexcept -> bool {
+            return false;
+        }
+
+        auto submit(bool, int, iovec const&, unsigned, std::uint64_t) noexcept -> int {
+            return -ENOSYS;
+        }
+
+        struct completion {
+            std::uint64_t user_data;
+            std::int32_t res;
+        };
+
+        auto wait(completion&) noexcept -> int {
+            return -ENOSYS;
+        }
+    };
+
+    using io_uring_cqe = uring::completion;
+} /* namespace */
+#endif
+
+// Sets up a ring with `depth` buffers carved out of `storage`, or returns
+// null if io_uring is unavailable.
+[[nodiscard]] static auto make_ring(unsigned depth, std::vector<char>& storage,
+        std::vector<iovec>& buffers, std::size_t buffer_size) -> std::unique_ptr<uring> {
+
+    auto ring = uring::create(depth);
+
+    if (ring == nullptr) {
+        return nullptr;
+    }
+
+    storage.resize(depth * buffer_size);
+    buffers.resize(depth);
+
+    for (unsigned i = 0; i < depth; ++i) {
+        buffers[i].iov_base = storage.data() + i * buffer_size;
+        buffers[i].iov_len = buffer_size;
+    }
+
+    ring->register_buffers(buffers);
+    return ring;
+}
+
+namespace solve {
+    auto io_backend_to_string(io_backend backend) noexcept -> std::string_view {
+        switch (backend) {
+            case io_backend::automatic:
+                return "auto"sv;
+            case io_backend::io_uring:
+                return "io_uring"sv;
+            case io_backend::posix:
+                return "posix"sv;
+            default:
+                return ""sv;
+        }
+    }
+
+    struct file_reader::impl {
+        static constexpr auto pending = INT64_MIN;
+
+        int fd = -1;
+        io_backend backend = io_backend::posix;
+        std::size_t buffer_size = 0;
+        std::vector<char> storage;
+        std::vector<iovec> buffers;
+        std::unique_ptr<uring> ring;
+
+        // The part of the file to read. Pipes and the like have no size, for
+        // them the end is never reached through `position`.
+        bool regular = false;
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        std::uint64_t position = 0;
+        // Pieces of the file are numbered in order, piece n goes into buffer
+        // n % depth.
+        std::uint64_t submitted = 0;
+        std::uint64_t delivered = 0;
+        bool handed_out = false;
+        unsigned in_flight = 0;
+        std::vector<std::int64_t> results;
+
+        ~impl() {
+            // The kernel may still be writing into our buffers.
+            auto completion = io_uring_cqe();
+            while (in_flight > 0 && ring->wait(completion) == 0) {
+                --in_flight;
+            }
+
+            ring.reset();
+
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+
+        [[nodiscard]] auto piece_offset(std::uint64_t piece) const noexcept -> std::uint64_t {
+            return begin + piece * buffer_size;
+        }
+
+        [[nodiscard]] auto piece_length(std::uint64_t piece) const noexcept -> std::size_t {
+            auto const offset = piece_offset(piece);
+            return offset >= end ? 0
+                : static_cast<std::size_t>(std::min<std::uint64_t>(buffer_size, end - offset));
+        }
+
+        [[nodiscard]] auto refill() -> tl::expected<void, io_error> {
+            auto const depth = buffers.size();
+
+            while (submitted < delivered + depth && piece_length(submitted) > 0) {
+                auto const index = static_cast<unsigned>(submitted % depth);
+                buffers[index].iov_len = piece_length(submitted);
+                results[index] = pending;
+
+                auto const error = ring->submit(false, fd, buffers[index], index,
+                        piece_offset(submitted));
+                if (error < 0) {
+                    return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                                "Could not submit read"sv, -error));
+                }
+
+                ++in_flight;
+                ++submitted;
+            }
+
+            return {};
+        }
+
+        [[nodiscard]] auto next_uring() -> tl::expected<std::string_view, io_error> {
+            if (handed_out) {
+                ++delivered;
+                handed_out = false;
+            }
+
+            if (auto refilled = refill(); !refilled.has_value()) {
+                return tl::unexpected(std::move(refilled).error());
+            }
+
+            auto const length = piece_length(delivered);
+            if (length == 0) {
+                return std::string_view();
+            }
+
+            auto const index = static_cast<unsigned>(delivered % buffers.size());
+            while (results[index] == pending) {
+                auto completion = io_uring_cqe();
+
+                if (auto const error = ring->wait(completion); error < 0) {
+                    return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                                "Could not wait for read"sv, -error));
+                }
+
+                results[completion.user_data] = completion.res;
+                --in_flight;
+            }
+
+            auto got = results[index];
+            auto* const data = static_cast<char*>(buffers[index].iov_base);
+
+            if (got < 0) {
+                return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                            "Could not read"sv, static_cast<int>(-got)));
+            }
+
+            // Short reads are rare for regular files, just finish them here.
+            if (static_cast<std::size_t>(got) < length) {
+                auto const rest = read_all(fd, data + got, length - got,
+                        static_cast<std::int64_t>(piece_offset(delivered)) + got);
+
+                if (rest < 0) {
+                    return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                                "Could not read"sv, static_cast<int>(-rest)));
+                } else if (got + rest < static_cast<std::int64_t>(length)) {
+                    return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                                "File was truncated while reading."));
+                }
+            }
+
+            handed_out = true;
+            return std::string_view(data, length);
+        }
+
+        [[nodiscard]] auto next_posix() -> tl::expected<std::string_view, io_error> {
+            auto const got = !regular ? read_all(fd, storage.data(), storage.size())
+                : read_all(fd, storage.data(), static_cast<std::size_t>(
+                            std::min<std::uint64_t>(storage.size(), end - position)),
+                        static_cast<std::int64_t>(position));
+
+            if (got < 0) {
+                return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                            "Could not read"sv, static_cast<int>(-got)));
+            }
+
+            position += static_cast<std::uint64_t>(got);
+
+            return std::string_view(storage.data(), static_cast<std::size_t>(got));
+        }
+    };
+
+    file_reader::file_reader(std::unique_ptr<impl> state) noexcept
+        : m_impl(std::move(state)) {}
+
+    file_reader::file_reader(file_reader&& other) noexcept = default;
+    auto file_reader::operator=(file_reader&& other) noexcept -> file_reader& = default;
+    file_reader::~file_reader() = default;
+
+    auto file_reader::open(std::filesystem::path const& path, stream_options const& options,
+            byte_range range) -> tl::expected<file_reader, io_error> {
+
+        auto state = std::make_unique<impl>();
+        state->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (state->fd == -1) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE));
+        }
+
+        struct stat info = {};
+        auto const regular = fstat(state->fd, &info) == 0 && S_ISREG(info.st_mode);
+
+        if (!regular && (range.begin != 0 || range.end != byte_range().end)) {
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        "Only regular files can be read in parts."));
+        }
+
+        state->buffer_size = std::max<std::size_t>(options.buffer_size, 4096);
+        state->regular = regular;
+
+        if (regular) {
+            auto const size = static_cast<std::uint64_t>(info.st_size);
+            state->end = std::min(range.end, size);
+            state->begin = state->position = std::min(range.begin, state->end);
+        }
+
+        if (regular && options.backend != io_backend::posix) {
+            auto const depth = std::max(options.queue_depth, 1u);
+            state->ring = make_ring(depth, state->storage, state->buffers,
+                    state->buffer_size);
+
+            if (state->ring != nullptr) {
+                state->backend = io_backend::io_uring;
+                state->results.assign(depth, impl::pending);
+            } else if (options.backend == io_backend::io_uring) {
+                return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                            "io_uring is not available."));
+            }
+        }
+
+        if (state->backend == io_backend::posix) {
+            state->storage.resize(state->buffer_size);
+        }
+
+        return file_reader(std::move(state));
+    }
+
+    auto shard_range(std::filesystem::path const& path, unsigned index, unsigned count)
+        -> tl::expected<byte_range, io_error> {
+
+        assert(index < count && "Shard index out of range.");
+
+        auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE));
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close(fd);
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        "Only regular files can be split into shards."));
+        }
+
+        auto const size = static_cast<std::uint64_t>(info.st_size);
+
+        // Moves a split point to the start of the line it falls into the
+        // middle of, so that each line goes to the shard its first byte is in.
+        auto align = [&] (unsigned k) -> tl::expected<std::uint64_t, io_error> {
+            if (k == 0 || k == count) {
+                return k == 0 ? 0 : size;
+            }
+
+            auto position = size / count * k + size % count * k / count;
+            char block[4096];
+
+            // Starting one early catches split points right after a line break.
+            for (position -= 1; position < size; ) {
+                auto const got = read_all(fd, block, sizeof(block),
+                        static_cast<std::int64_t>(position));
+
+                if (got < 0) {
+                    return tl::unexpected(errno_error(io_error::err_code::READ_ERROR,
+                                "Could not read"sv, static_cast<int>(-got)));
+                }
+
+                auto const* const newline = static_cast<char const*>(
+                        std::memchr(block, '\n', static_cast<std::size_t>(got)));
+
+                if (newline != nullptr) {
+                    return position + static_cast<std::uint64_t>(newline - block) + 1;
+                } else if (got == 0) {
+                    break;
+                }
+
+                position += static_cast<std::uint64_t>(got);
+            }
+
+            return size;
+        };
+
+        auto const begin = align(index);
+        auto const end = begin.has_value() ? align(index + 1) : begin;
+        close(fd);
+
+        if (!begin.has_value()) {
+            return tl::unexpected(begin.error());
+        } else if (!end.has_value()) {
+            return tl::unexpected(end.error());
+        }
+
+        return byte_range{*begin, *end};
+    }
+
+    auto file_reader::backend() const noexcept -> io_backend {
+        return m_impl->backend;
+    }
+
+    auto file_reader::next() -> tl::expected<std::string_view, io_error> {
+        return m_impl->backend == io_backend::io_uring ? m_impl->next_uring()
+            : m_impl->next_posix();
+    }
+
+    struct file_writer::impl {
+        int fd = -1;
+        bool owns_fd = true;
+        io_backend backend = io_backend::posix;
+        std::size_t buffer_size = 0;
+        std::vector<char> storage;
+        std::vector<iovec> buffers;
+        std::unique_ptr<uring> ring;
+
+        // Requests against a file with an explicit offset may complete in any
+        // order. Pipes, terminals and files opened for appending have no
+        // offsets to speak of, so only one request is allowed at a time.
+        bool positioned = false;
+        std::uint64_t offset = 0;
+        std::vector<std::uint64_t> offsets;
+        std::vector<bool> busy;
+        unsigned in_flight = 0;
+        unsigned current = 0;
+        std::size_t fill = 0;
+        std::optional<io_error> error;
+
+        ~impl() {
+            auto completion = io_uring_cqe();
+            while (in_flight > 0 && ring->wait(completion) == 0) {
+                --in_flight;
+            }
+
+            ring.reset();
+
+            if (owns_fd && fd != -1) {
+                close(fd);
+            }
+        }
+
+        [[nodiscard]] auto buffer_data(unsigned index) noexcept -> char* {
+            return storage.data() + index * buffer_size;
+        }
+
+        void fail(std::string_view what, int code) {
+            if (!error.has_value()) {
+                error = errno_error(io_error::err_code::WRITE_ERROR, what, code);
+            }
+        }
+
+        // Waits for one request and finishes it off should it have come up
+        // short.
+        void reap() {
+            auto completion = io_uring_cqe();
+
+            if (auto const code = ring->wait(completion); code < 0) {
+                fail("Could not wait for write"sv, -code);
+                // Nothing sensible left to wait for.
+                std::fill(busy.begin(), busy.end(), false);
+                in_flight = 0;
+                return;
+            }
+
+            auto const index = static_cast<unsigned>(completion.user_data);
+            auto const length = buffers[index].iov_len;
+            busy[index] = false;
+            --in_flight;
+
+            if (completion.res < 0) {
+                fail("Could not write"sv, -completion.res);
+            } else if (static_cast<std::size_t>(completion.res) < length) {
+                auto const done = static_cast<std::size_t>(completion.res);
+                auto const code = write_all(fd, buffer_data(index) + done, length - done,
+                        positioned ? static_cast<std::int64_t>(offsets[index] + done) : -1);
+
+                if (code < 0) {
+                    fail("Could not write"sv, -code);
+                }
+            }
+        }
+
+        void submit_current() {
+            if (fill == 0) {
+                return;
+            }
+
+            if (backend == io_backend::posix) {
+                if (auto const code = write_all(fd, storage.data(), fill); code < 0) {
+                    fail("Could not write"sv, -code);
+                }
+
+                fill = 0;
+                return;
+            }
+
+            while (!positioned && in_flight > 0) {
+                reap();
+            }
+
+            buffers[current].iov_len = fill;
+            offsets[current] = offset;
+
+            auto const code = ring->submit(true, fd, buffers[current], current,
+                    positioned ? offset : ~std::uint64_t{0});
+            if (code < 0) {
+                fail("Could not submit write"sv, -code);
+            } else {
+                busy[current] = true;
+                ++in_flight;
+            }
+
+            offset += fill;
+            fill = 0;
+            current = static_cast<unsigned>((current + 1) % buffers.size());
+
+            while (busy[current]) {
+                reap();
+            }
+        }
+
+        void drain() {
+            submit_current();
+
+            while (in_flight > 0) {
+                reap();
+            }
+
+            if (positioned && backend == io_backend::io_uring) {
+                // Leave the file position where plain writes would have.
+                lseek(fd, static_cast<off_t>(offset), SEEK_SET);
+            }
+        }
+    };
+
+    file_writer::file_writer(std::unique_ptr<impl> state) noexcept
+        : m_impl(std::move(state)) {}
+
+    file_writer::file_writer(file_writer&& other) noexcept = default;
+    auto file_writer::operator=(file_writer&& other) noexcept -> file_writer& = default;
+
+    file_writer::~file_writer() {
+        if (m_impl != nullptr) {
+            m_impl->drain();
+        }
+    }
+
+    auto file_writer::create(std::unique_ptr<impl> state, stream_options const& options)
+        -> tl::expected<file_writer, io_error> {
+
+        state->buffer_size = std::max<std::size_t>(options.buffer_size, 4096);
+
+        auto const flags = fcntl(state->fd, F_GETFL);
+        struct stat info = {};
+        auto const position = lseek(state->fd, 0, SEEK_CUR);
+
+        state->positioned = fstat(state->fd, &info) == 0 && S_ISREG(info.st_mode)
+            && flags != -1 && (flags & O_APPEND) == 0 && position >= 0;
+        state->offset = state->positioned ? static_cast<std::uint64_t>(position) : 0;
+
+        if (options.backend != io_backend::posix) {
+            auto const depth = std::max(options.queue_depth, 1u);
+            state->ring = make_ring(depth, state->storage, state->buffers,
+                    state->buffer_size);
+
+            if (state->ring != nullptr) {
+                state->backend = io_backend::io_uring;
+                state->offsets.assign(depth, 0);
+                state->busy.assign(depth, false);
+            } else if (options.backend == io_backend::io_uring) {
+                return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                            "io_uring is not available."));
+            }
+        }
+
+        if (state->backend == io_backend::posix) {
+            state->storage.resize(state->buffer_size);
+        }
+
+        return file_writer(std::move(state));
+    }
+
+    auto file_writer::open(std::filesystem::path const& path, stream_options const& options)
+        -> tl::expected<file_writer, io_error> {
+
+        auto const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd == -1) {
+            return tl::unexpected(errno_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not open {} for writing", path.string()), errno));
+        }
+
+        auto state = std::make_unique<impl>();
+        state->fd = fd;
+        state->owns_fd = true;
+
+        return create(std::move(state), options);
+    }
+
+    auto file_writer::resume(std::filesystem::path const& path, std::uint64_t size,
+            stream_options const& options) -> tl::expected<file_writer, io_error> {
+
+        auto const fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+
+        if (fd == -1) {
+            return tl::unexpected(errno_error(io_error::err_code::NO_SUCH_FILE,
+                        fmt::format("Could not open {}", path.string()), errno));
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < size
+                || ftruncate(fd, static_cast<off_t>(size)) != 0
+                || lseek(fd, static_cast<off_t>(size), SEEK_SET) == -1) {
+
+            close(fd);
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR, fmt::format(
+                            "Could not continue {} at {} bytes.", path.string(), size)));
+        }
+
+        auto state = std::make_unique<impl>();
+        state->fd = fd;
+        state->owns_fd = true;
+
+        return create(std::move(state), options);
+    }
+
+    auto file_writer::standard_output(stream_options const& options)
+        -> tl::expected<file_writer, io_error> {
+
+        auto state = std::make_unique<impl>();
+        state->fd = STDOUT_FILENO;
+        state->owns_fd = false;
+
+        return create(std::move(state), options);
+    }
+
+    auto file_writer::backend() const noexcept -> io_backend {
+        return m_impl->backend;
+    }
+
+    auto file_writer::write(std::string_view data) -> tl::expected<void, io_error> {
+        auto& state = *m_impl;
+
+        while (!data.empty() && !state.error.has_value()) {
+            auto const count = std::min(state.buffer_size - state.fill, data.size());
+            auto* const target = state.backend == io_backend::posix ? state.storage.data()
+                : state.buffer_data(state.current);
+
+            std::memcpy(target + state.fill, data.data(), count);
+            state.fill += count;
+            data.remove_prefix(count);
+
+            if (state.fill == state.buffer_size) {
+                state.submit_current();
+            }
+        }
+
+        if (state.error.has_value()) {
+            return tl::unexpected(*state.error);
+        }
+
+        return {};
+    }
+
+    auto file_writer::flush() -> tl::expected<void, io_error> {
+        m_impl->drain();
+
+        if (m_impl->error.has_value()) {
+            return tl::unexpected(*m_impl->error);
+        }
+
+        return {};
+    }
+
+    auto file_writer::sync() -> tl::expected<void, io_error> {
+        if (auto flushed = flush(); !flushed.has_value()) {
+            return flushed;
+        }
+
+        // Pipes and terminals refuse, and have nothing to sync anyway.
+        if (fdatasync(m_impl->fd) != 0 && errno != EINVAL && errno != EROFS) {
+            return tl::unexpected(errno_error(io_error::err_code::WRITE_ERROR,
+                        "Could not sync"sv, errno));
+        }
+
+        return {};
+    }
+} /* namespace solve */
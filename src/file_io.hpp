@@ -0,0 +1,127 @@
+#ifndef FILE_IO_HPP
+#define FILE_IO_HPP
+
+#include "input.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace solve {
+    enum class io_backend : std::uint8_t {
+        // io_uring where the kernel offers it, plain read/write elsewhere.
+        automatic,
+        io_uring,
+        posix
+    };
+
+    [[nodiscard]] auto io_backend_to_string(io_backend backend) noexcept -> std::string_view;
+
+    struct stream_options {
+        io_backend backend = io_backend::automatic;
+        // Size of each buffer, which is also the size of a single read or
+        // write request.
+        std::size_t buffer_size = std::size_t{1} << 20;
+        // Number of buffers, and thereby the number of requests that may be
+        // in flight at once with io_uring.
+        unsigned queue_depth = 8;
+    };
+
+    // A range of bytes in a file, the end is clamped to the file size.
+    struct byte_range {
+        std::uint64_t begin = 0;
+        std::uint64_t end = UINT64_MAX;
+    };
+
+    // Cuts a file into `count` ranges of about the same size and returns the
+    // one with the given index. Both ends are moved forward to the start of
+    // the next line, so every line lands in exactly one shard and the output
+    // of all shards concatenated in order matches that of the whole file.
+    [[nodiscard]] auto shard_range(std::filesystem::path const& path, unsigned index,
+            unsigned count) -> tl::expected<byte_range, io_error>;
+
+    // Reads a file front to back in buffer sized pieces. With io_uring, reads
+    // for all buffers that aren't currently handed out are kept in flight, so
+    // the next pieces arrive while the caller is busy with the current one.
+    // Registered buffers are used if the kernel lets us pin them.
+    //
+    // Anything that isn't a regular file, like a pipe, is read with plain
+    // blocking reads.
+    class file_reader {
+        private:
+        struct impl;
+        std::unique_ptr<impl> m_impl;
+
+        explicit file_reader(std::unique_ptr<impl> state) noexcept;
+
+        public:
+        // Asking for io_uring explicitly fails if it can't be set up,
+        // io_backend::automatic quietly falls back to read. Reading only part
+        // of a file requires a regular file.
+        [[nodiscard]] static auto open(std::filesystem::path const& path,
+                stream_options const& options = {}, byte_range range = {})
+            -> tl::expected<file_reader, io_error>;
+
+        file_reader(file_reader&& other) noexcept;
+        auto operator=(file_reader&& other) noexcept -> file_reader&;
+        ~file_reader();
+
+        // The backend actually in use.
+        [[nodiscard]] auto backend() const noexcept -> io_backend;
+
+        // The next piece of the file, which stays valid until the next call.
+        // Empty once the whole file has been read.
+        [[nodiscard]] auto next() -> tl::expected<std::string_view, io_error>;
+    };
+
+    // Buffers everything written to it and writes full buffers out in order.
+    // With io_uring, writing a buffer only submits the request and returns
+    // right away, the caller only waits once all buffers are in flight.
+    //
+    // Errors of requests that completed in the background surface on the
+    // next call to write or flush.
+    class file_writer {
+        private:
+        struct impl;
+        std::unique_ptr<impl> m_impl;
+
+        explicit file_writer(std::unique_ptr<impl> state) noexcept;
+
+        [[nodiscard]] static auto create(std::unique_ptr<impl> state,
+                stream_options const& options) -> tl::expected<file_writer, io_error>;
+
+        public:
+        // Creates or truncates the file at `path`.
+        [[nodiscard]] static auto open(std::filesystem::path const& path,
+                stream_options const& options = {}) -> tl::expected<file_writer, io_error>;
+        // Opens an existing file, cuts it down to `size` bytes and continues
+        // writing from there.
+        [[nodiscard]] static auto resume(std::filesystem::path const& path, std::uint64_t size,
+                stream_options const& options = {}) -> tl::expected<file_writer, io_error>;
+        // Writes to stdout, which is left open afterwards.
+        [[nodiscard]] static auto standard_output(stream_options const& options = {})
+            -> tl::expected<file_writer, io_error>;
+
+        file_writer(file_writer&& other) noexcept;
+        auto operator=(file_writer&& other) noexcept -> file_writer&;
+        // Flushes, but has no way of reporting errors. Call flush first.
+        ~file_writer();
+
+        [[nodiscard]] auto backend() const noexcept -> io_backend;
+
+        [[nodiscard]] auto write(std::string_view data) -> tl::expected<void, io_error>;
+
+        // Writes out whatever is buffered and waits for all requests.
+        [[nodiscard]] auto flush() -> tl::expected<void, io_error>;
+
+        // Flushes and then waits until the data has reached the disk. Does
+        // nothing more than flush for pipes and terminals.
+        [[nodiscard]] auto sync() -> tl::expected<void, io_error>;
+    };
+} /* namespace solve */
+
+#endif // FILE_IO_HPP
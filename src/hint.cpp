@@ -0,0 +1,74 @@
+#include "hint.hpp"
+#include "propagation.hpp"
+#include "solver.hpp"
+
+using std::literals::string_view_literals::operator""sv;
+
+[[nodiscard]] static auto to_hint(solve::placement p, solve::technique reason) noexcept
+    -> solve::hint {
+
+    return solve::hint{p.cell % 9, p.cell / 9, p.value, reason};
+}
+
+namespace solve {
+    auto technique_to_string(technique t) noexcept -> std::string_view {
+        switch (t) {
+            case technique::naked_single:
+                return "Naked single"sv;
+            case technique::hidden_single:
+                return "Hidden single"sv;
+            case technique::locked_candidates:
+                return "Locked candidates"sv;
+            case technique::search:
+                return "Search"sv;
+            default:
+                return ""sv;
+        }
+    }
+
+    auto next_hint(sudoku const& s) noexcept -> std::optional<hint> {
+        auto grid = candidate_grid(s);
+
+        if (grid.contradiction() || grid.unsolved() == 0) {
+            return std::nullopt;
+        }
+
+        if (auto single = find_naked_single(grid); single.has_value()) {
+            return to_hint(*single, technique::naked_single);
+        }
+
+        if (auto single = find_hidden_single(grid); single.has_value()) {
+            return to_hint(*single, technique::hidden_single);
+        }
+
+        while (!grid.contradiction() && eliminate_locked_candidates(grid)) {
+            auto single = find_naked_single(grid);
+
+            if (!single.has_value()) {
+                single = find_hidden_single(grid);
+            }
+
+            if (single.has_value()) {
+                return to_hint(*single, technique::locked_candidates);
+            }
+        }
+
+        if (grid.contradiction()) {
+            return std::nullopt;
+        }
+
+        // Only the first search on a thread pays for building a matrix.
+        auto const solution = thread_context().solve(s);
+        if (!verify_sudoku(solution)) {
+            return std::nullopt;
+        }
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            if (grid.is_open(cell)) {
+                return to_hint(placement{cell, solution.data[cell]}, technique::search);
+            }
+        }
+
+        return std::nullopt;
+    }
+} /* namespace solve */
@@ -0,0 +1,41 @@
+#ifndef HINT_HPP
+#define HINT_HPP
+
+#include "data.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace solve {
+    // How a hint was arrived at, from the simplest to the most involved.
+    enum class technique : std::uint8_t {
+        naked_single,
+        hidden_single,
+        // A single which only shows up once locked candidates have been
+        // eliminated.
+        locked_candidates,
+        // No logical step applies, the value was looked up in a solution.
+        search
+    };
+
+    [[nodiscard]] auto technique_to_string(technique t) noexcept -> std::string_view;
+
+    struct hint {
+        unsigned x;
+        unsigned y;
+        std::int8_t value;
+        technique reason;
+    };
+
+    // Finds the next cell to fill in, preferring the simplest technique that
+    // yields one. Only if no logical step applies does this fall back to
+    // solving the puzzle. Returns nothing for full grids, for grids whose
+    // givens clash and for grids propagation or the search finds unsolvable.
+    // The solvability of the grid isn't checked otherwise, so an unsolvable
+    // grid may still get a logical hint: a value its givens force, even
+    // though it leads nowhere.
+    [[nodiscard]] auto next_hint(sudoku const& s) noexcept -> std::optional<hint>;
+} /* namespace solve */
+
+#endif // HINT_HPP
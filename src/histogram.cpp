@@ -0,0 +1,115 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+[[nodiscard]] static auto most_significant_bit(std::uint64_t value) noexcept -> unsigned {
+    assert(value != 0 && "Zero has no set bits.");
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    auto result = 0u;
+    while (value >>= 1) {
+        ++result;
+    }
+    return result;
+#endif
+}
+
+namespace solve {
+    auto latency_histogram::bucket_index(std::uint64_t value) noexcept -> unsigned {
+        if (value < 2 * sub_bucket_count) {
+            return static_cast<unsigned>(value);
+        }
+
+        auto const shift = most_significant_bit(value) - sub_bucket_bits;
+        auto const sub_bucket = static_cast<unsigned>(value >> shift) - sub_bucket_count;
+
+        return (shift + 1) * sub_bucket_count + sub_bucket;
+    }
+
+    auto latency_histogram::bucket_lower_bound(unsigned index) noexcept -> std::uint64_t {
+        assert(index < bucket_count && "Bucket index out of range.");
+
+        if (index < 2 * sub_bucket_count) {
+            return index;
+        }
+
+        auto const shift = index / sub_bucket_count - 1;
+        auto const sub_bucket = index % sub_bucket_count;
+
+        return static_cast<std::uint64_t>(sub_bucket_count + sub_bucket) << shift;
+    }
+
+    auto latency_histogram::bucket_upper_bound(unsigned index) noexcept -> std::uint64_t {
+        if (index + 1 == bucket_count) {
+            return UINT64_MAX;
+        }
+
+        return bucket_lower_bound(index + 1) - 1;
+    }
+
+    void latency_histogram::record(std::uint64_t value) noexcept {
+        m_counts[bucket_index(value)] += 1;
+        m_total += 1;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+        m_sum += value;
+    }
+
+    void latency_histogram::merge(latency_histogram const& other) noexcept {
+        for (unsigned i = 0; i < bucket_count; ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+
+        m_total += other.m_total;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_sum += other.m_sum;
+    }
+
+    auto latency_histogram::count() const noexcept -> std::uint64_t {
+        return m_total;
+    }
+
+    auto latency_histogram::count_at(unsigned index) const noexcept -> std::uint64_t {
+        assert(index < bucket_count && "Bucket index out of range.");
+        return m_counts[index];
+    }
+
+    auto latency_histogram::min() const noexcept -> std::uint64_t {
+        return m_total == 0 ? 0 : m_min;
+    }
+
+    auto latency_histogram::max() const noexcept -> std::uint64_t {
+        return m_max;
+    }
+
+    auto latency_histogram::mean() const noexcept -> double {
+        return m_total == 0 ? 0.0 : static_cast<double>(m_sum / m_total);
+    }
+
+    auto latency_histogram::value_at_percentile(double percentile) const noexcept
+        -> std::uint64_t {
+
+        if (m_total == 0) {
+            return 0;
+        }
+
+        auto const clamped = std::clamp(percentile, 0.0, 100.0);
+        auto const rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(
+                    std::ceil(clamped / 100.0 * static_cast<double>(m_total))));
+
+        auto seen = std::uint64_t{0};
+        for (unsigned i = 0; i < bucket_count; ++i) {
+            seen += m_counts[i];
+
+            if (seen >= rank) {
+                return std::min(bucket_upper_bound(i), m_max);
+            }
+        }
+
+        return m_max;
+    }
+} /* namespace solve */
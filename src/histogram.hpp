@@ -0,0 +1,54 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace solve {
+    // Log-linear histogram in the spirit of HdrHistogram: values below 64 get
+    // a bucket each, above that every power of two is split into 32 buckets.
+    // This keeps the relative error of every recorded value under about 3%
+    // across the whole 64 bit range, at a fixed size and O(1) recording.
+    //
+    // A histogram is not thread safe. Give each thread its own and merge
+    // them once the threads are done; the alignment keeps neighbouring
+    // histograms from sharing cache lines.
+    class alignas(64) latency_histogram {
+        public:
+        constexpr static inline auto sub_bucket_bits = 5u;
+        constexpr static inline auto sub_bucket_count = 1u << sub_bucket_bits;
+        constexpr static inline auto bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+        private:
+        std::array<std::uint64_t, bucket_count> m_counts = {};
+        std::uint64_t m_total = 0;
+        std::uint64_t m_min = UINT64_MAX;
+        std::uint64_t m_max = 0;
+        // Kept separately so the mean doesn't suffer from bucketing.
+        long double m_sum = 0;
+
+        public:
+        [[nodiscard]] static auto bucket_index(std::uint64_t value) noexcept -> unsigned;
+        // Smallest value that falls into the given bucket.
+        [[nodiscard]] static auto bucket_lower_bound(unsigned index) noexcept -> std::uint64_t;
+        // Largest value that falls into the given bucket.
+        [[nodiscard]] static auto bucket_upper_bound(unsigned index) noexcept -> std::uint64_t;
+
+        void record(std::uint64_t value) noexcept;
+        void merge(latency_histogram const& other) noexcept;
+
+        [[nodiscard]] auto count() const noexcept -> std::uint64_t;
+        [[nodiscard]] auto count_at(unsigned index) const noexcept -> std::uint64_t;
+        [[nodiscard]] auto min() const noexcept -> std::uint64_t;
+        [[nodiscard]] auto max() const noexcept -> std::uint64_t;
+        [[nodiscard]] auto mean() const noexcept -> double;
+
+        // The value below or at which `percentile` percent of all recorded
+        // values lie, reported as the upper bound of its bucket. Exact for
+        // the maximum.
+        [[nodiscard]] auto value_at_percentile(double percentile) const noexcept
+            -> std::uint64_t;
+    };
+} /* namespace solve */
+
+#endif // HISTOGRAM_HPP
@@ -0,0 +1,140 @@
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+[[nodiscard]] static constexpr auto row_index(unsigned x, unsigned y,
+        std::int8_t value) noexcept -> int {
+
+    return static_cast<int>(value - 1 + x * 9 + y * 9 * 9);
+}
+
+namespace solve {
+    incremental_solver::incremental_solver() {
+        m_covered.reserve(sudoku::field_size);
+    }
+
+    incremental_solver::incremental_solver(sudoku const& s)
+        : incremental_solver() {
+
+        for (unsigned y = 0; y < 9; ++y) {
+            for (unsigned x = 0; x < 9; ++x) {
+                auto const value = s.data[x + 9 * y];
+
+                if (value != sudoku::empty_field) {
+                    // Conflicting givens simply stay empty.
+                    (void)set_cell(x, y, value);
+                }
+            }
+        }
+    }
+
+    auto incremental_solver::grid() const noexcept -> sudoku const& {
+        return m_grid;
+    }
+
+    auto incremental_solver::set_cell(unsigned x, unsigned y, std::int8_t value) -> bool {
+        assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+        assert(value >= 1 && value <= 9 && "Cell value out of range.");
+
+        auto& cell = m_grid.data[x + 9 * y];
+
+        if (cell == value) {
+            return true;
+        }
+
+        auto const previous = cell;
+        if (previous != sudoku::empty_field) {
+            clear_cell(x, y);
+        }
+
+        auto const row = row_index(x, y, value);
+
+        if (!m_list.row_available(row)) {
+            if (previous != sudoku::empty_field) {
+                // The old value was fine before, so it still is.
+                (void)set_cell(x, y, previous);
+            }
+
+            return false;
+        }
+
+        m_list.cover_row(row);
+        m_covered.push_back(row);
+        cell = value;
+        return true;
+    }
+
+    void incremental_solver::clear_cell(unsigned x, unsigned y) {
+        assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+
+        auto& cell = m_grid.data[x + 9 * y];
+
+        if (cell == sudoku::empty_field) {
+            return;
+        }
+
+        auto const row = row_index(x, y, cell);
+        auto const position = std::find(m_covered.begin(), m_covered.end(), row);
+        assert(position != m_covered.end() && "Filled cell without covered row.");
+
+        // Rows have to come off in the reverse order they went on. Clearing
+        // the most recent edit is the common case and touches nothing else;
+        // otherwise, everything above gets peeled off and put back on.
+        for (auto it = m_covered.rbegin(); it.base() != std::next(position); ++it) {
+            m_list.uncover_row(*it);
+        }
+
+        m_list.uncover_row(row);
+
+        for (auto it = std::next(position); it != m_covered.end(); ++it) {
+            m_list.cover_row(*it);
+        }
+
+        m_covered.erase(position);
+        cell = sudoku::empty_field;
+    }
+
+    auto incremental_solver::count_solutions(unsigned limit) -> unsigned {
+        auto cursor = toroidal_list::solution_cursor(m_list);
+        auto count = 0u;
+
+        while (count < limit && cursor.next()) {
+            ++count;
+        }
+
+        return count;
+    }
+
+    auto incremental_solver::is_solvable() -> bool {
+        return count_solutions(1) == 1;
+    }
+
+    auto incremental_solver::has_unique_solution() -> bool {
+        return count_solutions(2) == 1;
+    }
+
+    auto incremental_solver::solution() -> std::optional<sudoku> {
+        auto cursor = toroidal_list::solution_cursor(m_list);
+
+        if (!cursor.next()) {
+            return std::nullopt;
+        }
+
+        auto indices = std::vector<int>();
+        indices.reserve(sudoku::field_size);
+        cursor.current(indices);
+
+        auto result = m_grid;
+        for (auto index : indices) {
+            auto const num = index % 9 + 1;
+            auto const x = (index / 9) % 9;
+            auto const y = index / (9 * 9);
+
+            result.data[x + 9 * y] = static_cast<std::int8_t>(num);
+        }
+
+        return result;
+    }
+} /* namespace solve */
@@ -0,0 +1,42 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include "data.hpp"
+#include "toroidal_list.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace solve {
+    // Keeps the exact cover matrix of a sudoku that's being edited around
+    // between queries. Filling in or clearing a cell only covers or uncovers
+    // that cell's row instead of rebuilding everything, and all queries
+    // leave the matrix as they found it.
+    class incremental_solver {
+        private:
+        toroidal_list m_list;
+        sudoku m_grid;
+        // Rows in the order they were covered in.
+        std::vector<int> m_covered;
+
+        public:
+        incremental_solver();
+        explicit incremental_solver(sudoku const& s);
+
+        [[nodiscard]] auto grid() const noexcept -> sudoku const&;
+
+        // Fills in a cell, replacing whatever value it held before. Fails and
+        // leaves the grid untouched if the value conflicts with another cell.
+        [[nodiscard]] auto set_cell(unsigned x, unsigned y, std::int8_t value) -> bool;
+        void clear_cell(unsigned x, unsigned y);
+
+        // Counts solutions of the current grid, stopping at `limit`.
+        [[nodiscard]] auto count_solutions(unsigned limit) -> unsigned;
+        [[nodiscard]] auto is_solvable() -> bool;
+        [[nodiscard]] auto has_unique_solution() -> bool;
+        [[nodiscard]] auto solution() -> std::optional<sudoku>;
+    };
+} /* namespace solve */
+
+#endif // INCREMENTAL_HPP
@@ -0,0 +1,142 @@
+#include "input.hpp"
+#include "line_index.hpp"
+#include "utility.hpp"
+
+#include <fmt/core.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using std::literals::string_view_literals::operator""sv;
+
+static constexpr auto usage =
+    "Usage: sudoku_index [options] <file>\n"
+    "\n"
+    "Builds <file>.idx, which lets sudoku_solve --shard/--fork split <file> into\n"
+    "shards with the same number of lines, or prints puzzles by line number.\n"
+    "\n"
+    "Options:\n"
+    "  --stride <n>        Record the offset of every n-th line (default 1024)\n"
+    "  --threads <n>       Scan with n threads, 0 for one per hardware thread (default 0)\n"
+    "  --get <i>[-<j>]     Print line i, or lines i to j inclusive, counting from 0,\n"
+    "                      using the existing index instead of building one\n"sv;
+
+struct index_options {
+    std::string_view input;
+    std::uint32_t stride = solve::line_index::default_stride;
+    unsigned threads = 0;
+    std::optional<std::pair<std::uint64_t, std::uint64_t>> get;
+};
+
+static auto parse_arguments(int argc, char const** argv) -> std::optional<index_options> {
+    auto result = index_options();
+
+    for (int i = 1; i < argc; ++i) {
+        auto const arg = std::string_view(argv[i]);
+
+        if (arg == "--stride"sv && i + 1 < argc) {
+            auto const value = solve::util::parse_number<std::uint32_t>(argv[++i]);
+            if (!value.has_value() || *value == 0) {
+                return std::nullopt;
+            }
+
+            result.stride = *value;
+        } else if (arg == "--threads"sv && i + 1 < argc) {
+            auto const value = solve::util::parse_number<unsigned>(argv[++i]);
+            if (!value.has_value()) {
+                return std::nullopt;
+            }
+
+            result.threads = *value;
+        } else if (arg == "--get"sv && i + 1 < argc) {
+            auto const text = std::string_view(argv[++i]);
+            auto const dash = text.find('-');
+            auto const first = solve::util::parse_number<std::uint64_t>(text.substr(0, dash));
+            auto const last = dash == std::string_view::npos ? first
+                : solve::util::parse_number<std::uint64_t>(text.substr(dash + 1));
+
+            if (!first.has_value() || !last.has_value() || *last < *first) {
+                return std::nullopt;
+            }
+
+            result.get = std::pair(*first, *last);
+        } else if (arg.empty() || arg[0] == '-' || !result.input.empty()) {
+            return std::nullopt;
+        } else {
+            result.input = arg;
+        }
+    }
+
+    if (result.input.empty()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+static auto print_lines(std::filesystem::path const& input, std::uint64_t first,
+        std::uint64_t last) -> int {
+
+    auto index = solve::line_index::load(solve::line_index::default_path(input));
+
+    if (index.has_value() && !index->matches(input)) {
+        index = tl::unexpected(solve::io_error(solve::io_error::err_code::FORMAT_ERROR,
+                    fmt::format("The index is out of date, {} has changed since.",
+                        input.string())));
+    }
+
+    auto puzzles = index.and_then([&] (solve::line_index const& loaded) {
+        return solve::read_puzzles(input, loaded, first, last - first + 1);
+    });
+
+    if (!puzzles.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", std::move(puzzles).error());
+        return 1;
+    }
+
+    auto text = std::string();
+    for (auto const& puzzle : *puzzles) {
+        for (auto field : puzzle.data) {
+            text += field == solve::sudoku::empty_field ? '.' : static_cast<char>('0' + field);
+        }
+
+        text += '\n';
+    }
+
+    fmt::print("{}", text);
+    return 0;
+}
+
+auto main(int argc, char const** argv) -> int {
+    auto const options = parse_arguments(argc, argv);
+
+    if (!options.has_value()) {
+        fmt::print(stderr, "{}", usage);
+        return 1;
+    }
+
+    auto const input = std::filesystem::path(options->input);
+
+    if (options->get.has_value()) {
+        return print_lines(input, options->get->first, options->get->second);
+    }
+
+    auto index = solve::line_index::build(input, options->stride, options->threads);
+    auto const saved = index.and_then([&input] (solve::line_index const& built) {
+        return built.save(solve::line_index::default_path(input));
+    });
+
+    if (!saved.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", saved.error());
+        return 1;
+    }
+
+    fmt::print("{} lines, {} samples, written to {}\n", index->line_count(),
+            (index->line_count() + index->stride() - 1) / index->stride(),
+            solve::line_index::default_path(input).string());
+    return 0;
+}
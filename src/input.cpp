@@ -1,4 +1,5 @@
 #include "input.hpp"
+#include "trace.hpp"
 
 #include <fmt/core.h>
 
@@ -24,29 +25,6 @@ static constexpr auto to_board_value(char c) -> std::int8_t {
     return static_cast<std::int8_t>(c - '0');
 }
 
-static auto parse_single_line(std::string_view line)
-    -> tl::expected<solve::sudoku, solve::io_error> {
-
-    if (line.size() != solve::sudoku::field_size) {
-        return tl::unexpected(solve::io_error(solve::io_error::err_code::FORMAT_ERROR,
-                    "Given input line is not 81 characters long."));
-    }
-
-    solve::sudoku s;
-    for (std::size_t i = 0; i < solve::sudoku::field_size; ++i) {
-        auto c = line[i];
-        if (!is_valid_char(c)) {
-            return tl::unexpected(solve::io_error(solve::io_error(
-                        solve::io_error::err_code::FORMAT_ERROR,
-                        fmt::format("Invalid character '{:c}' in input.", c))));
-        }
-
-        s.data[i] = to_board_value(c);
-    } 
-
-    return s;
-}
-
 namespace solve {
     auto io_error::err_code_to_string(solve::io_error::err_code code) noexcept
         -> std::string_view {
@@ -56,6 +34,10 @@ namespace solve {
                 return "No such file"sv;
             case err_code::FORMAT_ERROR:
                 return "Format error"sv;
+            case err_code::READ_ERROR:
+                return "Read error"sv;
+            case err_code::WRITE_ERROR:
+                return "Write error"sv;
             case err_code::UNKNOWN_ERROR:
                 return "Unknown error"sv;
             default:
@@ -76,6 +58,27 @@ namespace solve {
         return m_code;
     }
 
+    auto parse_sudoku(std::string_view line) -> tl::expected<sudoku, io_error> {
+        if (line.size() != sudoku::field_size) {
+            return tl::unexpected(io_error(io_error::err_code::FORMAT_ERROR,
+                        "Given input line is not 81 characters long."));
+        }
+
+        sudoku s;
+        for (std::size_t i = 0; i < sudoku::field_size; ++i) {
+            auto c = line[i];
+            if (!is_valid_char(c)) {
+                return tl::unexpected(io_error(io_error(
+                            io_error::err_code::FORMAT_ERROR,
+                            fmt::format("Invalid character '{:c}' in input.", c))));
+            }
+
+            s.data[i] = to_board_value(c);
+        } 
+
+        return s;
+    }
+
     auto read_from_file(std::filesystem::path const& path)
         -> tl::expected<std::vector<sudoku>, io_error> {
 
@@ -88,7 +91,8 @@ namespace solve {
 
         std::string line; 
         while (std::getline(file, line)) {
-            auto res = parse_single_line(line);
+            auto const parse_scope = trace::scope(trace::phase::parse, results.size());
+            auto res = parse_sudoku(line);
 
             // Oh, how I wish for Rust's `?`...
             if (!res.has_value()) {
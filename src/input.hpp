@@ -18,6 +18,8 @@ namespace solve {
         enum class err_code {
             NO_SUCH_FILE,
             FORMAT_ERROR,
+            READ_ERROR,
+            WRITE_ERROR,
             UNKNOWN_ERROR
         };
 
@@ -34,6 +36,9 @@ namespace solve {
         [[nodiscard]] auto code() const noexcept -> err_code;
     };
 
+    // Parses a single line of 81 characters, without the line break.
+    [[nodiscard]] auto parse_sudoku(std::string_view line) -> tl::expected<sudoku, io_error>;
+
     [[nodiscard]] auto read_from_file(std::filesystem::path const& path) 
         -> tl::expected<std::vector<sudoku>, io_error>;
 } /* namespace solve */
@@ -0,0 +1,279 @@
+#include "lanes.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    struct alignas(32) lane_array : std::array<std::uint16_t, solve::lane_width> {};
+
+    // One 16 bit candidate mask per puzzle. With AVX2 every operation is a
+    // single instruction, elsewhere it's a short loop the compiler is free
+    // to vectorize with whatever it has.
+    struct lane_vector {
+#if defined(__AVX2__)
+        __m256i value;
+
+        [[nodiscard]] static auto broadcast(std::uint16_t mask) noexcept -> lane_vector {
+            return {_mm256_set1_epi16(static_cast<short>(mask))};
+        }
+
+        [[nodiscard]] friend auto operator&(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return {_mm256_and_si256(a.value, b.value)};
+        }
+
+        [[nodiscard]] friend auto operator|(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return {_mm256_or_si256(a.value, b.value)};
+        }
+
+        [[nodiscard]] friend auto operator^(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return {_mm256_xor_si256(a.value, b.value)};
+        }
+
+        // a & ~b
+        [[nodiscard]] friend auto and_not(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return {_mm256_andnot_si256(b.value, a.value)};
+        }
+
+        // All ones in lanes where a == b, zero elsewhere.
+        [[nodiscard]] friend auto equal(lane_vector a, lane_vector b) noexcept -> lane_vector {
+            return {_mm256_cmpeq_epi16(a.value, b.value)};
+        }
+
+        [[nodiscard]] friend auto minus_one(lane_vector a) noexcept -> lane_vector {
+            return {_mm256_add_epi16(a.value, _mm256_set1_epi16(-1))};
+        }
+
+        [[nodiscard]] auto any() const noexcept -> bool {
+            return _mm256_testz_si256(value, value) == 0;
+        }
+
+        [[nodiscard]] static auto load(lane_array const& lanes) noexcept -> lane_vector {
+            return {_mm256_load_si256(reinterpret_cast<__m256i const*>(lanes.data()))};
+        }
+
+        [[nodiscard]] auto lanes() const noexcept -> lane_array {
+            auto result = lane_array();
+            _mm256_store_si256(reinterpret_cast<__m256i*>(result.data()), value);
+            return result;
+        }
+#else
+        lane_array value;
+
+        template <typename Fun>
+        [[nodiscard]] static auto map(Fun const& f) noexcept -> lane_vector {
+            auto result = lane_vector();
+            for (unsigned i = 0; i < solve::lane_width; ++i) {
+                result.value[i] = static_cast<std::uint16_t>(f(i));
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] static auto broadcast(std::uint16_t mask) noexcept -> lane_vector {
+            return map([mask] (unsigned) { return mask; });
+        }
+
+        [[nodiscard]] friend auto operator&(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return map([&] (unsigned i) { return a.value[i] & b.value[i]; });
+        }
+
+        [[nodiscard]] friend auto operator|(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return map([&] (unsigned i) { return a.value[i] | b.value[i]; });
+        }
+
+        [[nodiscard]] friend auto operator^(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return map([&] (unsigned i) { return a.value[i] ^ b.value[i]; });
+        }
+
+        [[nodiscard]] friend auto and_not(lane_vector a, lane_vector b) noexcept
+            -> lane_vector {
+
+            return map([&] (unsigned i) { return a.value[i] & ~b.value[i]; });
+        }
+
+        [[nodiscard]] friend auto equal(lane_vector a, lane_vector b) noexcept -> lane_vector {
+            return map([&] (unsigned i) { return a.value[i] == b.value[i] ? 0xffff : 0; });
+        }
+
+        [[nodiscard]] friend auto minus_one(lane_vector a) noexcept -> lane_vector {
+            return map([&] (unsigned i) { return a.value[i] - 1; });
+        }
+
+        [[nodiscard]] auto any() const noexcept -> bool {
+            auto result = std::uint16_t{0};
+            for (auto v : value) {
+                result |= v;
+            }
+
+            return result != 0;
+        }
+
+        [[nodiscard]] static auto load(lane_array const& lanes) noexcept -> lane_vector {
+            return {lanes};
+        }
+
+        [[nodiscard]] auto lanes() const noexcept -> lane_array {
+            return value;
+        }
+#endif
+    };
+
+    // All ones in lanes holding exactly one digit.
+    [[nodiscard]] auto single(lane_vector v) noexcept -> lane_vector {
+        auto const zero = lane_vector::broadcast(0);
+        return and_not(equal(v & minus_one(v), zero), equal(v, zero));
+    }
+
+    // Candidates of every cell, for every lane.
+    using lane_grid = std::array<lane_vector, solve::sudoku::field_size>;
+
+    // Strikes the digit of every solved cell from its peers. Two peers solved
+    // to the same digit wipe each other out, which the caller notices as an
+    // empty cell.
+    void naked_singles(lane_grid& grid, lane_vector& changed) noexcept {
+        auto solved = lane_grid();
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            solved[cell] = grid[cell] & single(grid[cell]);
+        }
+
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            auto taken = lane_vector::broadcast(0);
+            for (auto peer : solve::cell_peers(cell)) {
+                taken = taken | solved[peer];
+            }
+
+            auto const next = and_not(grid[cell], taken);
+            changed = changed | (next ^ grid[cell]);
+            grid[cell] = next;
+        }
+    }
+
+    // Fixes every digit that fits into only one cell of some unit. Marks
+    // lanes where a unit misses a digit entirely, or where one cell is the
+    // only home of two digits.
+    void hidden_singles(lane_grid& grid, lane_vector& changed,
+            lane_vector& contradiction) noexcept {
+
+        auto const all_digits = lane_vector::broadcast(solve::bitboard::all_digits);
+        auto const all_lanes = lane_vector::broadcast(0xffff);
+        auto const zero = lane_vector::broadcast(0);
+
+        for (unsigned unit = 0; unit < solve::unit_count; ++unit) {
+            auto const& cells = solve::unit_cells(unit);
+            auto once = zero;
+            auto twice = zero;
+
+            for (auto cell : cells) {
+                twice = twice | (once & grid[cell]);
+                once = once | grid[cell];
+            }
+
+            contradiction = contradiction | and_not(all_lanes, equal(once, all_digits));
+
+            auto const exactly_once = and_not(once, twice);
+            if (!exactly_once.any()) {
+                continue;
+            }
+
+            for (auto cell : cells) {
+                auto const forced = grid[cell] & exactly_once;
+                auto const hit = and_not(all_lanes, equal(forced, zero));
+                auto const next = (forced & hit) | and_not(grid[cell], hit);
+
+                contradiction = contradiction | and_not(hit, single(forced));
+                changed = changed | (next ^ grid[cell]);
+                grid[cell] = next;
+            }
+        }
+    }
+} /* namespace */
+
+namespace solve {
+    void propagate_lanes(util::span<sudoku const> puzzles, util::span<sudoku> results,
+            util::span<propagation_result> outcomes) noexcept {
+
+        assert(puzzles.size() <= lane_width && "More puzzles than lanes.");
+        assert(results.size() == puzzles.size() && outcomes.size() == puzzles.size()
+                && "Spans do not match.");
+
+        auto grid = lane_grid();
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            auto lanes = lane_array();
+
+            // Unused lanes hold an empty grid, which gets stuck right away.
+            for (unsigned lane = 0; lane < lane_width; ++lane) {
+                auto const value = lane < puzzles.size() ? puzzles[lane].data[cell]
+                    : sudoku::empty_field;
+
+                // Givens out of range leave the cell without candidates.
+                lanes[lane] = value == sudoku::empty_field ? bitboard::all_digits
+                    : bitboard::digit_mask(value);
+            }
+
+            grid[cell] = lane_vector::load(lanes);
+        }
+
+        auto const zero = lane_vector::broadcast(0);
+        auto const all_lanes = lane_vector::broadcast(0xffff);
+        auto contradiction = zero;
+        auto changed = zero;
+
+        // Naked singles are cheap, so hidden singles only get a turn once
+        // those have run dry.
+        do {
+            changed = zero;
+            naked_singles(grid, changed);
+
+            if (!changed.any()) {
+                hidden_singles(grid, changed, contradiction);
+            }
+        } while (changed.any());
+
+        auto unsolved = zero;
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            contradiction = contradiction | equal(grid[cell], zero);
+            unsolved = unsolved | and_not(all_lanes, single(grid[cell]));
+        }
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            auto const lanes = grid[cell].lanes();
+
+            for (unsigned lane = 0; lane < puzzles.size(); ++lane) {
+                auto const mask = lanes[lane];
+                results[lane].data[cell] = mask != 0 && (mask & (mask - 1)) == 0
+                    ? static_cast<std::int8_t>(util::count_trailing_zeros(mask) + 1)
+                    : sudoku::empty_field;
+            }
+        }
+
+        auto const contradicted = contradiction.lanes();
+        auto const open = unsolved.lanes();
+
+        for (unsigned lane = 0; lane < puzzles.size(); ++lane) {
+            outcomes[lane] = contradicted[lane] != 0 ? propagation_result::contradiction
+                : open[lane] != 0 ? propagation_result::stuck
+                : propagation_result::solved;
+        }
+    }
+} /* namespace solve */
@@ -0,0 +1,27 @@
+#ifndef LANES_HPP
+#define LANES_HPP
+
+#include "data.hpp"
+#include "propagation.hpp"
+#include "utility.hpp"
+
+namespace solve {
+    // Number of puzzles propagated side by side, one per 16 bit lane of a
+    // 256 bit vector.
+    constexpr inline auto lane_width = 16u;
+
+    // Applies naked and hidden singles to up to lane_width puzzles in
+    // lockstep, with the candidates of each cell of all puzzles held in one
+    // vector. Every pass runs until no lane changes any more, so lanes that
+    // finish early just idle along.
+    //
+    // results[i] receives every cell of puzzles[i] that is down to a single
+    // digit, and outcomes[i] whether that is the whole solution. Stuck lanes
+    // still have to go through propagate and the search, which is meant to
+    // be rare for the bulk inputs this is made for. All three spans must be
+    // the same length.
+    void propagate_lanes(util::span<sudoku const> puzzles, util::span<sudoku> results,
+            util::span<propagation_result> outcomes) noexcept;
+} /* namespace solve */
+
+#endif // LANES_HPP
@@ -0,0 +1,381 @@
+#include "line_index.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr char index_magic[8] = {'s', 's', 'o', 'l', 'v', 'i', 'd', 'x'};
+static constexpr auto index_version = std::uint32_t{1};
+static constexpr auto header_size = std::size_t{32};
+
+// Block size for scanning, large enough to keep the number of reads down.
+static constexpr auto scan_block = std::size_t{1} << 20;
+
+template <typename T>
+static void put_le(unsigned char* out, T value) noexcept {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+[[nodiscard]] static auto get_le(unsigned char const* in) noexcept -> T {
+    auto value = T{0};
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(in[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+// Calls `f(position)` for every line break in [begin, end) of the file, in
+// order. Returns false on read errors.
+template <typename Fun>
+[[nodiscard]] static auto for_each_line_break(int fd, std::uint64_t begin, std::uint64_t end,
+        Fun const& f) -> bool {
+
+    auto block = std::make_unique<char[]>(scan_block);
+
+    for (auto position = begin; position < end; ) {
+        auto const wanted = static_cast<std::size_t>(std::min<std::uint64_t>(scan_block,
+                    end - position));
+        auto const got = pread(fd, block.get(), wanted, static_cast<off_t>(position));
+
+        if (got <= 0) {
+            return false;
+        }
+
+        auto const* const data = block.get();
+        auto const* const data_end = data + got;
+
+        for (auto const* it = data; (it = static_cast<char const*>(
+                        std::memchr(it, '\n', static_cast<std::size_t>(data_end - it))));
+                ++it) {
+
+            f(position + static_cast<std::uint64_t>(it - data));
+        }
+
+        position += static_cast<std::uint64_t>(got);
+    }
+
+    return true;
+}
+
+namespace solve {
+    auto line_index::build(std::filesystem::path const& path, std::uint32_t stride,
+            unsigned threads) -> tl::expected<line_index, io_error> {
+
+        auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE));
+        }
+
+        auto error = std::error_code();
+        auto const size = static_cast<std::uint64_t>(std::filesystem::file_size(path, error));
+        if (error) {
+            close(fd);
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        fmt::format("Could not get the size of {}.", path.string())));
+        }
+
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // No point in threads that only get a few bytes each.
+        auto const parts = static_cast<unsigned>(std::clamp<std::uint64_t>(
+                    size / scan_block, 1, threads));
+        auto const part_begin = [size, parts] (unsigned part) {
+            return size / parts * part + size % parts * part / parts;
+        };
+
+        auto run_parts = [&] (auto const& f) {
+            auto workers = std::vector<std::thread>();
+            auto ok = std::vector<char>(parts, 0);
+
+            for (unsigned part = 1; part < parts; ++part) {
+                workers.emplace_back([&, part] {
+                    ok[part] = f(part);
+                });
+            }
+
+            ok[0] = f(0u);
+
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            return std::all_of(ok.begin(), ok.end(), [] (char c) { return c != 0; });
+        };
+
+        // First count the line breaks in each part to learn where the line
+        // numbers of each part start...
+        auto breaks = std::vector<std::uint64_t>(parts + 1, 0);
+        auto const counted = run_parts([&] (unsigned part) {
+            return for_each_line_break(fd, part_begin(part), part_begin(part + 1),
+                    [&breaks, part] (std::uint64_t) { ++breaks[part + 1]; });
+        });
+
+        for (unsigned part = 0; part < parts; ++part) {
+            breaks[part + 1] += breaks[part];
+        }
+
+        auto index = line_index();
+        index.m_stride = std::max<std::uint32_t>(stride, 1);
+        index.m_file_size = size;
+
+        // A last line without a line break still counts.
+        auto last = char{'\n'};
+        if (size > 0 && pread(fd, &last, 1, static_cast<off_t>(size - 1)) != 1) {
+            close(fd);
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        fmt::format("Could not read {}.", path.string())));
+        }
+
+        index.m_line_count = breaks[parts] + (last != '\n' ? 1 : 0);
+        index.m_offsets.assign((index.m_line_count + index.m_stride - 1) / index.m_stride, 0);
+
+        // ...then go over them again and note where every sampled line
+        // starts, which is right after the line break before it.
+        auto const sampled = counted && run_parts([&] (unsigned part) {
+            auto line = breaks[part];
+
+            return for_each_line_break(fd, part_begin(part), part_begin(part + 1),
+                    [&index, &line] (std::uint64_t position) {
+                        ++line;
+
+                        if (line % index.m_stride == 0 && line < index.m_line_count) {
+                            index.m_offsets[line / index.m_stride] = position + 1;
+                        }
+                    });
+        });
+
+        close(fd);
+
+        if (!sampled) {
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        fmt::format("Could not read {}.", path.string())));
+        }
+
+        return index;
+    }
+
+    auto line_index::load(std::filesystem::path const& path)
+        -> tl::expected<line_index, io_error> {
+
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+                std::fopen(path.c_str(), "rb"), &std::fclose);
+
+        if (file == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE));
+        }
+
+        unsigned char header[header_size];
+        auto index = line_index();
+        auto const invalid = tl::unexpected(io_error(io_error::err_code::FORMAT_ERROR,
+                    fmt::format("{} is not a line index.", path.string())));
+
+        if (std::fread(header, 1, header_size, file.get()) != header_size
+                || std::memcmp(header, index_magic, sizeof(index_magic)) != 0
+                || get_le<std::uint32_t>(header + 8) != index_version) {
+            return invalid;
+        }
+
+        index.m_stride = get_le<std::uint32_t>(header + 12);
+        index.m_line_count = get_le<std::uint64_t>(header + 16);
+        index.m_file_size = get_le<std::uint64_t>(header + 24);
+
+        if (index.m_stride == 0) {
+            return invalid;
+        }
+
+        auto const count = index.m_line_count / index.m_stride
+            + (index.m_line_count % index.m_stride != 0 ? 1 : 0);
+
+        // The header must account for the rest of the file exactly, before
+        // anything is allocated based on it.
+        auto error = std::error_code();
+        auto const file_size = std::filesystem::file_size(path, error);
+
+        if (error || file_size < header_size
+                || (file_size - header_size) / sizeof(std::uint64_t) != count
+                || (file_size - header_size) % sizeof(std::uint64_t) != 0) {
+            return invalid;
+        }
+
+        auto raw = std::vector<unsigned char>(count * sizeof(std::uint64_t));
+
+        if (std::fread(raw.data(), 1, raw.size(), file.get()) != raw.size()) {
+            return invalid;
+        }
+
+        index.m_offsets.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            index.m_offsets[i] = get_le<std::uint64_t>(raw.data() + i * sizeof(std::uint64_t));
+        }
+
+        return index;
+    }
+
+    auto line_index::save(std::filesystem::path const& path) const
+        -> tl::expected<void, io_error> {
+
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+                std::fopen(path.c_str(), "wb"), &std::fclose);
+
+        if (file == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not open {} for writing.", path.string())));
+        }
+
+        unsigned char header[header_size];
+        std::memcpy(header, index_magic, sizeof(index_magic));
+        put_le(header + 8, index_version);
+        put_le(header + 12, m_stride);
+        put_le(header + 16, m_line_count);
+        put_le(header + 24, m_file_size);
+
+        auto raw = std::vector<unsigned char>(m_offsets.size() * sizeof(std::uint64_t));
+        for (std::size_t i = 0; i < m_offsets.size(); ++i) {
+            put_le(raw.data() + i * sizeof(std::uint64_t), m_offsets[i]);
+        }
+
+        if (std::fwrite(header, 1, header_size, file.get()) != header_size
+                || std::fwrite(raw.data(), 1, raw.size(), file.get()) != raw.size()
+                || std::fflush(file.get()) != 0) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not write {}.", path.string())));
+        }
+
+        return {};
+    }
+
+    auto line_index::default_path(std::filesystem::path const& file) -> std::filesystem::path {
+        auto result = file;
+        result += ".idx";
+        return result;
+    }
+
+    auto line_index::stride() const noexcept -> std::uint32_t {
+        return m_stride;
+    }
+
+    auto line_index::line_count() const noexcept -> std::uint64_t {
+        return m_line_count;
+    }
+
+    auto line_index::file_size() const noexcept -> std::uint64_t {
+        return m_file_size;
+    }
+
+    auto line_index::matches(std::filesystem::path const& path) const -> bool {
+        auto error = std::error_code();
+        auto const size = std::filesystem::file_size(path, error);
+        return !error && size == m_file_size;
+    }
+
+    auto line_index::sampled_range(std::uint64_t first, std::uint64_t last) const noexcept
+        -> byte_range {
+
+        auto const sample_offset = [this] (std::uint64_t sample) {
+            return sample < m_offsets.size() ? m_offsets[sample] : m_file_size;
+        };
+
+        return byte_range{sample_offset(first / m_stride),
+            sample_offset((last + m_stride - 1) / m_stride)};
+    }
+
+    auto line_index::shard(unsigned index, unsigned count) const noexcept -> byte_range {
+        auto const first = shard_first_line(index, count);
+        auto const last = shard_first_line(index + 1, count);
+
+        // Both are multiples of the stride, so the range is exact.
+        return sampled_range(first, last);
+    }
+
+    auto line_index::shard_first_line(unsigned index, unsigned count) const noexcept
+        -> std::uint64_t {
+
+        auto const samples = static_cast<std::uint64_t>(m_offsets.size());
+        auto const sample = samples / count * index + samples % count * index / count;
+
+        return std::min(sample * m_stride, m_line_count);
+    }
+
+    auto read_puzzles(std::filesystem::path const& path, line_index const& index,
+            std::uint64_t first, std::uint64_t count)
+        -> tl::expected<std::vector<sudoku>, io_error> {
+
+        auto const last = std::min(first + count, index.line_count());
+        auto puzzles = std::vector<sudoku>();
+
+        if (first >= last) {
+            return puzzles;
+        }
+
+        auto const range = index.sampled_range(first, last);
+        auto text = std::string(static_cast<std::size_t>(range.end - range.begin), '\0');
+
+        auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return tl::unexpected(io_error(io_error::err_code::NO_SUCH_FILE));
+        }
+
+        auto const got = pread(fd, text.data(), text.size(), static_cast<off_t>(range.begin));
+        close(fd);
+
+        if (got != static_cast<ssize_t>(text.size())) {
+            return tl::unexpected(io_error(io_error::err_code::READ_ERROR,
+                        fmt::format("Could not read {}, has it changed since it was "
+                            "indexed?", path.string())));
+        }
+
+        auto rest = std::string_view(text);
+        auto line = first / index.stride() * index.stride();
+
+        for (; line < last && !rest.empty(); ++line) {
+            auto const end = std::min(rest.find('\n'), rest.size());
+
+            if (line >= first) {
+                auto parsed = parse_sudoku(rest.substr(0, end));
+
+                if (!parsed.has_value()) {
+                    return tl::unexpected(io_error(parsed.error().code(),
+                                fmt::format("Line {}: {}", line + 1,
+                                    parsed.error().details().value_or(""))));
+                }
+
+                puzzles.push_back(*parsed);
+            }
+
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+        }
+
+        return puzzles;
+    }
+
+    auto read_puzzle(std::filesystem::path const& path, line_index const& index,
+            std::uint64_t line) -> tl::expected<sudoku, io_error> {
+
+        auto puzzles = read_puzzles(path, index, line, 1);
+
+        if (!puzzles.has_value()) {
+            return tl::unexpected(std::move(puzzles).error());
+        } else if (puzzles->empty()) {
+            return tl::unexpected(io_error(io_error::err_code::FORMAT_ERROR,
+                        fmt::format("There is no line {}.", line + 1)));
+        }
+
+        return puzzles->front();
+    }
+} /* namespace solve */
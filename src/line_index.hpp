@@ -0,0 +1,89 @@
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include "data.hpp"
+#include "file_io.hpp"
+#include "input.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace solve {
+    // Byte offsets of every `stride`-th line of a text file, so that any line
+    // can be found with a single seek and a read of at most `stride` lines.
+    //
+    // On disk, an index is a 32 byte header followed by the sampled offsets,
+    // all as little endian integers:
+    //
+    //     char[8]  magic "ssolvidx"
+    //     uint32   version, currently 1
+    //     uint32   stride
+    //     uint64   number of lines
+    //     uint64   size of the indexed file in bytes
+    //     uint64[] offset of line 0, stride, 2 * stride, ...
+    class line_index {
+        private:
+        std::uint32_t m_stride = 1;
+        std::uint64_t m_line_count = 0;
+        std::uint64_t m_file_size = 0;
+        std::vector<std::uint64_t> m_offsets;
+
+        public:
+        constexpr static inline auto default_stride = std::uint32_t{1024};
+
+        // Scans `path` on `threads` threads, zero meaning one per hardware
+        // thread. Every thread counts the lines in its own part of the file,
+        // then the parts are scanned again to pick out the sampled lines.
+        [[nodiscard]] static auto build(std::filesystem::path const& path,
+                std::uint32_t stride = default_stride, unsigned threads = 0)
+            -> tl::expected<line_index, io_error>;
+
+        [[nodiscard]] static auto load(std::filesystem::path const& path)
+            -> tl::expected<line_index, io_error>;
+
+        [[nodiscard]] auto save(std::filesystem::path const& path) const
+            -> tl::expected<void, io_error>;
+
+        // Where the index of a file is looked for by default.
+        [[nodiscard]] static auto default_path(std::filesystem::path const& file)
+            -> std::filesystem::path;
+
+        [[nodiscard]] auto stride() const noexcept -> std::uint32_t;
+        [[nodiscard]] auto line_count() const noexcept -> std::uint64_t;
+        [[nodiscard]] auto file_size() const noexcept -> std::uint64_t;
+
+        // Whether this index still describes the file at `path`, judged by
+        // its size.
+        [[nodiscard]] auto matches(std::filesystem::path const& path) const -> bool;
+
+        // Bytes holding the sampled lines from the one at or before `first`
+        // up to the one after `last`, exclusive. Lines [first, last) are
+        // somewhere in there.
+        [[nodiscard]] auto sampled_range(std::uint64_t first, std::uint64_t last) const noexcept
+            -> byte_range;
+
+        // Splits the lines into `count` shards whose sizes differ by at most
+        // `stride` lines, and returns the byte range of the one with the
+        // given index. Unlike shard_range, this needs no reads at all and
+        // balances lines rather than bytes.
+        [[nodiscard]] auto shard(unsigned index, unsigned count) const noexcept -> byte_range;
+
+        // The number of the first line in the given shard.
+        [[nodiscard]] auto shard_first_line(unsigned index, unsigned count) const noexcept
+            -> std::uint64_t;
+    };
+
+    // Reads and parses lines [first, first + count) of `path`, counting from
+    // 0, with a single read. Stops early at the end of the file.
+    [[nodiscard]] auto read_puzzles(std::filesystem::path const& path,
+            line_index const& index, std::uint64_t first, std::uint64_t count)
+        -> tl::expected<std::vector<sudoku>, io_error>;
+
+    [[nodiscard]] auto read_puzzle(std::filesystem::path const& path,
+            line_index const& index, std::uint64_t line) -> tl::expected<sudoku, io_error>;
+} /* namespace solve */
+
+#endif // LINE_INDEX_HPP
@@ -1,41 +1,503 @@
+#include "affinity.hpp"
+#include "cli.hpp"
+#include "file_io.hpp"
+#include "histogram.hpp"
 #include "input.hpp"
-#include "solver.hpp"
+#include "line_index.hpp"
+#include "pipeline.hpp"
+#include "solution_store.hpp"
+#include "trace.hpp"
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
 
-static auto to_string(solve::sudoku const& s) -> std::string {
-    auto result = std::string();
-    result.reserve(81);
+#include <sys/wait.h>
+#include <unistd.h>
 
-    for (auto val : s.data) {
-        result.push_back(val + '0');
+// Percentiles reported by --latency, in percent.
+static constexpr double report_percentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+static void print_latency_report(solve::latency_histogram const& latency,
+        double wall_seconds) {
+
+    auto const to_us = [] (auto ns) {
+        return static_cast<double>(ns) / 1000.0;
+    };
+
+    fmt::print(stderr, "Solved {} puzzles in {:.3f} s ({:.0f} puzzles/s)\n",
+            latency.count(), wall_seconds,
+            wall_seconds > 0 ? latency.count() / wall_seconds : 0.0);
+    fmt::print(stderr, "Latency (us): mean {:.2f}", to_us(latency.mean()));
+
+    for (auto p : report_percentiles) {
+        fmt::print(stderr, ", p{} {:.2f}", p, to_us(latency.value_at_percentile(p)));
     }
 
-    return result;
+    fmt::print(stderr, ", max {:.2f}\n", to_us(latency.max()));
 }
 
-auto main(int argc, char const** argv) -> int {
-    if (argc != 2) {
-        fmt::print(stderr, "Incorrect number of arguments: {:d} arguments given, "
-                "but one expected. Invoke the program with a single data file "
-                "path as argument.", argc - 1);
+static auto write_latency_json(std::filesystem::path const& path,
+        solve::latency_histogram const& latency, double wall_seconds) -> bool {
+
+    auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+            std::fopen(path.c_str(), "w"), &std::fclose);
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    fmt::print(file.get(), "{{\n  \"count\": {},\n  \"wall_seconds\": {:.6f},\n"
+            "  \"puzzles_per_second\": {:.1f},\n  \"min_ns\": {},\n  \"mean_ns\": {:.1f},\n",
+            latency.count(), wall_seconds,
+            wall_seconds > 0 ? latency.count() / wall_seconds : 0.0,
+            latency.min(), latency.mean());
+
+    fmt::print(file.get(), "  \"percentiles_ns\": {{");
+    auto first = true;
+    for (auto p : report_percentiles) {
+        fmt::print(file.get(), "{}\"p{}\": {}", first ? "" : ", ", p,
+                latency.value_at_percentile(p));
+        first = false;
+    }
+
+    fmt::print(file.get(), "}},\n  \"max_ns\": {},\n  \"buckets\": [", latency.max());
+
+    // Only non-empty buckets, as [lowest value, highest value, count].
+    first = true;
+    for (unsigned i = 0; i < solve::latency_histogram::bucket_count; ++i) {
+        if (latency.count_at(i) == 0) {
+            continue;
+        }
+
+        fmt::print(file.get(), "{}[{}, {}, {}]", first ? "" : ", ",
+                solve::latency_histogram::bucket_lower_bound(i),
+                solve::latency_histogram::bucket_upper_bound(i), latency.count_at(i));
+        first = false;
+    }
+
+    fmt::print(file.get(), "]\n}}\n");
+    return std::ferror(file.get()) == 0;
+}
+
+// The index next to the input, if there is one that is still up to date.
+static auto load_index(std::filesystem::path const& input) -> std::optional<solve::line_index> {
+    auto index = solve::line_index::load(solve::line_index::default_path(input));
+
+    if (!index.has_value() || !index->matches(input)) {
+        return std::nullopt;
+    }
+
+    return std::move(index).value();
+}
+
+// Part of the input and the number of lines before it. That number is only
+// known with an index; without one, lines are counted from the start of the
+// shard, and errors name the shard instead.
+struct input_shard {
+    solve::byte_range range;
+    std::uint64_t first_line = 0;
+};
+
+// Shards by the index if there is one, which balances lines rather than
+// bytes and needs no reads, and by searching for line breaks otherwise.
+static auto find_shard(std::optional<solve::line_index> const& index,
+        std::filesystem::path const& input, unsigned k, unsigned count)
+    -> tl::expected<input_shard, solve::io_error> {
+
+    if (index.has_value()) {
+        return input_shard{index->shard(k, count), index->shard_first_line(k, count)};
+    }
+
+    return solve::shard_range(input, k, count).map([] (solve::byte_range range) {
+        return input_shard{range};
+    });
+}
+
+// Solves the lines of the input within `shard` and writes the solutions to
+// `output`, or stdout if there is none. Reports go to stderr, prefixed with
+// `label` if that isn't empty.
+static auto run(solve::cli::options const& options, input_shard const& shard,
+        std::optional<std::filesystem::path> const& output, unsigned threads,
+        std::string_view label) -> int {
+
+    auto range = shard.range;
+
+    auto const report_error = [label] (auto const& error) {
+        fmt::print(stderr, "An error occured{}{}:\n{}", label.empty() ? "" : " in ",
+                label, error);
+    };
+
+    if (options.trace.has_value()) {
+        solve::trace::enable();
+    }
+
+    if (options.perf_counters) {
+        solve::trace::enable_counters();
+    }
+
+    // Pinning the main thread before anything is allocated puts the I/O
+    // buffers on its node, the workers take care of their own memory.
+    auto const cpus = options.pin ? solve::allowed_cpus() : std::vector<unsigned>();
+    if (!cpus.empty()) {
+        solve::pin_current_thread(cpus.front());
+    }
+
+    auto pipeline_options = solve::pipeline_options();
+    pipeline_options.batch.thread_count = threads;
+    pipeline_options.batch.variant = options.variant;
+    pipeline_options.batch.cpus = cpus;
+    pipeline_options.checkpoint_path = options.checkpoint;
+    pipeline_options.start.input_offset = range.begin;
+    pipeline_options.start.line = shard.first_line;
+
+    if (options.checkpoint.has_value()) {
+        auto error = std::error_code();
+        pipeline_options.start.input_size = std::filesystem::file_size(options.input, error);
+
+        if (error) {
+            report_error(solve::io_error(solve::io_error::err_code::NO_SUCH_FILE));
+            return 1;
+        }
+    }
+
+    if (options.resume) {
+        auto saved = solve::read_checkpoint(*options.checkpoint);
+
+        if (!saved.has_value()) {
+            report_error(std::move(saved).error());
+            return 1;
+        }
+
+        if (saved->input_size != pipeline_options.start.input_size
+                || saved->input_offset < range.begin || saved->input_offset > range.end) {
+            report_error(solve::io_error(solve::io_error::err_code::FORMAT_ERROR,
+                        fmt::format("{} doesn't belong to this input.",
+                            options.checkpoint->string())));
+            return 1;
+        }
+
+        pipeline_options.start = *saved;
+        range.begin = saved->input_offset;
+    }
+
+    auto store = std::optional<solve::solution_store>();
+
+    if (options.store.has_value()) {
+        auto opened = solve::solution_store::open(*options.store);
+
+        if (!opened.has_value()) {
+            report_error(std::move(opened).error());
+            return 1;
+        }
+
+        store = std::move(opened).value();
+        pipeline_options.store = &*store;
+
+        // Forked children race for the lock, so only one of them ever writes.
+        if (!store->writable() && label.empty()) {
+            fmt::print(stderr, "{} is being written by another process, new solutions "
+                    "won't be recorded.\n", options.store->string());
+        }
+    }
+
+    auto stream_options = solve::stream_options();
+    stream_options.backend = options.io;
+
+    auto input = solve::file_reader::open(options.input, stream_options, range);
+    auto writer = !output.has_value() ? solve::file_writer::standard_output(stream_options)
+        : options.resume ? solve::file_writer::resume(*output,
+                pipeline_options.start.output_size, stream_options)
+        : solve::file_writer::open(*output, stream_options);
+
+    if (!input.has_value() || !writer.has_value()) {
+        report_error(!input.has_value() ? input.error() : writer.error());
         return 1;
-    } 
+    }
 
-    auto result = solve::read_from_file(std::filesystem::path(argv[1])); 
+    auto latency = solve::latency_histogram();
+
+    if (options.latency) {
+        pipeline_options.batch.latency = &latency;
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    auto result = solve::solve_stream(*input, *writer, pipeline_options);
+
+    if (result.has_value()) {
+        if (auto flushed = writer->flush(); !flushed.has_value()) {
+            result = tl::unexpected(std::move(flushed).error());
+        }
+    }
+
+    auto const wall_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+    if (!result.has_value()) {
+        report_error(std::move(result).error());
+        return 1;
+    }
+
+    if (!label.empty() && (options.latency || options.perf_counters)) {
+        fmt::print(stderr, "{}:\n", label);
+    }
+
+    if (options.latency) {
+        print_latency_report(latency, wall_seconds);
+    }
+
+    if (options.perf_counters) {
+        fmt::print(stderr, "{}", solve::trace::format_counter_report(
+                    solve::trace::collect_counters()));
+    }
+
+    if (options.latency_json.has_value()
+            && !write_latency_json(*options.latency_json, latency, wall_seconds)) {
+
+        report_error(solve::io_error(solve::io_error::err_code::WRITE_ERROR,
+                    fmt::format("Could not write {}.", options.latency_json->string())));
+        return 1;
+    }
+
+    if (options.trace.has_value()) {
+        auto written = solve::trace::write_chrome_json(*options.trace);
+
+        if (!written.has_value()) {
+            report_error(std::move(written).error());
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Checks the solutions in `options.verify` against the puzzles in the input
+// and writes every line that doesn't match to the output, or stdout if there
+// is none. Fails if any line doesn't match.
+static auto run_verify(solve::cli::options const& options) -> int {
+    auto stream_options = solve::stream_options();
+    stream_options.backend = options.io;
+
+    auto puzzles = solve::file_reader::open(options.input, stream_options);
+    auto solutions = solve::file_reader::open(*options.verify, stream_options);
+    auto writer = options.output.has_value()
+        ? solve::file_writer::open(*options.output, stream_options)
+        : solve::file_writer::standard_output(stream_options);
+
+    if (!puzzles.has_value() || !solutions.has_value() || !writer.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", !puzzles.has_value() ? puzzles.error()
+                : !solutions.has_value() ? solutions.error() : writer.error());
+        return 1;
+    }
+
+    auto pipeline_options = solve::pipeline_options();
+    pipeline_options.batch.thread_count = 0;
+    pipeline_options.batch.variant = options.variant;
+
+    auto result = solve::verify_stream(*puzzles, *solutions, *writer, pipeline_options);
+
+    if (result.has_value()) {
+        if (auto flushed = writer->flush(); !flushed.has_value()) {
+            result = tl::unexpected(std::move(flushed).error());
+        }
+    }
 
     if (!result.has_value()) {
         fmt::print(stderr, "An error occured:\n{}", std::move(result).error());
         return 1;
     }
 
-    auto data = std::move(result).value();
-    for (auto const& s : data) {
-        auto res = solve::solve_sudoku(s);
-        fmt::print("{}\n", to_string(res));
+    fmt::print(stderr, "Checked {} lines, {} did not match.\n", result->lines,
+            result->mismatches);
+    return result->mismatches == 0 ? 0 : 1;
+}
+
+// Solves the input in `options.fork` child processes, one shard each, and
+// concatenates their output in order once all of them have succeeded. The
+// children split the hardware threads between them. With --pin, each child
+// is confined to its own slice of the CPUs, which is one NUMA node per child
+// when there are as many children as nodes.
+static auto run_forked(solve::cli::options const& options) -> int {
+    auto const count = options.fork;
+    auto const index = load_index(options.input);
+    auto shards = std::vector<input_shard>();
+
+    for (unsigned k = 0; k < count; ++k) {
+        auto shard = find_shard(index, options.input, k, count);
+
+        if (!shard.has_value()) {
+            fmt::print(stderr, "An error occured:\n{}", std::move(shard).error());
+            return 1;
+        }
+
+        shards.push_back(*shard);
+    }
+
+    // Next to the final output if there is one, so that large outputs don't
+    // have to fit into a tmpfs.
+    auto const directory = options.output.has_value()
+        ? std::filesystem::absolute(*options.output).parent_path()
+        : std::filesystem::temp_directory_path();
+    auto parts = std::vector<std::filesystem::path>();
+
+    auto const remove_parts = [&parts] {
+        auto error = std::error_code();
+        for (auto const& part : parts) {
+            std::filesystem::remove(part, error);
+        }
+    };
+
+    for (unsigned k = 0; k < count; ++k) {
+        auto name = (directory / ".sudoku_solve.XXXXXX").string();
+        auto const fd = mkstemp(name.data());
+
+        if (fd == -1) {
+            fmt::print(stderr, "An error occured:\nIO Error: {}: Could not create a "
+                    "temporary file in {}.", solve::io_error::err_code_to_string(
+                        solve::io_error::err_code::WRITE_ERROR), directory.string());
+            remove_parts();
+            return 1;
+        }
+
+        close(fd);
+        parts.emplace_back(std::move(name));
+    }
+
+    auto const threads = std::max(std::thread::hardware_concurrency() / count, 1u);
+    auto const cpus = options.pin ? solve::allowed_cpus() : std::vector<unsigned>();
+    auto children = std::vector<pid_t>();
+    auto failed = false;
+
+    // Nothing buffered may be written twice.
+    std::fflush(nullptr);
+
+    for (unsigned k = 0; k < count && !failed; ++k) {
+        auto const pid = fork();
+
+        if (pid == 0) {
+            auto child_threads = threads;
+
+            if (cpus.size() >= count) {
+                auto const begin = cpus.size() * k / count;
+                auto const end = cpus.size() * (k + 1) / count;
+
+                if (solve::pin_current_thread(solve::util::span<unsigned const>(
+                                cpus.data() + begin, end - begin))) {
+                    // The workers get one CPU each out of the slice.
+                    child_threads = 0;
+                }
+            }
+
+            auto const label = fmt::format("shard {}/{}", k, count);
+            auto const code = run(options, shards[k], parts[k], child_threads, label);
+
+            std::fflush(nullptr);
+            _exit(code);
+        } else if (pid < 0) {
+            fmt::print(stderr, "An error occured:\nCould not fork: {}\n",
+                    std::strerror(errno));
+            failed = true;
+        } else {
+            children.push_back(pid);
+        }
     }
+
+    for (auto pid : children) {
+        auto status = 0;
+        while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+
+        failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+
+    if (failed) {
+        remove_parts();
+        return 1;
+    }
+
+    auto stream_options = solve::stream_options();
+    stream_options.backend = options.io;
+
+    auto writer = options.output.has_value()
+        ? solve::file_writer::open(*options.output, stream_options)
+        : solve::file_writer::standard_output(stream_options);
+    auto result = writer.has_value() ? tl::expected<void, solve::io_error>()
+        : tl::unexpected(writer.error());
+
+    for (std::size_t k = 0; k < parts.size() && result.has_value(); ++k) {
+        auto reader = solve::file_reader::open(parts[k], stream_options);
+
+        if (!reader.has_value()) {
+            result = tl::unexpected(std::move(reader).error());
+            break;
+        }
+
+        for (auto piece = reader->next(); result.has_value(); piece = reader->next()) {
+            if (!piece.has_value()) {
+                result = tl::unexpected(std::move(piece).error());
+            } else if (piece->empty()) {
+                break;
+            } else {
+                result = writer->write(*piece);
+            }
+        }
+    }
+
+    if (result.has_value()) {
+        result = writer->flush();
+    }
+
+    remove_parts();
+
+    if (!result.has_value()) {
+        fmt::print(stderr, "An error occured:\n{}", std::move(result).error());
+        return 1;
+    }
+
+    return 0;
+}
+
+auto main(int argc, char const** argv) -> int {
+    auto options = solve::cli::parse_arguments(argc, argv);
+
+    if (!options.has_value()) {
+        fmt::print(stderr, "{}\n\n{}", options.error(), solve::cli::usage());
+        return 1;
+    }
+
+    if (options->verify.has_value()) {
+        return run_verify(*options);
+    }
+
+    if (options->fork > 0) {
+        return run_forked(*options);
+    }
+
+    auto part = input_shard();
+
+    if (options->shard.has_value()) {
+        auto shard = find_shard(load_index(options->input), options->input,
+                options->shard->index, options->shard->count);
+
+        if (!shard.has_value()) {
+            fmt::print(stderr, "An error occured:\n{}", std::move(shard).error());
+            return 1;
+        }
+
+        part = *shard;
+    }
+
+    return run(*options, part, options->output, 0, "");
 }
@@ -0,0 +1,144 @@
+#include "perf_counters.hpp"
+
+#include <iterator>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define SSOLVE_HAS_PERF_EVENT 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define SSOLVE_HAS_PERF_EVENT 0
+#endif
+
+using std::literals::string_view_literals::operator""sv;
+
+#if SSOLVE_HAS_PERF_EVENT
+struct event_config {
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+// Indexed by solve::perf::counter. LLC misses use the generic cache miss
+// event, which the kernel maps to last level cache misses on x86 and most
+// other architectures.
+static constexpr event_config event_configs[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static_assert(std::size(event_configs) == solve::perf::counter_count);
+
+[[nodiscard]] static auto open_event(event_config const& event, int group) noexcept -> int {
+    auto attr = perf_event_attr();
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // Only the leader starts disabled, the whole group is enabled at once.
+    attr.disabled = group == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+#endif
+
+namespace solve::perf {
+    auto counter_to_string(counter c) noexcept -> std::string_view {
+        switch (c) {
+            case counter::cycles:
+                return "cycles"sv;
+            case counter::instructions:
+                return "instructions"sv;
+            case counter::l1d_misses:
+                return "L1d misses"sv;
+            case counter::llc_misses:
+                return "LLC misses"sv;
+            case counter::branch_misses:
+                return "branch misses"sv;
+            default:
+                return ""sv;
+        }
+    }
+
+    thread_counters::thread_counters() noexcept {
+        m_fds.fill(-1);
+        m_slots.fill(-1);
+
+#if SSOLVE_HAS_PERF_EVENT
+        for (std::size_t i = 0; i < counter_count; ++i) {
+            // Whichever counter opens first leads the group, a missing cycle
+            // counter shouldn't take the others down with it.
+            auto const fd = open_event(event_configs[i], m_leader);
+
+            if (fd < 0) {
+                continue;
+            }
+
+            if (m_leader == -1) {
+                m_leader = fd;
+            }
+
+            m_fds[i] = fd;
+            m_slots[i] = m_open++;
+        }
+
+        if (m_leader != -1) {
+            ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    thread_counters::~thread_counters() {
+#if SSOLVE_HAS_PERF_EVENT
+        for (auto fd : m_fds) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    auto thread_counters::available(counter c) const noexcept -> bool {
+        return m_slots[static_cast<std::size_t>(c)] != -1;
+    }
+
+    auto thread_counters::any_available() const noexcept -> bool {
+        return m_leader != -1;
+    }
+
+    auto thread_counters::read() const noexcept -> sample {
+        auto result = sample();
+
+#if SSOLVE_HAS_PERF_EVENT
+        if (m_leader == -1) {
+            return result;
+        }
+
+        // With PERF_FORMAT_GROUP the kernel hands out the number of events
+        // followed by their values in the order they joined the group.
+        std::uint64_t buffer[1 + counter_count] = {};
+        auto const expected = static_cast<ssize_t>((1 + m_open) * sizeof(std::uint64_t));
+
+        if (::read(m_leader, buffer, sizeof(buffer)) != expected) {
+            return result;
+        }
+
+        for (std::size_t i = 0; i < counter_count; ++i) {
+            if (m_slots[i] != -1) {
+                result.values[i] = buffer[1 + m_slots[i]];
+            }
+        }
+#endif
+
+        return result;
+    }
+} /* namespace solve::perf */
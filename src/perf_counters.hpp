@@ -0,0 +1,60 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace solve::perf {
+    enum class counter : std::uint8_t {
+        cycles,
+        instructions,
+        l1d_misses,
+        llc_misses,
+        branch_misses
+    };
+
+    constexpr inline auto counter_count = std::size_t{5};
+
+    [[nodiscard]] auto counter_to_string(counter c) noexcept -> std::string_view;
+
+    // One reading of every counter. Counters that couldn't be opened read 0.
+    struct sample {
+        std::array<std::uint64_t, counter_count> values = {};
+
+        [[nodiscard]] auto operator[](counter c) const noexcept -> std::uint64_t {
+            return values[static_cast<std::size_t>(c)];
+        }
+    };
+
+    // Hardware counters of the thread that constructs it, counting user space
+    // only so that it works with the default perf_event_paranoid setting. All
+    // counters are opened as one group and read with a single system call.
+    //
+    // Outside of Linux, in containers without access to the PMU or on
+    // hardware lacking some of the events, the affected counters are simply
+    // unavailable and read 0.
+    class thread_counters {
+        private:
+        int m_leader = -1;
+        std::array<int, counter_count> m_fds;
+        // Position of each counter in a group read, -1 if unavailable.
+        std::array<int, counter_count> m_slots;
+        int m_open = 0;
+
+        public:
+        thread_counters() noexcept;
+        ~thread_counters();
+
+        thread_counters(thread_counters const&) = delete;
+        auto operator=(thread_counters const&) -> thread_counters& = delete;
+
+        [[nodiscard]] auto available(counter c) const noexcept -> bool;
+        [[nodiscard]] auto any_available() const noexcept -> bool;
+
+        // Must be called on the thread that constructed this.
+        [[nodiscard]] auto read() const noexcept -> sample;
+    };
+} /* namespace solve::perf */
+
+#endif // PERF_COUNTERS_HPP
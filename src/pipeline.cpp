@@ -0,0 +1,471 @@
+#include "pipeline.hpp"
+#include "trace.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::literals::string_view_literals::operator""sv;
+
+namespace {
+    // Splits a file into lines one at a time, for reading two files side by
+    // side. A line stays valid until the next call.
+    class line_reader {
+        private:
+        solve::file_reader& m_input;
+        std::string_view m_rest;
+        // The part of a line that straddles two pieces of the file.
+        std::string m_carry;
+        bool m_carry_returned = false;
+        bool m_done = false;
+
+        public:
+        explicit line_reader(solve::file_reader& input) : m_input(input) {}
+
+        // The next line without its line break, or nothing at the end.
+        [[nodiscard]] auto next()
+            -> tl::expected<std::optional<std::string_view>, solve::io_error> {
+
+            if (m_carry_returned) {
+                m_carry.clear();
+                m_carry_returned = false;
+            }
+
+            while (true) {
+                if (auto const end = m_rest.find('\n'); end != std::string_view::npos) {
+                    auto const line = m_rest.substr(0, end);
+                    m_rest.remove_prefix(end + 1);
+
+                    if (m_carry.empty()) {
+                        return line;
+                    }
+
+                    m_carry.append(line);
+                    m_carry_returned = true;
+                    return std::string_view(m_carry);
+                }
+
+                m_carry.append(m_rest);
+                m_rest = {};
+
+                if (m_done) {
+                    return std::nullopt;
+                }
+
+                auto piece = m_input.next();
+
+                if (!piece.has_value()) {
+                    return tl::unexpected(std::move(piece).error());
+                } else if (piece->empty()) {
+                    m_done = true;
+
+                    // The last line need not end in a line break.
+                    if (!m_carry.empty()) {
+                        m_carry_returned = true;
+                        return std::string_view(m_carry);
+                    }
+
+                    return std::nullopt;
+                }
+
+                m_rest = *piece;
+            }
+        }
+    };
+
+    enum class mismatch : std::uint8_t {
+        none,
+        malformed_puzzle,
+        malformed_solution,
+        givens_changed,
+        invalid_solution
+    };
+
+    [[nodiscard]] auto mismatch_reason(mismatch reason) noexcept -> std::string_view {
+        switch (reason) {
+            case mismatch::malformed_puzzle:
+                return "malformed puzzle";
+            case mismatch::malformed_solution:
+                return "malformed solution";
+            case mismatch::givens_changed:
+                return "solution changes the givens";
+            case mismatch::invalid_solution:
+                return "solution breaks the rules";
+            case mismatch::none:
+                break;
+        }
+
+        return "none";
+    }
+} /* namespace */
+
+namespace solve {
+    auto solve_stream(file_reader& input, file_writer& output,
+            pipeline_options const& options) -> tl::expected<pipeline_result, io_error> {
+
+        auto result = pipeline_result();
+        auto puzzles = std::vector<sudoku>();
+        auto solutions = std::vector<sudoku>();
+        auto batch = options.batch;
+        auto arena = solver_arena();
+        auto const chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+
+        batch.status = {};
+        batch.items = {};
+        // Keeps every worker's matrix alive from one chunk to the next.
+        if (batch.arena == nullptr) {
+            batch.arena = &arena;
+        }
+        puzzles.reserve(chunk_size);
+
+        // The input up to `consumed` is parsed, lines before it are either
+        // solved or in the current chunk.
+        auto consumed = options.start.input_offset;
+        auto line_number = options.start.line;
+        auto output_size = options.start.output_size;
+        auto last_checkpoint = std::chrono::steady_clock::now();
+
+        auto save_checkpoint = [&] (bool final) -> tl::expected<void, io_error> {
+            auto const now = std::chrono::steady_clock::now();
+
+            if (!options.checkpoint_path.has_value()
+                    || (!final && now - last_checkpoint < options.checkpoint_interval)) {
+                return {};
+            }
+
+            // The checkpoint must never claim output that could still get lost.
+            if (auto synced = output.sync(); !synced.has_value()) {
+                return synced;
+            }
+
+            last_checkpoint = now;
+            return write_checkpoint(*options.checkpoint_path, checkpoint{consumed,
+                    line_number, output_size, options.start.input_size});
+        };
+
+        // Only the puzzles the store doesn't know yet, with their positions
+        // in the chunk.
+        auto missing = std::vector<std::size_t>();
+        auto missing_puzzles = std::vector<sudoku>();
+        auto missing_solutions = std::vector<sudoku>();
+        auto missing_status = std::vector<puzzle_status>();
+
+        auto solve_with_store = [&] (solution_store& store)
+            -> tl::expected<std::size_t, io_error> {
+
+            if (auto refreshed = store.refresh(); !refreshed.has_value()) {
+                return tl::unexpected(std::move(refreshed).error());
+            }
+
+            auto found = std::size_t{0};
+            missing.clear();
+            missing_puzzles.clear();
+
+            for (std::size_t i = 0; i < puzzles.size(); ++i) {
+                // The store doesn't know which rules a solution was found
+                // under, and a classic one need not fit a variant.
+                auto const known = store.find(puzzles[i]);
+
+                if (known.has_value() && verify_sudoku(*known, batch.variant)) {
+                    solutions[i] = *known;
+                    ++found;
+                } else {
+                    missing.push_back(i);
+                    missing_puzzles.push_back(puzzles[i]);
+                }
+            }
+
+            missing_solutions.resize(missing.size());
+            missing_status.resize(missing.size());
+
+            auto missing_batch = batch;
+            missing_batch.status = missing_status;
+            missing_batch.items = missing;
+            auto const solved = solve_batch(missing_puzzles, missing_solutions, missing_batch);
+
+            for (std::size_t k = 0; k < missing.size(); ++k) {
+                solutions[missing[k]] = missing_solutions[k];
+
+                if (!store.writable() || missing_status[k] != puzzle_status::ok) {
+                    continue;
+                }
+
+                if (auto inserted = store.insert(missing_puzzles[k], missing_solutions[k]);
+                        !inserted.has_value()) {
+                    return tl::unexpected(std::move(inserted).error());
+                }
+            }
+
+            return found + solved;
+        };
+
+        auto solve_chunk = [&] () -> tl::expected<void, io_error> {
+            solutions.resize(puzzles.size());
+            // Solve events carry the same ids as parse and output ones.
+            batch.first_item = result.puzzles;
+
+            if (options.store == nullptr) {
+                result.solved += solve_batch(puzzles, solutions, batch);
+            } else if (auto solved = solve_with_store(*options.store); solved.has_value()) {
+                result.solved += *solved;
+            } else {
+                return tl::unexpected(std::move(solved).error());
+            }
+
+            char line[sudoku::field_size + 1];
+            line[sudoku::field_size] = '\n';
+
+            for (std::size_t i = 0; i < solutions.size(); ++i) {
+                auto const output_scope = trace::scope(trace::phase::output,
+                        result.puzzles + i);
+
+                for (std::size_t j = 0; j < sudoku::field_size; ++j) {
+                    line[j] = static_cast<char>(solutions[i].data[j] + '0');
+                }
+
+                if (auto written = output.write(std::string_view(line, sizeof(line)));
+                        !written.has_value()) {
+                    return written;
+                }
+            }
+
+            result.puzzles += puzzles.size();
+            output_size += puzzles.size() * (sudoku::field_size + 1);
+            puzzles.clear();
+            return save_checkpoint(false);
+        };
+
+        auto add_line = [&] (std::string_view line) -> tl::expected<void, io_error> {
+            auto const parse_scope = trace::scope(trace::phase::parse,
+                    result.puzzles + puzzles.size());
+            auto parsed = parse_sudoku(line);
+            ++line_number;
+
+            if (!parsed.has_value()) {
+                auto const& error = parsed.error();
+                return tl::unexpected(io_error(error.code(), fmt::format("Line {}: {}",
+                                line_number, error.details().value_or(""))));
+            }
+
+            puzzles.push_back(std::move(parsed).value());
+            return puzzles.size() < chunk_size ? tl::expected<void, io_error>()
+                : solve_chunk();
+        };
+
+        // The part of a line that straddles two pieces of the file.
+        auto carry = std::string();
+
+        while (true) {
+            auto piece = input.next();
+
+            if (!piece.has_value()) {
+                return tl::unexpected(std::move(piece).error());
+            } else if (piece->empty()) {
+                break;
+            }
+
+            auto const piece_offset = consumed + carry.size();
+            auto rest = *piece;
+            for (auto end = rest.find('\n'); end != std::string_view::npos;
+                    end = rest.find('\n')) {
+
+                consumed = piece_offset + static_cast<std::uint64_t>(
+                        rest.data() + end + 1 - piece->data());
+
+                auto added = tl::expected<void, io_error>();
+                if (carry.empty()) {
+                    added = add_line(rest.substr(0, end));
+                } else {
+                    carry.append(rest.substr(0, end));
+                    added = add_line(carry);
+                    carry.clear();
+                }
+
+                if (!added.has_value()) {
+                    return tl::unexpected(std::move(added).error());
+                }
+
+                rest.remove_prefix(end + 1);
+            }
+
+            carry.append(rest);
+        }
+
+        if (!carry.empty()) {
+            consumed += carry.size();
+
+            if (auto added = add_line(carry); !added.has_value()) {
+                return tl::unexpected(std::move(added).error());
+            }
+        }
+
+        if (!puzzles.empty()) {
+            if (auto solved = solve_chunk(); !solved.has_value()) {
+                return tl::unexpected(std::move(solved).error());
+            }
+        }
+
+        if (auto saved = save_checkpoint(true); !saved.has_value()) {
+            return tl::unexpected(std::move(saved).error());
+        }
+
+        return result;
+    }
+
+    auto verify_stream(file_reader& puzzles, file_reader& solutions, file_writer& report,
+            pipeline_options const& options) -> tl::expected<verify_result, io_error> {
+
+        constexpr auto line_size = std::size_t{sudoku::field_size};
+
+        auto result = verify_result();
+        auto const chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+
+        // Every line of the chunk, and the text of the pairs that are worth
+        // handing to the workers along with the index of their line. Lines
+        // that are too long or too short are malformed without a closer look.
+        auto reasons = std::vector<mismatch>();
+        auto puzzle_text = std::string();
+        auto solution_text = std::string();
+        auto positions = std::vector<std::size_t>();
+        auto status = std::vector<puzzle_status>();
+
+        reasons.reserve(chunk_size);
+        puzzle_text.reserve(chunk_size * line_size);
+        solution_text.reserve(chunk_size * line_size);
+        positions.reserve(chunk_size);
+
+        // Only runs for the few pairs that failed, to find out why.
+        auto classify = [] (std::string_view puzzle, std::string_view solution) {
+            auto const parsed_puzzle = parse_sudoku(puzzle);
+            auto const parsed_solution = parse_sudoku(solution);
+
+            return !parsed_puzzle.has_value() ? mismatch::malformed_puzzle
+                : !parsed_solution.has_value() ? mismatch::malformed_solution
+                : !keeps_givens(*parsed_puzzle, *parsed_solution) ? mismatch::givens_changed
+                : mismatch::invalid_solution;
+        };
+
+        auto check_chunk = [&] () -> tl::expected<void, io_error> {
+            status.resize(positions.size());
+
+            auto batch = options.batch;
+            batch.status = status;
+            (void)verify_solutions(puzzle_text, solution_text, batch);
+
+            for (std::size_t k = 0; k < positions.size(); ++k) {
+                if (status[k] != puzzle_status::ok) {
+                    reasons[positions[k]] = classify(
+                            std::string_view(puzzle_text).substr(k * line_size, line_size),
+                            std::string_view(solution_text).substr(k * line_size, line_size));
+                }
+            }
+
+            auto const first_line = result.lines - reasons.size() + 1;
+
+            for (std::size_t i = 0; i < reasons.size(); ++i) {
+                if (reasons[i] == mismatch::none) {
+                    continue;
+                }
+
+                ++result.mismatches;
+
+                if (auto written = report.write(fmt::format("{}: {}\n", first_line + i,
+                                mismatch_reason(reasons[i]))); !written.has_value()) {
+                    return written;
+                }
+            }
+
+            reasons.clear();
+            puzzle_text.clear();
+            solution_text.clear();
+            positions.clear();
+            return {};
+        };
+
+        auto puzzle_lines = line_reader(puzzles);
+        auto solution_lines = line_reader(solutions);
+        // The file that still has lines once the other one has run out.
+        auto* longer = static_cast<line_reader*>(nullptr);
+
+        while (true) {
+            auto puzzle = puzzle_lines.next();
+            if (!puzzle.has_value()) {
+                return tl::unexpected(std::move(puzzle).error());
+            }
+
+            auto solution = solution_lines.next();
+            if (!solution.has_value()) {
+                return tl::unexpected(std::move(solution).error());
+            }
+
+            if (!puzzle->has_value() || !solution->has_value()) {
+                longer = puzzle->has_value() ? &puzzle_lines
+                    : solution->has_value() ? &solution_lines : nullptr;
+                break;
+            }
+
+            ++result.lines;
+
+            if ((*puzzle)->size() != line_size) {
+                reasons.push_back(mismatch::malformed_puzzle);
+            } else if ((*solution)->size() != line_size) {
+                reasons.push_back(mismatch::malformed_solution);
+            } else {
+                reasons.push_back(mismatch::none);
+                puzzle_text.append(**puzzle);
+                solution_text.append(**solution);
+                positions.push_back(reasons.size() - 1);
+            }
+
+            if (reasons.size() == chunk_size) {
+                if (auto checked = check_chunk(); !checked.has_value()) {
+                    return tl::unexpected(std::move(checked).error());
+                }
+            }
+        }
+
+        if (auto checked = check_chunk(); !checked.has_value()) {
+            return tl::unexpected(std::move(checked).error());
+        }
+
+        if (longer == nullptr) {
+            return result;
+        }
+
+        // The rest of the longer file has nothing to be checked against,
+        // starting with the line that was just read.
+        auto const paired = result.lines;
+        ++result.lines;
+
+        while (true) {
+            auto line = longer->next();
+
+            if (!line.has_value()) {
+                return tl::unexpected(std::move(line).error());
+            } else if (!line->has_value()) {
+                break;
+            }
+
+            ++result.lines;
+        }
+
+        result.mismatches += result.lines - paired;
+
+        auto const reason = longer == &puzzle_lines ? "no solution"sv : "no puzzle"sv;
+        auto written = result.lines == paired + 1
+            ? report.write(fmt::format("{}: {}\n", result.lines, reason))
+            : report.write(fmt::format("{}-{}: {}\n", paired + 1, result.lines, reason));
+
+        if (!written.has_value()) {
+            return tl::unexpected(std::move(written).error());
+        }
+
+        return result;
+    }
+} /* namespace solve */
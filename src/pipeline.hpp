@@ -0,0 +1,72 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "batch.hpp"
+#include "checkpoint.hpp"
+#include "file_io.hpp"
+#include "input.hpp"
+#include "solution_store.hpp"
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace solve {
+    struct pipeline_options {
+        // Passed on to solve_batch for every chunk. The status and item
+        // spans and first_item are ignored, as they can't match the chunks.
+        // Trace ids count puzzles from the start of this run instead.
+        batch_options batch = {};
+        // Number of puzzles collected before they are solved as one batch.
+        // Large enough to keep all workers busy, small enough that the reader
+        // keeps reading ahead while the batch is solved.
+        std::size_t chunk_size = 16384;
+        // Where the input and output start off, when continuing an earlier
+        // run. Line numbers in errors count from here as well.
+        checkpoint start = {};
+        // If set, the output is synced and a checkpoint written here after
+        // every chunk that finishes at least `checkpoint_interval` after the
+        // last one, and once more at the end.
+        std::optional<std::filesystem::path> checkpoint_path;
+        std::chrono::seconds checkpoint_interval = std::chrono::seconds(10);
+        // If set, puzzles are looked up here before they're solved, and new
+        // solutions are recorded if the store is writable.
+        solution_store* store = nullptr;
+    };
+
+    struct pipeline_result {
+        std::size_t puzzles = 0;
+        std::size_t solved = 0;
+    };
+
+    // Reads one puzzle per line from `input`, solves them chunk by chunk and
+    // writes one solution per line to `output` in input order. Doesn't flush
+    // `output`. Format errors carry the number of the offending line.
+    [[nodiscard]] auto solve_stream(file_reader& input, file_writer& output,
+            pipeline_options const& options = {}) -> tl::expected<pipeline_result, io_error>;
+
+    struct verify_result {
+        // Lines in the longer of the two files.
+        std::uint64_t lines = 0;
+        std::uint64_t mismatches = 0;
+    };
+
+    // Reads puzzles and solutions from two files in lockstep, one per line,
+    // and checks chunk by chunk that each solution keeps the givens of its
+    // puzzle and passes verify_sudoku under `options.batch.variant`. Every
+    // line that fails is written to `report` as "<line>: <reason>", counting
+    // from 1. Malformed lines in either file are reported instead of ending
+    // the run. If one file has more lines than the other, the extra lines
+    // are reported as a single range "<first>-<last>: <reason>". Only
+    // `batch` and `chunk_size` of the options are used. Doesn't flush
+    // `report`.
+    [[nodiscard]] auto verify_stream(file_reader& puzzles, file_reader& solutions,
+            file_writer& report, pipeline_options const& options = {})
+        -> tl::expected<verify_result, io_error>;
+} /* namespace solve */
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,472 @@
+#include "propagation.hpp"
+
+#include "utility.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+namespace {
+    using unit_table = std::array<std::array<std::uint8_t, 9>, solve::unit_count>;
+    using cell_unit_table = std::array<std::array<std::uint8_t, 3>, 81>;
+    using peer_table = std::array<std::array<std::uint8_t, 20>, 81>;
+
+    constexpr auto units = [] {
+        auto table = unit_table{};
+
+        for (unsigned i = 0; i < 9; ++i) {
+            for (unsigned j = 0; j < 9; ++j) {
+                table[i][j] = static_cast<std::uint8_t>(j + 9 * i);
+                table[9 + i][j] = static_cast<std::uint8_t>(i + 9 * j);
+                table[18 + i][j] = static_cast<std::uint8_t>(
+                        (i % 3) * 3 + (i / 3) * 27 + j % 3 + (j / 3) * 9);
+            }
+        }
+
+        return table;
+    }();
+
+    constexpr auto cell_to_units = [] {
+        auto table = cell_unit_table{};
+
+        for (unsigned cell = 0; cell < 81; ++cell) {
+            auto const x = cell % 9;
+            auto const y = cell / 9;
+            table[cell] = {static_cast<std::uint8_t>(y),
+                static_cast<std::uint8_t>(9 + x),
+                static_cast<std::uint8_t>(18 + x / 3 + (y / 3) * 3)};
+        }
+
+        return table;
+    }();
+
+    constexpr auto peers = [] {
+        auto table = peer_table{};
+
+        for (unsigned cell = 0; cell < 81; ++cell) {
+            auto count = 0u;
+
+            for (unsigned other = 0; other < 81; ++other) {
+                if (other == cell) {
+                    continue;
+                }
+
+                auto shares_unit = false;
+                for (auto unit : cell_to_units[cell]) {
+                    for (auto u : cell_to_units[other]) {
+                        shares_unit = shares_unit || u == unit;
+                    }
+                }
+
+                if (shares_unit) {
+                    table[cell][count++] = static_cast<std::uint8_t>(other);
+                }
+            }
+        }
+
+        return table;
+    }();
+
+    [[nodiscard]] constexpr auto board_index(unsigned cell) noexcept -> unsigned {
+        return solve::bitboard::index(cell % 9, cell / 9);
+    }
+
+    // Same as peers, but already translated to positions in the bitboard.
+    constexpr auto board_peers = [] {
+        auto table = peer_table{};
+
+        for (unsigned cell = 0; cell < 81; ++cell) {
+            for (unsigned i = 0; i < 20; ++i) {
+                table[cell][i] = static_cast<std::uint8_t>(board_index(peers[cell][i]));
+            }
+        }
+
+        return table;
+    }();
+
+    // The three cells a block shares with one of its rows or columns, plus
+    // the six cells each of the two units has on its own.
+    struct intersection {
+        std::array<std::uint8_t, 3> shared;
+        std::array<std::uint8_t, 6> block_rest;
+        std::array<std::uint8_t, 6> line_rest;
+    };
+
+    constexpr auto intersections = [] {
+        auto table = std::array<intersection, 54>{};
+        auto count = 0u;
+
+        for (unsigned block = 18; block < 27; ++block) {
+            for (unsigned line = 0; line < 18; ++line) {
+                auto in_line = [line] (unsigned cell) {
+                    return line < 9 ? cell / 9 == line : cell % 9 == line - 9;
+                };
+
+                auto shared = 0u;
+                for (auto cell : units[block]) {
+                    shared += in_line(cell);
+                }
+
+                if (shared == 0) {
+                    continue;
+                }
+
+                auto& current = table[count++];
+                auto shared_index = 0u;
+                auto block_index = 0u;
+                auto line_index = 0u;
+
+                for (auto cell : units[block]) {
+                    if (in_line(cell)) {
+                        current.shared[shared_index++] = cell;
+                    } else {
+                        current.block_rest[block_index++] = cell;
+                    }
+                }
+
+                for (auto cell : units[line]) {
+                    if (cell_to_units[cell][2] != block) {
+                        current.line_rest[line_index++] = cell;
+                    }
+                }
+            }
+        }
+
+        return table;
+    }();
+
+    template <std::size_t N>
+    [[nodiscard]] auto candidate_union(solve::candidate_grid const& grid,
+            std::array<std::uint8_t, N> const& cells) noexcept -> std::uint16_t {
+
+        auto result = std::uint16_t{0};
+        for (auto cell : cells) {
+            result |= grid.is_open(cell) ? grid.candidates(cell) : std::uint16_t{0};
+        }
+
+        return result;
+    }
+
+    template <std::size_t N>
+    auto eliminate_all(solve::candidate_grid& grid,
+            std::array<std::uint8_t, N> const& cells, std::uint16_t mask) noexcept
+        -> bool {
+
+        auto progress = false;
+        for (auto cell : cells) {
+            progress |= grid.eliminate(cell, mask);
+        }
+
+        return progress;
+    }
+
+    auto naked_singles(solve::candidate_grid& grid) noexcept -> bool {
+        auto progress = false;
+
+        for (unsigned cell = 0; cell < 81 && !grid.contradiction(); ++cell) {
+            if (!grid.is_open(cell)) {
+                continue;
+            }
+
+            auto const mask = grid.candidates(cell);
+            if (mask != 0 && (mask & (mask - 1)) == 0) {
+                grid.place(cell, static_cast<std::int8_t>(
+                            solve::util::count_trailing_zeros(mask) + 1));
+                progress = true;
+            }
+        }
+
+        return progress;
+    }
+
+    enum class step {
+        none,
+        progress,
+        contradiction
+    };
+
+    auto hidden_singles(solve::candidate_grid& grid) noexcept -> step {
+        auto progress = false;
+
+        for (unsigned unit = 0; unit < solve::unit_count && !grid.contradiction(); ++unit) {
+            auto once = std::uint16_t{0};
+            auto twice = std::uint16_t{0};
+            auto placed = std::uint16_t{0};
+
+            for (auto cell : units[unit]) {
+                if (grid.is_open(cell)) {
+                    auto const mask = grid.candidates(cell);
+                    twice |= once & mask;
+                    once |= mask;
+                } else {
+                    placed |= grid.candidates(cell);
+                }
+            }
+
+            if ((once | placed) != solve::bitboard::all_digits) {
+                // Some digit has nowhere left to go in this unit.
+                return step::contradiction;
+            }
+
+            auto const exactly_once = static_cast<std::uint16_t>(once & ~twice);
+            if (exactly_once == 0) {
+                continue;
+            }
+
+            for (auto cell : units[unit]) {
+                if (!grid.is_open(cell)) {
+                    continue;
+                }
+
+                auto const mask = static_cast<std::uint16_t>(
+                        grid.candidates(cell) & exactly_once);
+
+                if (mask != 0) {
+                    // If more than one digit is forced into the same cell,
+                    // placing the lowest will leave the others without a home
+                    // and we notice on the next pass.
+                    grid.place(cell, static_cast<std::int8_t>(
+                                solve::util::count_trailing_zeros(mask) + 1));
+                    progress = true;
+                }
+            }
+        }
+
+        return progress ? step::progress : step::none;
+    }
+
+    auto locked_candidates(solve::candidate_grid& grid) noexcept -> bool {
+        auto progress = false;
+
+        for (auto const& current : intersections) {
+            auto const shared = candidate_union(grid, current.shared);
+            if (shared == 0) {
+                continue;
+            }
+
+            auto const block_rest = candidate_union(grid, current.block_rest);
+            auto const line_rest = candidate_union(grid, current.line_rest);
+
+            // Digits which, within the block, only fit into the shared cells
+            // can't go anywhere else in the line (pointing), and vice versa
+            // (claiming).
+            auto const pointing = static_cast<std::uint16_t>(shared & ~block_rest);
+            auto const claiming = static_cast<std::uint16_t>(shared & ~line_rest);
+
+            progress |= eliminate_all(grid, current.line_rest, pointing);
+            progress |= eliminate_all(grid, current.block_rest, claiming);
+        }
+
+        return progress;
+    }
+} /* namespace */
+
+namespace solve {
+    auto unit_cells(unsigned unit) noexcept -> std::array<std::uint8_t, 9> const& {
+        assert(unit < unit_count && "Unit index out of range.");
+        return units[unit];
+    }
+
+    auto cell_units(unsigned cell) noexcept -> std::array<std::uint8_t, 3> const& {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+        return cell_to_units[cell];
+    }
+
+    auto cell_peers(unsigned cell) noexcept -> std::array<std::uint8_t, 20> const& {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+        return peers[cell];
+    }
+
+    candidate_grid::candidate_grid(sudoku const& s) noexcept {
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            m_candidates.cells[board_index(cell)] = bitboard::all_digits;
+        }
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            auto const value = s.data[cell];
+
+            if (value == sudoku::empty_field) {
+                continue;
+            }
+
+            if (bitboard::digit_mask(value) == 0) {
+                m_contradiction = true;
+                continue;
+            }
+
+            place(cell, value);
+        }
+    }
+
+    auto candidate_grid::values() const noexcept -> sudoku const& {
+        return m_values;
+    }
+
+    auto candidate_grid::candidates() const noexcept -> bitboard const& {
+        return m_candidates;
+    }
+
+    auto candidate_grid::candidates(unsigned cell) const noexcept -> std::uint16_t {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+        return m_candidates.cells[board_index(cell)];
+    }
+
+    auto candidate_grid::is_open(unsigned cell) const noexcept -> bool {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+        return m_values.data[cell] == sudoku::empty_field;
+    }
+
+    auto candidate_grid::unsolved() const noexcept -> unsigned {
+        return m_unsolved;
+    }
+
+    auto candidate_grid::contradiction() const noexcept -> bool {
+        return m_contradiction;
+    }
+
+    void candidate_grid::place(unsigned cell, std::int8_t value) noexcept {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+
+        auto const mask = bitboard::digit_mask(value);
+
+        if (!is_open(cell) || (m_candidates.cells[board_index(cell)] & mask) == 0) {
+            m_contradiction = true;
+            return;
+        }
+
+        m_values.data[cell] = value;
+        m_candidates.cells[board_index(cell)] = mask;
+        m_unsolved -= 1;
+
+        // Filled peers can't hold this digit, or the check above would have
+        // failed already, so there's no need to skip them.
+        auto exhausted = false;
+        for (auto peer : board_peers[cell]) {
+            auto& candidates = m_candidates.cells[peer];
+            candidates &= ~mask;
+            exhausted |= candidates == 0;
+        }
+
+        m_contradiction = m_contradiction || exhausted;
+    }
+
+    auto candidate_grid::eliminate(unsigned cell, std::uint16_t mask) noexcept -> bool {
+        assert(cell < sudoku::field_size && "Cell index out of range.");
+
+        auto& candidates = m_candidates.cells[board_index(cell)];
+
+        if (!is_open(cell) || (candidates & mask) == 0) {
+            return false;
+        }
+
+        candidates &= ~mask;
+        m_contradiction = m_contradiction || candidates == 0;
+        return true;
+    }
+
+    auto propagate(candidate_grid& grid) noexcept -> propagation_result {
+        auto hidden = step::none;
+
+        while (!grid.contradiction() && grid.unsolved() > 0) {
+            if (naked_singles(grid)) {
+                continue;
+            }
+
+            hidden = hidden_singles(grid);
+            if (hidden == step::contradiction) {
+                break;
+            } else if (hidden == step::progress) {
+                continue;
+            }
+
+            if (grid.contradiction() || !locked_candidates(grid)) {
+                break;
+            }
+        }
+
+        if (grid.contradiction() || hidden == step::contradiction) {
+            return propagation_result::contradiction;
+        }
+
+        return grid.unsolved() == 0 ? propagation_result::solved
+            : propagation_result::stuck;
+    }
+
+    auto find_naked_single(candidate_grid const& grid) noexcept
+        -> std::optional<placement> {
+
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            if (!grid.is_open(cell)) {
+                continue;
+            }
+
+            auto const mask = grid.candidates(cell);
+            if (mask != 0 && (mask & (mask - 1)) == 0) {
+                return placement{cell, static_cast<std::int8_t>(
+                        util::count_trailing_zeros(mask) + 1)};
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    auto find_hidden_single(candidate_grid const& grid) noexcept
+        -> std::optional<placement> {
+
+        auto best = std::optional<placement>();
+
+        for (unsigned unit = 0; unit < unit_count; ++unit) {
+            auto once = std::uint16_t{0};
+            auto twice = std::uint16_t{0};
+
+            for (auto cell : units[unit]) {
+                if (grid.is_open(cell)) {
+                    auto const mask = grid.candidates(cell);
+                    twice |= once & mask;
+                    once |= mask;
+                }
+            }
+
+            auto const exactly_once = static_cast<std::uint16_t>(once & ~twice);
+            if (exactly_once == 0) {
+                continue;
+            }
+
+            for (auto cell : units[unit]) {
+                auto const mask = static_cast<std::uint16_t>(
+                        grid.candidates(cell) & exactly_once);
+
+                // Cells claimed by more than one digit are contradictions,
+                // not hints.
+                if (grid.is_open(cell) && mask != 0 && (mask & (mask - 1)) == 0
+                        && (!best.has_value() || cell < best->cell)) {
+
+                    best = placement{cell, static_cast<std::int8_t>(
+                            util::count_trailing_zeros(mask) + 1)};
+                    break;
+                }
+            }
+        }
+
+        return best;
+    }
+
+    auto eliminate_locked_candidates(candidate_grid& grid) noexcept -> bool {
+        return locked_candidates(grid);
+    }
+
+    auto estimate_difficulty(sudoku const& s) noexcept -> std::uint16_t {
+        auto const grid = candidate_grid(s);
+
+        if (grid.contradiction()) {
+            return 0;
+        }
+
+        auto candidates = 0;
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            candidates += grid.is_open(cell) ? util::popcount(grid.candidates(cell)) : 0;
+        }
+
+        return static_cast<std::uint16_t>(candidates);
+    }
+} /* namespace solve */
@@ -0,0 +1,79 @@
+#ifndef PROPAGATION_HPP
+#define PROPAGATION_HPP
+
+#include "data.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace solve {
+    // Cells are numbered like sudoku::data, i.e. cell = x + 9 * y. Units are
+    // numbered rows first, then columns, then blocks.
+    constexpr inline auto unit_count = 27u;
+
+    [[nodiscard]] auto unit_cells(unsigned unit) noexcept -> std::array<std::uint8_t, 9> const&;
+    [[nodiscard]] auto cell_units(unsigned cell) noexcept -> std::array<std::uint8_t, 3> const&;
+    [[nodiscard]] auto cell_peers(unsigned cell) noexcept -> std::array<std::uint8_t, 20> const&;
+
+    // A sudoku together with the digits every open cell can still take. This
+    // is what the logical solving techniques work on before (or instead of)
+    // handing a puzzle to the dancing links search.
+    class candidate_grid {
+        private:
+        sudoku m_values;
+        bitboard m_candidates;
+        std::uint8_t m_unsolved = sudoku::field_size;
+        bool m_contradiction = false;
+
+        public:
+        explicit candidate_grid(sudoku const& s) noexcept;
+
+        [[nodiscard]] auto values() const noexcept -> sudoku const&;
+        [[nodiscard]] auto candidates() const noexcept -> bitboard const&;
+        [[nodiscard]] auto candidates(unsigned cell) const noexcept -> std::uint16_t;
+        [[nodiscard]] auto is_open(unsigned cell) const noexcept -> bool;
+        [[nodiscard]] auto unsolved() const noexcept -> unsigned;
+        // Set as soon as some cell or unit has run out of options.
+        [[nodiscard]] auto contradiction() const noexcept -> bool;
+
+        // Fills in `value` at `cell` and strikes it from the cell's peers.
+        void place(unsigned cell, std::int8_t value) noexcept;
+        // Removes the digits in `mask` from the candidates of an open cell.
+        // Returns whether any candidate was actually removed.
+        auto eliminate(unsigned cell, std::uint16_t mask) noexcept -> bool;
+    };
+
+    enum class propagation_result {
+        solved,
+        stuck,
+        contradiction
+    };
+
+    struct placement {
+        unsigned cell;
+        std::int8_t value;
+    };
+
+    // Single logical steps, for when the reasoning matters as much as the
+    // result. Both find the first applicable placement in cell order and
+    // leave the grid alone.
+    [[nodiscard]] auto find_naked_single(candidate_grid const& grid) noexcept
+        -> std::optional<placement>;
+    [[nodiscard]] auto find_hidden_single(candidate_grid const& grid) noexcept
+        -> std::optional<placement>;
+    // Removes candidates via one round of pointing and claiming. Returns
+    // whether anything was removed.
+    auto eliminate_locked_candidates(candidate_grid& grid) noexcept -> bool;
+
+    // Applies naked singles, hidden singles and locked candidates until none
+    // of them makes any more progress.
+    auto propagate(candidate_grid& grid) noexcept -> propagation_result;
+
+    // Cheap guess at how long a puzzle takes to solve, for scheduling only:
+    // the number of candidates left in all open cells once the givens have
+    // been placed. Higher means harder, contradictory puzzles score zero.
+    [[nodiscard]] auto estimate_difficulty(sudoku const& s) noexcept -> std::uint16_t;
+} /* namespace solve */
+
+#endif // PROPAGATION_HPP
@@ -0,0 +1,94 @@
+#include "session.hpp"
+
+#include "propagation.hpp"
+#include "solver.hpp"
+
+#include <cassert>
+
+namespace solve {
+    solver_session::solver_session(sudoku const& s) noexcept {
+        for (unsigned y = 0; y < 9; ++y) {
+            for (unsigned x = 0; x < 9; ++x) {
+                auto const value = s.data[x + 9 * y];
+
+                if (value != sudoku::empty_field) {
+                    // Conflicting givens simply stay empty.
+                    (void)set_cell(x, y, value);
+                }
+            }
+        }
+    }
+
+    auto solver_session::grid() const noexcept -> sudoku const& {
+        return m_grid;
+    }
+
+    auto solver_session::candidates(unsigned x, unsigned y) const noexcept -> std::uint16_t {
+        assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+
+        auto const cell = x + 9 * y;
+        auto used = std::uint16_t{0};
+
+        for (auto unit : cell_units(cell)) {
+            used |= m_used[unit];
+        }
+
+        // The cell's own digit doesn't stand in its way.
+        used &= static_cast<std::uint16_t>(~bitboard::digit_mask(m_grid.data[cell]));
+        return static_cast<std::uint16_t>(bitboard::all_digits & ~used);
+    }
+
+    auto solver_session::set_cell(unsigned x, unsigned y, std::int8_t value) noexcept -> bool {
+        assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+        assert(value >= 1 && value <= 9 && "Cell value out of range.");
+
+        if ((candidates(x, y) & bitboard::digit_mask(value)) == 0) {
+            return false;
+        }
+
+        clear_cell(x, y);
+
+        auto const cell = x + 9 * y;
+        for (auto unit : cell_units(cell)) {
+            m_used[unit] |= bitboard::digit_mask(value);
+        }
+
+        m_grid.data[cell] = value;
+        return true;
+    }
+
+    void solver_session::clear_cell(unsigned x, unsigned y) noexcept {
+        assert(x < 9 && y < 9 && "Cell coordinates out of range.");
+
+        auto const cell = x + 9 * y;
+        auto const mask = bitboard::digit_mask(m_grid.data[cell]);
+
+        for (auto unit : cell_units(cell)) {
+            m_used[unit] &= static_cast<std::uint16_t>(~mask);
+        }
+
+        m_grid.data[cell] = sudoku::empty_field;
+    }
+
+    auto solver_session::count_solutions(unsigned limit) const -> unsigned {
+        return static_cast<unsigned>(thread_context().count_solutions(m_grid, limit));
+    }
+
+    auto solver_session::is_solvable() const -> bool {
+        return count_solutions(1) == 1;
+    }
+
+    auto solver_session::has_unique_solution() const -> bool {
+        return count_solutions(2) == 1;
+    }
+
+    auto solver_session::solution() const -> std::optional<sudoku> {
+        auto const result = thread_context().solve(m_grid);
+
+        if (!verify_sudoku(result)) {
+            return std::nullopt;
+        }
+
+        return result;
+    }
+} /* namespace solve */
@@ -0,0 +1,49 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "data.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace solve {
+    // The same interface as incremental_solver, for servers holding many
+    // grids open at once. A session only stores its grid and the digits used
+    // in each row, column and block, a couple of hundred bytes all told.
+    // Queries borrow a matrix that every thread builds once on its first
+    // query and shares between all sessions it serves, so they pay for
+    // resetting that matrix instead of a single covered row.
+    //
+    // Queries don't change the session, so any number of threads may run
+    // them on the same session at once; edits need the session to
+    // themselves.
+    class solver_session {
+        private:
+        sudoku m_grid;
+        // Digits placed in each unit, numbered as in propagation.hpp.
+        std::array<std::uint16_t, 27> m_used = {};
+
+        public:
+        solver_session() = default;
+        explicit solver_session(sudoku const& s) noexcept;
+
+        [[nodiscard]] auto grid() const noexcept -> sudoku const&;
+        // Digits that can go into the cell without clashing with another one,
+        // whether or not it's filled in.
+        [[nodiscard]] auto candidates(unsigned x, unsigned y) const noexcept -> std::uint16_t;
+
+        // Fills in a cell, replacing whatever value it held before. Fails and
+        // leaves the grid untouched if the value conflicts with another cell.
+        [[nodiscard]] auto set_cell(unsigned x, unsigned y, std::int8_t value) noexcept -> bool;
+        void clear_cell(unsigned x, unsigned y) noexcept;
+
+        // Counts solutions of the current grid, stopping at `limit`.
+        [[nodiscard]] auto count_solutions(unsigned limit) const -> unsigned;
+        [[nodiscard]] auto is_solvable() const -> bool;
+        [[nodiscard]] auto has_unique_solution() const -> bool;
+        [[nodiscard]] auto solution() const -> std::optional<sudoku>;
+    };
+} /* namespace solve */
+
+#endif // SESSION_HPP
@@ -0,0 +1,466 @@
+#include "solution_store.hpp"
+#include "solver.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char store_magic[8] = {'s', 's', 'o', 'l', 'v', 's', 't', 'o'};
+    constexpr auto store_version = std::uint32_t{1};
+
+    // Four bits per cell, two cells per byte.
+    constexpr auto packed_size = std::size_t{(solve::sudoku::field_size + 1) / 2};
+    using packed_sudoku = std::array<std::uint8_t, packed_size>;
+
+    constexpr auto initial_capacity = std::uint64_t{1} << 14;
+
+    struct store_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entry_size;
+        // Number of slots, always a power of two.
+        std::uint64_t capacity;
+        std::atomic<std::uint64_t> count;
+        char reserved[32];
+    };
+
+    struct store_entry {
+        // Zero while the slot is free, written last.
+        std::atomic<std::uint64_t> tag;
+        packed_sudoku puzzle;
+        packed_sudoku solution;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+            "Tags must be lock free to be shared between processes.");
+    static_assert(sizeof(store_header) == 64);
+    static_assert(sizeof(store_entry) == 96);
+
+    // Tables are kept below three quarters full, so probe sequences stay
+    // short and always end at a free slot.
+    [[nodiscard]] constexpr auto too_full(std::uint64_t count, std::uint64_t capacity) noexcept
+        -> bool {
+
+        return 4 * count > 3 * capacity;
+    }
+
+    [[nodiscard]] constexpr auto file_size(std::uint64_t capacity) noexcept -> std::uint64_t {
+        return sizeof(store_header) + capacity * sizeof(store_entry);
+    }
+
+    [[nodiscard]] auto pack(solve::sudoku const& s) noexcept -> packed_sudoku {
+        auto result = packed_sudoku();
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            auto const value = static_cast<std::uint8_t>(s.data[cell] & 0xf);
+            result[cell / 2] |= static_cast<std::uint8_t>(cell % 2 == 0 ? value : value << 4);
+        }
+
+        return result;
+    }
+
+    [[nodiscard]] auto unpack(packed_sudoku const& p) noexcept -> solve::sudoku {
+        auto result = solve::sudoku();
+        for (unsigned cell = 0; cell < solve::sudoku::field_size; ++cell) {
+            auto const byte = p[cell / 2];
+            result.data[cell] = static_cast<std::int8_t>(cell % 2 == 0 ? byte & 0xf : byte >> 4);
+        }
+
+        return result;
+    }
+
+    // Never zero, as that marks free slots.
+    [[nodiscard]] auto hash(packed_sudoku const& p) noexcept -> std::uint64_t {
+        auto h = std::uint64_t{0x9e3779b97f4a7c15};
+
+        for (std::size_t i = 0; i < p.size(); i += 8) {
+            auto word = std::uint64_t{0};
+            std::memcpy(&word, p.data() + i, std::min<std::size_t>(8, p.size() - i));
+            h = (h ^ word) * 0xff51afd7ed558ccd;
+            h ^= h >> 32;
+        }
+
+        return h | 1;
+    }
+
+    // A table mapped into memory, read-only unless it belongs to the writer.
+    class table {
+        private:
+        unsigned char* m_base = nullptr;
+        std::size_t m_size = 0;
+        ino_t m_inode = 0;
+
+        public:
+        table() = default;
+
+        table(table&& other) noexcept
+            : m_base{std::exchange(other.m_base, nullptr)},
+              m_size{std::exchange(other.m_size, 0)},
+              m_inode{other.m_inode} {}
+
+        auto operator=(table&& other) noexcept -> table& {
+            std::swap(m_base, other.m_base);
+            std::swap(m_size, other.m_size);
+            std::swap(m_inode, other.m_inode);
+            return *this;
+        }
+
+        ~table() {
+            if (m_base != nullptr) {
+                munmap(m_base, m_size);
+            }
+        }
+
+        [[nodiscard]] static auto map(std::filesystem::path const& path, bool writable)
+            -> tl::expected<table, solve::io_error> {
+
+            auto const fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+            if (fd == -1) {
+                return tl::unexpected(solve::io_error(solve::io_error::err_code::NO_SUCH_FILE,
+                            fmt::format("Could not open {}.", path.string())));
+            }
+
+            struct stat info = {};
+            auto result = table();
+
+            if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size)
+                    >= sizeof(store_header)) {
+
+                auto* const base = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                        writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+
+                if (base != MAP_FAILED) {
+                    result.m_base = static_cast<unsigned char*>(base);
+                    result.m_size = static_cast<std::size_t>(info.st_size);
+                    result.m_inode = info.st_ino;
+                }
+            }
+
+            close(fd);
+
+            if (!result.valid() || !result.consistent()) {
+                return tl::unexpected(solve::io_error(solve::io_error::err_code::FORMAT_ERROR,
+                            fmt::format("{} is not a solution store.", path.string())));
+            }
+
+            return result;
+        }
+
+        // Writes an empty table with room for `capacity` entries to `path`.
+        [[nodiscard]] static auto create(std::filesystem::path const& path,
+                std::uint64_t capacity) -> tl::expected<void, solve::io_error> {
+
+            auto const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd == -1) {
+                return tl::unexpected(solve::io_error(solve::io_error::err_code::WRITE_ERROR,
+                            fmt::format("Could not create {}.", path.string())));
+            }
+
+            // The entries are left to ftruncate, which zeroes them without
+            // taking up any space until they are used.
+            auto header = store_header{};
+            std::memcpy(header.magic, store_magic, sizeof(store_magic));
+            header.version = store_version;
+            header.entry_size = sizeof(store_entry);
+            header.capacity = capacity;
+
+            auto const ok = ftruncate(fd, static_cast<off_t>(file_size(capacity))) == 0
+                && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+            close(fd);
+
+            if (!ok) {
+                return tl::unexpected(solve::io_error(solve::io_error::err_code::WRITE_ERROR,
+                            fmt::format("Could not write {}.", path.string())));
+            }
+
+            return {};
+        }
+
+        [[nodiscard]] auto valid() const noexcept -> bool {
+            return m_base != nullptr;
+        }
+
+        // Whether the header is ours and fits the size of the file.
+        [[nodiscard]] auto consistent() const noexcept -> bool {
+            auto const& h = header();
+            return std::memcmp(h.magic, store_magic, sizeof(store_magic)) == 0
+                && h.version == store_version && h.entry_size == sizeof(store_entry)
+                && h.capacity != 0 && (h.capacity & (h.capacity - 1)) == 0
+                && file_size(h.capacity) == m_size;
+        }
+
+        [[nodiscard]] auto inode() const noexcept -> ino_t {
+            return m_inode;
+        }
+
+        [[nodiscard]] auto header() const noexcept -> store_header& {
+            return *reinterpret_cast<store_header*>(m_base);
+        }
+
+        [[nodiscard]] auto entry(std::uint64_t slot) const noexcept -> store_entry& {
+            return reinterpret_cast<store_entry*>(m_base + sizeof(store_header))[slot];
+        }
+
+        // The entry holding `puzzle`, or the free slot where it would go.
+        [[nodiscard]] auto probe(packed_sudoku const& puzzle, std::uint64_t tag) const noexcept
+            -> store_entry* {
+
+            auto const capacity = header().capacity;
+            auto slot = (tag >> 1) & (capacity - 1);
+
+            // Bounded by the capacity in case a broken table is full.
+            for (std::uint64_t i = 0; i < capacity; ++i, slot = (slot + 1) & (capacity - 1)) {
+                auto& current = entry(slot);
+                auto const current_tag = current.tag.load(std::memory_order_acquire);
+
+                if (current_tag == 0 || (current_tag == tag && current.puzzle == puzzle)) {
+                    return &current;
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Fills in a free slot found by probe and publishes it.
+        void publish(store_entry& slot, packed_sudoku const& puzzle,
+                packed_sudoku const& solution, std::uint64_t tag) noexcept {
+
+            slot.puzzle = puzzle;
+            slot.solution = solution;
+            slot.tag.store(tag, std::memory_order_release);
+            header().count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] auto sync() const noexcept -> bool {
+            return msync(m_base, m_size, MS_SYNC) == 0;
+        }
+    };
+} /* namespace */
+
+namespace solve {
+    struct solution_store::impl {
+        std::filesystem::path path;
+        int lock_fd = -1;
+        table current;
+
+        ~impl() {
+            if (lock_fd != -1) {
+                close(lock_fd);
+            }
+        }
+
+        [[nodiscard]] auto writable() const noexcept -> bool {
+            return lock_fd != -1;
+        }
+
+        // Rebuilds the table at twice the size and swaps it in.
+        [[nodiscard]] auto grow() -> tl::expected<void, io_error> {
+            auto const capacity = current.header().capacity * 2;
+            auto temporary = path;
+            temporary += ".tmp";
+
+            auto grown = table::create(temporary, capacity).and_then([&temporary] {
+                return table::map(temporary, true);
+            });
+
+            if (!grown.has_value()) {
+                return tl::unexpected(std::move(grown).error());
+            }
+
+            for (std::uint64_t slot = 0; slot < current.header().capacity; ++slot) {
+                auto const& old = current.entry(slot);
+                auto const tag = old.tag.load(std::memory_order_relaxed);
+
+                if (tag != 0) {
+                    grown->publish(*grown->probe(old.puzzle, tag), old.puzzle, old.solution, tag);
+                }
+            }
+
+            // Readers that pick up the new table must find all of it there.
+            auto error = std::error_code();
+            auto const synced = grown->sync();
+            if (synced) {
+                std::filesystem::rename(temporary, path, error);
+            }
+
+            if (!synced || error) {
+                return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                            fmt::format("Could not replace {}.", path.string())));
+            }
+
+            current = std::move(grown).value();
+            return {};
+        }
+    };
+
+    solution_store::solution_store(std::unique_ptr<impl> state) noexcept
+        : m_impl{std::move(state)} {}
+
+    solution_store::solution_store(solution_store&& other) noexcept = default;
+    auto solution_store::operator=(solution_store&& other) noexcept
+        -> solution_store& = default;
+    solution_store::~solution_store() = default;
+
+    auto solution_store::open(std::filesystem::path const& path)
+        -> tl::expected<solution_store, io_error> {
+
+        auto state = std::make_unique<impl>();
+        state->path = path;
+
+        auto lock_path = path;
+        lock_path += ".lock";
+        state->lock_fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+        if (state->lock_fd == -1) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not open {}.", lock_path.string())));
+        }
+
+        if (flock(state->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+            close(std::exchange(state->lock_fd, -1));
+
+            auto store = solution_store(std::move(state));
+            if (auto refreshed = store.refresh(); !refreshed.has_value()) {
+                return tl::unexpected(std::move(refreshed).error());
+            }
+
+            return store;
+        }
+
+        // Only the writer creates tables, and only under the lock, so readers
+        // never see one that's half written.
+        if (!std::filesystem::exists(path)) {
+            auto temporary = path;
+            temporary += ".tmp";
+            auto error = std::error_code();
+
+            auto created = table::create(temporary, initial_capacity);
+            if (!created.has_value()) {
+                return tl::unexpected(std::move(created).error());
+            }
+
+            std::filesystem::rename(temporary, path, error);
+            if (error) {
+                return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                            fmt::format("Could not create {}.", path.string())));
+            }
+        }
+
+        auto mapped = table::map(path, true);
+        if (!mapped.has_value()) {
+            return tl::unexpected(std::move(mapped).error());
+        }
+
+        state->current = std::move(mapped).value();
+        return solution_store(std::move(state));
+    }
+
+    auto solution_store::writable() const noexcept -> bool {
+        return m_impl->writable();
+    }
+
+    auto solution_store::size() const noexcept -> std::uint64_t {
+        return m_impl->current.valid()
+            ? m_impl->current.header().count.load(std::memory_order_relaxed) : 0;
+    }
+
+    auto solution_store::find(sudoku const& puzzle) const noexcept -> std::optional<sudoku> {
+        if (!m_impl->current.valid()) {
+            return std::nullopt;
+        }
+
+        auto const packed = pack(puzzle);
+        auto const* const slot = m_impl->current.probe(packed, hash(packed));
+
+        if (slot == nullptr || slot->tag.load(std::memory_order_relaxed) == 0) {
+            return std::nullopt;
+        }
+
+        // Guards against tables that were damaged on disk or written by
+        // something else, which may hold a valid grid that just isn't this
+        // puzzle's solution.
+        auto solution = unpack(slot->solution);
+        if (!verify_sudoku(solution) || !keeps_givens(puzzle, solution)) {
+            return std::nullopt;
+        }
+
+        return solution;
+    }
+
+    auto solution_store::insert(sudoku const& puzzle, sudoku const& solution)
+        -> tl::expected<void, io_error> {
+
+        assert(writable() && "Only the writer may insert.");
+
+        auto& current = m_impl->current;
+        if (too_full(current.header().count.load(std::memory_order_relaxed) + 1,
+                    current.header().capacity)) {
+
+            if (auto grown = m_impl->grow(); !grown.has_value()) {
+                return grown;
+            }
+        }
+
+        auto const packed = pack(puzzle);
+        auto const tag = hash(packed);
+        auto* const slot = current.probe(packed, tag);
+
+        if (slot == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::FORMAT_ERROR,
+                        fmt::format("{} is full.", m_impl->path.string())));
+        }
+
+        if (slot->tag.load(std::memory_order_relaxed) == 0) {
+            current.publish(*slot, packed, pack(solution), tag);
+        }
+
+        return {};
+    }
+
+    auto solution_store::refresh() -> tl::expected<void, io_error> {
+        if (writable()) {
+            return {};
+        }
+
+        struct stat info = {};
+        if (stat(m_impl->path.c_str(), &info) != 0) {
+            // Nobody has written anything yet.
+            return {};
+        }
+
+        if (m_impl->current.valid() && info.st_ino == m_impl->current.inode()) {
+            return {};
+        }
+
+        auto mapped = table::map(m_impl->path, false);
+        if (!mapped.has_value()) {
+            return tl::unexpected(std::move(mapped).error());
+        }
+
+        m_impl->current = std::move(mapped).value();
+        return {};
+    }
+
+    auto solution_store::sync() -> tl::expected<void, io_error> {
+        if (!writable() || m_impl->current.sync()) {
+            return {};
+        }
+
+        return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                    fmt::format("Could not sync {}.", m_impl->path.string())));
+    }
+} /* namespace solve */
@@ -0,0 +1,73 @@
+#ifndef SOLUTION_STORE_HPP
+#define SOLUTION_STORE_HPP
+
+#include "data.hpp"
+#include "input.hpp"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace solve {
+    // Solutions of earlier runs, kept in a memory mapped hash table on disk
+    // and keyed by the puzzle with its cells packed into four bits each.
+    //
+    // Any number of processes may look things up while one of them writes.
+    // The writer fills in a free slot and only then publishes it by storing
+    // its tag with release semantics, so readers, which load tags with
+    // acquire semantics, never see half an entry. Entries are never changed
+    // or removed once published. When the table gets too full, the writer
+    // builds a copy twice the size next to it and renames it over the old
+    // one. Readers keep using the old copy until they call refresh.
+    //
+    // The writer holds an flock on `<path>.lock` for as long as the store is
+    // open, which stays put when the table itself is replaced. Tables are in
+    // native byte order and meant to stay on the machine that wrote them.
+    class solution_store {
+        private:
+        struct impl;
+        std::unique_ptr<impl> m_impl;
+
+        explicit solution_store(std::unique_ptr<impl> state) noexcept;
+
+        public:
+        // Opens the store at `path` for writing, creating it if needed. If
+        // another process is writing to it already, it is opened read-only
+        // instead, and a store that doesn't exist yet looks empty until
+        // refresh finds it.
+        [[nodiscard]] static auto open(std::filesystem::path const& path)
+            -> tl::expected<solution_store, io_error>;
+
+        solution_store(solution_store&& other) noexcept;
+        auto operator=(solution_store&& other) noexcept -> solution_store&;
+        ~solution_store();
+
+        [[nodiscard]] auto writable() const noexcept -> bool;
+        // Number of solutions in the store, as far as this process can see.
+        [[nodiscard]] auto size() const noexcept -> std::uint64_t;
+
+        // The stored solution of `puzzle`, if there is one that verifies and
+        // keeps its givens.
+        // Safe to call from several threads at once, but not while the same
+        // process inserts or refreshes.
+        [[nodiscard]] auto find(sudoku const& puzzle) const noexcept -> std::optional<sudoku>;
+
+        // Records the solution of a puzzle that isn't in the store yet. Only
+        // for writable stores.
+        [[nodiscard]] auto insert(sudoku const& puzzle, sudoku const& solution)
+            -> tl::expected<void, io_error>;
+
+        // Switches a read-only store over to the table that's currently at
+        // its path, if the writer has replaced it since. Does nothing for the
+        // writer.
+        [[nodiscard]] auto refresh() -> tl::expected<void, io_error>;
+
+        // Waits until everything inserted so far has reached the disk.
+        [[nodiscard]] auto sync() -> tl::expected<void, io_error>;
+    };
+} /* namespace solve */
+
+#endif // SOLUTION_STORE_HPP
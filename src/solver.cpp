@@ -1,18 +1,26 @@
 #include "solver.hpp"
+#include "propagation.hpp"
 #include "toroidal_list.hpp"
+#include "trace.hpp"
+#include "utility.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
-#include <numeric>
 #include <memory>
 #include <random>
+#include <type_traits>
+#include <variant>
 #include <vector>
 #include <utility>
 
-static auto encode_sudoku(solve::sudoku const& s) noexcept -> solve::toroidal_list {
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-    auto list = solve::toroidal_list();
+static void encode_sudoku(solve::cover_matrix& list,
+        solve::sudoku const& s) noexcept {
 
     for (unsigned y = 0; y < 9; ++y) {
         for (unsigned x = 0; x < 9; ++x) {
@@ -23,9 +31,29 @@ static auto encode_sudoku(solve::sudoku const& s) noexcept -> solve::toroidal_li
             }
         }
     }
+}
+
+// Like encode_sudoku, but stops at the first given that clashes with the ones
+// before it instead of breaking the matrix.
+[[nodiscard]] static auto try_encode_sudoku(solve::cover_matrix& list,
+        solve::sudoku const& s) noexcept -> bool {
+
+    for (unsigned i = 0; i < solve::sudoku::field_size; ++i) {
+        auto value = s.data[i];
+
+        if (value != solve::sudoku::empty_field) {
+            auto const row = static_cast<int>(value - 1 + i * 9);
 
-    return list;
-};
+            if (!list.row_available(row)) {
+                return false;
+            }
+
+            list.cover_row(row);
+        }
+    }
+
+    return true;
+}
 
 static auto reencode(solve::sudoku const& constraints,
         std::vector<int> const& indices) -> solve::sudoku {
@@ -43,31 +71,108 @@ static auto reencode(solve::sudoku const& constraints,
     return result;
 }
 
+#if defined(__AVX2__)
+// Moves the 16 bit lanes of `v` down by N lanes, shifting in zeros. Unlike the
+// plain byte shifts, this crosses the boundary between the two 128 bit halves.
+template <int N>
+static auto shift_lanes(__m256i v) noexcept -> __m256i {
+    static_assert(N > 0 && N < 8, "Can only shift by up to seven lanes.");
+    auto const upper = _mm256_permute2x128_si256(v, v, 0x81);
+    return _mm256_alignr_epi8(upper, v, 2 * N);
+}
+
+// Lane i of the result holds the union of lanes i, i + 1 and i + 2.
+static auto fold_triples(__m256i v) noexcept -> __m256i {
+    return _mm256_or_si256(v, _mm256_or_si256(shift_lanes<1>(v), shift_lanes<2>(v)));
+}
+#endif
+
 namespace solve {
-    auto verify_sudoku(sudoku const& s) noexcept -> bool {
-        auto const mask = std::uint16_t{0b00000001'11111111};
-        auto accumulator = [] (std::uint16_t sum, std::int8_t elem) -> std::uint16_t {
-            // just set a high bit to fail if we encounter a bad element
-            if (elem <= 0 || elem > 9) {
-                return sum | 0b1u << 10;
+    auto verify_sudoku(bitboard const& b) noexcept -> bool {
+        // A unit is valid iff the union of its cells is all nine digits: nine
+        // cells with at most one bit each can only cover nine digits if they
+        // are pairwise distinct. Empty or invalid cells are zero and thus
+        // always make the union come up short. This lets us AND the unions of
+        // all 27 units together and compare just once at the end.
+#if defined(__AVX2__)
+        __m256i rows[9];
+        for (unsigned y = 0; y < 9; ++y) {
+            rows[y] = _mm256_load_si256(
+                    reinterpret_cast<__m256i const*>(&b.cells[y * bitboard::row_stride]));
+        }
+
+        auto columns = _mm256_setzero_si256();
+        auto row_units = _mm256_set1_epi16(-1);
+        auto block_units = _mm256_set1_epi16(-1);
+
+        for (unsigned y = 0; y < 9; ++y) {
+            columns = _mm256_or_si256(columns, rows[y]);
+            // Lane 0 ends up holding the union of the whole row.
+            auto const triples = fold_triples(rows[y]);
+            auto const row = _mm256_or_si256(triples, _mm256_or_si256(
+                        shift_lanes<3>(triples), shift_lanes<6>(triples)));
+            row_units = _mm256_and_si256(row_units, row);
+        }
+
+        for (unsigned band = 0; band < 3; ++band) {
+            auto const band_union = _mm256_or_si256(rows[3 * band],
+                    _mm256_or_si256(rows[3 * band + 1], rows[3 * band + 2]));
+            // Lanes 0, 3 and 6 hold the unions of the band's three blocks.
+            block_units = _mm256_and_si256(block_units, fold_triples(band_union));
+        }
+
+        auto const all_digits = _mm256_set1_epi16(bitboard::all_digits);
+        auto const column_bits = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi16(columns, all_digits));
+        auto const row_bits = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi16(row_units, all_digits));
+        auto const block_bits = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi16(block_units, all_digits));
+
+        // Two mask bits per 16 bit lane.
+        return (column_bits & 0x3ffff) == 0x3ffff
+            && (row_bits & 0x3) == 0x3
+            && (block_bits & 0x30c3) == 0x30c3;
+#else
+        auto columns = std::array<std::uint16_t, 9>{};
+        auto blocks = std::array<std::uint16_t, 9>{};
+        auto units = bitboard::all_digits;
+
+        for (unsigned y = 0; y < 9; ++y) {
+            auto row = std::uint16_t{0};
+
+            for (unsigned x = 0; x < 9; ++x) {
+                auto const cell = b.cells[bitboard::index(x, y)];
+                row |= cell;
+                columns[x] |= cell;
+                blocks[x / 3 + (y / 3) * 3] |= cell;
             }
 
-            return sum | 0b1u << (elem - 1);
-        };
+            units &= row;
+        }
 
         for (unsigned i = 0; i < 9; ++i) {
-            auto row_range = s.iterate_from(sudoku::row_tag{}, i);
-            auto column_range = s.iterate_from(sudoku::column_tag{}, i);
-            auto block_range = s.iterate_from(sudoku::block_tag{}, i);
-
-            auto row_mask = std::accumulate(row_range.begin, row_range.end,
-                    std::uint16_t{0}, accumulator);
-            auto column_mask = std::accumulate(column_range.begin, column_range.end,
-                    std::uint16_t{0}, accumulator);
-            auto block_mask = std::accumulate(block_range.begin, block_range.end,
-                    std::uint16_t{0}, accumulator);
-
-            if (row_mask != mask || column_mask != mask || block_mask != mask) {
+            units &= columns[i] & blocks[i];
+        }
+
+        return units == bitboard::all_digits;
+#endif
+    }
+
+    auto verify_sudoku(sudoku const& s) noexcept -> bool {
+        return verify_sudoku(bitboard(s));
+    }
+
+    auto verify_sudoku(sudoku const& s, puzzle_variant variant) noexcept -> bool {
+        return verify_sudoku(s) && (variant == puzzle_variant::classic
+                || verify_variant_rules(s, variant));
+    }
+
+    auto keeps_givens(sudoku const& puzzle, sudoku const& solution) noexcept -> bool {
+        for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+            if (puzzle.data[cell] != sudoku::empty_field
+                    && puzzle.data[cell] != solution.data[cell]) {
+
                 return false;
             }
         }
@@ -75,10 +180,224 @@ namespace solve {
         return true;
     }
 
+    solver_context::solver_context() {
+        m_indices.reserve(sudoku::field_size);
+    }
+
+    auto solver_context::solve(sudoku const& s, backend engine,
+            puzzle_variant variant) noexcept -> sudoku {
+
+        if (variant != puzzle_variant::classic) {
+            return solve_variant(s, engine, variant);
+        }
+
+        switch (engine) {
+            case backend::dancing_links:
+                return solve_dancing_links(s);
+            case backend::hybrid:
+                return solve_hybrid(s);
+        }
+
+        unreachable();
+        return s;
+    }
+
+    auto solver_context::solve_dancing_links(sudoku const& s) noexcept -> sudoku {
+        {
+            auto const encode_scope = trace::scope(trace::phase::encode);
+
+            if (!m_pristine) {
+                m_list.reset();
+            }
+
+            m_pristine = false;
+
+            // Clashing givens have no solution, and covering them would
+            // break the matrix.
+            if (!try_encode_sudoku(m_list, s)) {
+                return s;
+            }
+        }
+
+        {
+            auto const search_scope = trace::scope(trace::phase::search);
+            auto const visited = m_list.nodes_visited();
+            m_list.solve(m_indices);
+            m_search_nodes += m_list.nodes_visited() - visited;
+        }
+
+        auto const decode_scope = trace::scope(trace::phase::decode);
+        return reencode(s, m_indices);
+    }
+
+    auto solver_context::solve_hybrid(sudoku const& s) noexcept -> sudoku {
+        auto grid = candidate_grid(s);
+
+        auto const result = [&grid] {
+            auto const propagate_scope = trace::scope(trace::phase::propagate);
+            return propagate(grid);
+        }();
+
+        switch (result) {
+            case propagation_result::solved:
+                return grid.values();
+            case propagation_result::contradiction:
+                // There is no solution, and we must not feed conflicting
+                // givens to the matrix either.
+                return s;
+            case propagation_result::stuck:
+                break;
+        }
+
+        // Everything propagation filled in is covered up front, so the search
+        // only has to deal with the cells that are actually left.
+        return solve_dancing_links(grid.values());
+    }
+
+    auto solver_context::variant_matrix(puzzle_variant variant) -> cover_matrix& {
+        return visit_rules(variant, [this] (auto rules) -> cover_matrix& {
+            using list_type = basic_toroidal_list<decltype(rules)>;
+
+            if constexpr (std::is_same_v<list_type, toroidal_list>) {
+                if (!m_pristine) {
+                    m_list.reset();
+                }
+
+                m_pristine = false;
+                return m_list;
+            } else {
+                if (auto* list = std::get_if<list_type>(&m_variant_list)) {
+                    list->reset();
+                    return *list;
+                }
+
+                return m_variant_list.template emplace<list_type>();
+            }
+        });
+    }
+
+    auto solver_context::solve_variant(sudoku const& s, backend engine,
+            puzzle_variant variant) noexcept -> sudoku {
+
+        auto start = s;
+
+        if (engine == backend::hybrid) {
+            auto grid = candidate_grid(s);
+
+            auto const result = [&grid] {
+                auto const propagate_scope = trace::scope(trace::phase::propagate);
+                return propagate(grid);
+            }();
+
+            switch (result) {
+                case propagation_result::solved:
+                    // Every deduction holds under the variant rules too, so
+                    // this is the only candidate. If it breaks them, the
+                    // caller's verification finds out.
+                    return grid.values();
+                case propagation_result::contradiction:
+                    return s;
+                case propagation_result::stuck:
+                    start = grid.values();
+                    break;
+            }
+        }
+
+        auto* list = static_cast<cover_matrix*>(nullptr);
+        {
+            auto const encode_scope = trace::scope(trace::phase::encode);
+            list = &variant_matrix(variant);
+
+            if (!try_encode_sudoku(*list, start)) {
+                return s;
+            }
+        }
+
+        {
+            auto const search_scope = trace::scope(trace::phase::search);
+            auto const visited = list->nodes_visited();
+            list->solve(m_indices);
+            m_search_nodes += list->nodes_visited() - visited;
+        }
+
+        auto const decode_scope = trace::scope(trace::phase::decode);
+        return reencode(start, m_indices);
+    }
+
+    auto solver_context::count_solutions(sudoku const& s, std::uint64_t limit,
+            puzzle_variant variant) -> std::uint64_t {
+
+        auto& list = variant_matrix(variant);
+
+        if (limit == 0 || !try_encode_sudoku(list, s)) {
+            return 0;
+        }
+
+        auto const visited = list.nodes_visited();
+        auto count = std::uint64_t{0};
+        {
+            auto cursor = cover_matrix::solution_cursor(list);
+
+            while (count < limit && cursor.next()) {
+                ++count;
+            }
+        }
+
+        m_search_nodes += list.nodes_visited() - visited;
+        return count;
+    }
+
+    void solver_context::prepare(puzzle_variant variant) {
+        if (variant != puzzle_variant::classic) {
+            (void)variant_matrix(variant);
+        }
+    }
+
+    auto solver_context::search_nodes() const noexcept -> std::uint64_t {
+        return m_search_nodes;
+    }
+
+    solution_range::solution_range(sudoku const& s)
+        : m_puzzle{s}, m_list{}, m_cursor{m_list} {
+
+        // Conflicting givens would leave the matrix in a broken state, and
+        // there aren't any solutions to find anyway.
+        if (candidate_grid(s).contradiction()) {
+            m_exhausted = true;
+            return;
+        }
+
+        encode_sudoku(m_list, s);
+        m_indices.reserve(9 * 9);
+    }
+
+    auto solution_range::advance() noexcept -> bool {
+        if (m_exhausted || !m_cursor.next()) {
+            m_exhausted = true;
+            return false;
+        }
+
+        m_indices.clear();
+        m_cursor.current(m_indices);
+        m_current = reencode(m_puzzle, m_indices);
+        return true;
+    }
+
+    auto solution_range::begin() noexcept -> iterator {
+        return iterator(advance() ? this : nullptr);
+    }
+
+    auto solution_range::end() noexcept -> iterator {
+        return iterator(nullptr);
+    }
+
+    auto thread_context() -> solver_context& {
+        thread_local solver_context context;
+        return context;
+    }
+
     auto solve_sudoku(sudoku const& s) noexcept -> sudoku {
-        auto list = encode_sudoku(s);
-        auto indices = list.solve();
-        auto solution = reencode(s, indices);
-        return solution;
+        auto context = solver_context();
+        return context.solve(s);
     }
 }
@@ -2,11 +2,169 @@
 #define SOLVER_HPP
 
 #include "data.hpp"
+#include "toroidal_list.hpp"
+#include "variants.hpp"
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <random>
+#include <variant>
+#include <vector>
 
 namespace solve {
+    enum class backend {
+        // Plain dancing links search over the full exact cover matrix.
+        dancing_links,
+        // Logical propagation first, dancing links only for whatever is left.
+        hybrid
+    };
+
+    // Holds everything a solve needs besides the puzzle itself. Keeping one of
+    // these around and reusing it spares us from allocating and wiring up a
+    // fresh matrix for every single puzzle.
+    class solver_context {
+        private:
+        toroidal_list m_list;
+        bool m_pristine = true;
+        // Rows of the last solution, kept around so solving doesn't allocate.
+        std::vector<int> m_indices;
+        std::uint64_t m_search_nodes = 0;
+        // The matrix of the last variant solved, built on first use.
+        std::variant<std::monostate, basic_toroidal_list<x_rules>,
+            basic_toroidal_list<windoku_rules>,
+            basic_toroidal_list<anti_knight_rules>> m_variant_list;
+
+        [[nodiscard]] auto solve_dancing_links(sudoku const& s) noexcept -> sudoku;
+        [[nodiscard]] auto solve_hybrid(sudoku const& s) noexcept -> sudoku;
+        // A fresh matrix for the given rules, reusing the old one if it has
+        // the same rules.
+        [[nodiscard]] auto variant_matrix(puzzle_variant variant) -> cover_matrix&;
+        [[nodiscard]] auto solve_variant(sudoku const& s, backend engine,
+                puzzle_variant variant) noexcept -> sudoku;
+
+        public:
+        solver_context();
+
+        // Classic puzzles never touch the variant matrices. Variant puzzles
+        // get the same propagation as classic ones, which only ever deduces
+        // things the extra rules agree with, and a matrix with the extra
+        // columns for the search.
+        [[nodiscard]] auto solve(sudoku const& s, backend engine = backend::hybrid,
+                puzzle_variant variant = puzzle_variant::classic) noexcept -> sudoku;
+
+        // Rows the dancing links search tried over all puzzles solved or
+        // counted with this context. Doesn't depend on timing, so it's what
+        // the performance regression test compares.
+        [[nodiscard]] auto search_nodes() const noexcept -> std::uint64_t;
+
+        // Counts the solutions of `s`, stopping at `limit`.
+        [[nodiscard]] auto count_solutions(sudoku const& s, std::uint64_t limit,
+                puzzle_variant variant = puzzle_variant::classic) -> std::uint64_t;
+
+        // Builds the matrix for `variant` now instead of on first use, where
+        // solve has no way to report running out of memory.
+        void prepare(puzzle_variant variant);
+    };
+
+    // A context of the calling thread's own, created on its first call and
+    // kept until the thread exits. Everything that only needs a context for
+    // the length of one call can share it instead of building a matrix each
+    // time.
+    [[nodiscard]] auto thread_context() -> solver_context&;
+
+    // Lazily yields every solution of a sudoku, one at a time and in search
+    // order. Only the current solution and the search stack are kept around,
+    // so memory use stays the same no matter how many solutions there are,
+    // and breaking out of a loop over the range simply ends the search.
+    //
+    //     for (auto const& solution : solve::solution_range(puzzle)) { ... }
+    class solution_range {
+        private:
+        sudoku m_puzzle;
+        toroidal_list m_list;
+        toroidal_list::solution_cursor m_cursor;
+        std::vector<int> m_indices;
+        sudoku m_current;
+        bool m_exhausted = false;
+
+        auto advance() noexcept -> bool;
+
+        public:
+        class iterator {
+            public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = sudoku;
+            using pointer = sudoku const*;
+            using reference = sudoku const&;
+            using iterator_category = std::input_iterator_tag;
+
+            private:
+            solution_range* m_range = nullptr;
+
+            friend class solution_range;
+
+            explicit iterator(solution_range* range) noexcept : m_range{range} {}
+
+            [[nodiscard]] friend auto operator==(iterator a, iterator b) noexcept -> bool {
+                return a.m_range == b.m_range;
+            }
+
+            [[nodiscard]] friend auto operator!=(iterator a, iterator b) noexcept -> bool {
+                return a.m_range != b.m_range;
+            }
+
+            public:
+            iterator() = default;
+
+            auto operator++() noexcept -> iterator& {
+                if (!m_range->advance()) {
+                    m_range = nullptr;
+                }
+
+                return *this;
+            }
+
+            void operator++(int) noexcept {
+                ++*this;
+            }
+
+            [[nodiscard]] auto operator*() const noexcept -> reference {
+                assert(m_range != nullptr && "Tried to dereference invalid iterator.");
+                return m_range->m_current;
+            }
+
+            [[nodiscard]] auto operator->() const noexcept -> pointer {
+                assert(m_range != nullptr && "Tried to dereference invalid iterator.");
+                return &m_range->m_current;
+            }
+        };
+
+        explicit solution_range(sudoku const& s);
+
+        // The cursor refers to the list, so neither may move around.
+        solution_range(solution_range const&) = delete;
+        solution_range(solution_range&&) = delete;
+
+        auto operator=(solution_range const&) -> solution_range& = delete;
+        auto operator=(solution_range&&) -> solution_range& = delete;
+
+        ~solution_range() = default;
+
+        // Starts the search. As with any input range, this may only be
+        // called once.
+        [[nodiscard]] auto begin() noexcept -> iterator;
+        [[nodiscard]] auto end() noexcept -> iterator;
+    };
+
     [[nodiscard]] auto verify_sudoku(sudoku const& s) noexcept -> bool;
+    [[nodiscard]] auto verify_sudoku(bitboard const& b) noexcept -> bool;
+    // Also checks the rules of the given variant.
+    [[nodiscard]] auto verify_sudoku(sudoku const& s, puzzle_variant variant) noexcept -> bool;
+    // Whether every filled cell of `puzzle` holds the same digit in `solution`.
+    [[nodiscard]] auto keeps_givens(sudoku const& puzzle, sudoku const& solution) noexcept
+        -> bool;
     [[nodiscard]] auto solve_sudoku(sudoku const& s) noexcept -> sudoku; 
 } /* namespace solve */
 
@@ -0,0 +1,116 @@
+#ifndef SSOLVE_H
+#define SSOLVE_H
+
+// Plain C interface to the solver, for embedding it into programs written in
+// other languages. Everything here works on buffers owned by the caller. With
+// `threads` set to one, nothing allocates once a context has seen a batch of
+// the size at hand. With more, every batch still starts its worker threads,
+// which allocates a little each time.
+//
+// A context may be used by one thread at a time. Use one context per thread,
+// or let a single context spread batches over several threads.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SSOLVE_API __attribute__((visibility("default")))
+#else
+#define SSOLVE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a function or struct changes in an incompatible way.
+#define SSOLVE_ABI_VERSION 1
+
+typedef enum ssolve_error {
+    SSOLVE_OK = 0,
+    // The puzzle has no solution, or its givens clash.
+    SSOLVE_UNSOLVABLE = 1,
+    // A puzzle isn't in the given format.
+    SSOLVE_INVALID_PUZZLE = 2,
+    // A null pointer where there must be none, an unknown format, variant or
+    // backend, or a stride smaller than a puzzle.
+    SSOLVE_INVALID_ARGUMENT = 3,
+    SSOLVE_OUT_OF_MEMORY = 4,
+    // Anything else that went wrong inside the library, such as a worker
+    // thread that couldn't be started.
+    SSOLVE_INTERNAL_ERROR = 5
+} ssolve_error;
+
+typedef enum ssolve_format {
+    // 81 bytes, one per cell, row by row: '1' to '9', or '.' or '0' for an
+    // empty cell. Solutions are written as 81 digits without a terminator.
+    SSOLVE_FORMAT_TEXT = 0,
+    // 41 bytes, four bits per cell: cell i is in the low half of byte i / 2
+    // if i is even and in the high half otherwise, 0 for an empty cell.
+    SSOLVE_FORMAT_PACKED = 1
+} ssolve_format;
+
+typedef enum ssolve_variant {
+    SSOLVE_VARIANT_CLASSIC = 0,
+    SSOLVE_VARIANT_X = 1,
+    SSOLVE_VARIANT_WINDOKU = 2,
+    SSOLVE_VARIANT_ANTI_KNIGHT = 3
+} ssolve_variant;
+
+typedef enum ssolve_backend {
+    SSOLVE_BACKEND_HYBRID = 0,
+    SSOLVE_BACKEND_DANCING_LINKS = 1
+} ssolve_backend;
+
+typedef struct ssolve_options {
+    // Must be sizeof(ssolve_options), which lets later versions add fields.
+    size_t struct_size;
+    // Worker threads per batch, zero for one per hardware thread. With more
+    // than one, every batch starts and joins its workers.
+    unsigned threads;
+    ssolve_variant variant;
+    ssolve_backend backend;
+} ssolve_options;
+
+typedef struct ssolve_context ssolve_context;
+
+SSOLVE_API unsigned ssolve_abi_version(void);
+SSOLVE_API char const* ssolve_error_string(ssolve_error error);
+// Bytes per puzzle in the given format, or 0 for an unknown format.
+SSOLVE_API size_t ssolve_format_size(ssolve_format format);
+
+// Fills in the defaults: one thread, classic rules, hybrid backend.
+SSOLVE_API void ssolve_default_options(ssolve_options* options);
+
+// `options` may be null for the defaults.
+SSOLVE_API ssolve_error ssolve_context_create(ssolve_options const* options,
+        ssolve_context** context);
+SSOLVE_API void ssolve_context_destroy(ssolve_context* context);
+
+// Solves a single puzzle. `solution` is only written to on success.
+SSOLVE_API ssolve_error ssolve_solve(ssolve_context* context, ssolve_format format,
+        void const* puzzle, void* solution);
+
+// Solves `count` puzzles, the i-th of which starts `i * puzzle_stride` bytes
+// into `puzzles`, and writes their solutions `solution_stride` bytes apart
+// into `solutions`. A stride of 82 reads and writes newline separated text;
+// the bytes between puzzles are left alone, and both buffers may be the
+// same. Unsolvable puzzles are written back as given, invalid ones not at
+// all. If `errors` isn't null, errors[i] receives the outcome of puzzle i,
+// and if `solved` isn't null, it receives the number of puzzles solved.
+// Returns SSOLVE_INVALID_PUZZLE if any puzzle was invalid, as that's the
+// only per-puzzle error that calls for a look at the input.
+SSOLVE_API ssolve_error ssolve_solve_batch(ssolve_context* context, ssolve_format format,
+        void const* puzzles, size_t puzzle_stride, size_t count, void* solutions,
+        size_t solution_stride, ssolve_error* errors, size_t* solved);
+
+// Counts the solutions of a puzzle, stopping at `limit`. A limit of 2 tells
+// unique puzzles apart from the rest.
+SSOLVE_API ssolve_error ssolve_count_solutions(ssolve_context* context,
+        ssolve_format format, void const* puzzle, uint64_t limit, uint64_t* count);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // SSOLVE_H
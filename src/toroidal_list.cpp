@@ -2,14 +2,8 @@
 
 #include "utility.hpp"
 
-#include <algorithm>
 #include <array>
 #include <cassert>
-#include <iterator>
-#include <limits>
-#include <tuple>
-#include <utility>
-#include <vector>
 
 namespace {
     struct sudoku_coordinates {
@@ -73,279 +67,57 @@ namespace {
 } /* namespace */
 
 namespace solve {
-
-    toroidal_list::node::node(column_head* head,
-            std::variant<toroidal_list::node*, toroidal_list::column_head*> up) noexcept
-        : m_header{head}, m_left{this}, m_right{this}, m_up(up), m_down(head) {}
-
-    auto toroidal_list::node::left() const noexcept -> toroidal_list::node* {
-        return m_left;
-    }
-
-    auto toroidal_list::node::right() const noexcept -> toroidal_list::node* {
-        return m_right;
-    }
-
-    auto toroidal_list::node::header() const noexcept -> toroidal_list::column_head* {
-        return m_header;
-    }
-
-    auto toroidal_list::node::up() const noexcept
-        -> std::variant<toroidal_list::node*, toroidal_list::column_head*> {
-
-        return m_up;
-    }
-
-    auto toroidal_list::node::down() const noexcept
-        -> std::variant<toroidal_list::node*, toroidal_list::column_head*> {
-
-        return m_down;
-    }
-
-    void toroidal_list::node::unlink_horizontally() noexcept {
-        // Order is important: First right, then left...
-        m_left->m_right = m_right;
-        m_right->m_left = m_left;
-    }
-
-    void toroidal_list::node::relink_horizontally() noexcept {
-        // ...to undo: First left, then right.
-        m_right->m_left = this;
-        m_left->m_right = this;
-    }
-
-    void toroidal_list::node::unlink_vertically() noexcept {
-        // Order is important: First up, then down...
-        std::visit([this] (auto* up) {
-                up->m_down = m_down;
-            }, m_up);
-
-        std::visit([this] (auto* down) {
-                down->m_up = m_up;
-            }, m_down);
-
-        m_header->decrease_count(); 
-    }
-
-    void toroidal_list::node::relink_vertically() noexcept {
-        //...to undo: First down, then up.
-        std::visit([this] (auto* down) {
-                down->m_up = this;
-            }, m_down);
-
-        std::visit([this] (auto* up) {
-                up->m_down = this;
-            }, m_up);
-
-        m_header->increase_count();
-    }
-
-    toroidal_list::column_head::column_head(toroidal_list::column_head* left,
-            toroidal_list::column_head* right)
-        : m_left{left}, m_right{right}, m_up{this}, m_down{this} {}
-
-    void toroidal_list::column_head::increase_count() noexcept {
-        m_count += 1;
-    }
-
-    void toroidal_list::column_head::decrease_count() noexcept {
-        assert(m_count > 0 && "Trying to decrement count beyond zero");
-        m_count -= 1;
-    }
-
-    void toroidal_list::column_head::unlink() noexcept {
-        m_right->m_left = m_left;
-        m_left->m_right = m_right;
-    }
-
-    void toroidal_list::column_head::relink() noexcept {
-        m_left->m_right = this;
-        m_right->m_left = this;
-    }
-
-    void toroidal_list::column_head::cover() noexcept {
-        unlink();
-
-        traverse(down_tag{}, [] (auto& down) {
-            down.traverse(right_tag{}, [] (auto& right) {
-                right.unlink_vertically();
-            });
-        });
-    }
-
-    void toroidal_list::column_head::uncover() noexcept {
-
-        traverse(up_tag{}, [] (auto& up) {
-            up.traverse(left_tag{}, [] (auto& left) {
-                left.relink_vertically();
-            });    
-        });
-
-        relink();
-    }
-    
-    toroidal_list::toroidal_list() {
-        make_columns(); 
-        make_rows();
-    }
-
-    void toroidal_list::make_columns() noexcept {
-        auto& headers = m_storage->headers; 
-
-        for (std::size_t i = 1; i < headers.size(); ++i) {
-            headers[i - 1].m_right = &headers[i];
-            headers[i].m_left = &headers[i - 1];
-        }
-
-        headers[0].m_left = &headers.back();
-        headers.back().m_right = &headers[0];
-    }
-
-    void toroidal_list::make_rows() noexcept {
-        auto& nodes = m_storage->nodes;
-        auto& headers = m_storage->headers;
-
-        auto last_vertical_nodes = std::array<node*, columns>{};
-
-        auto vertically_link = [&last_vertical_nodes, &headers]
-            (node& n, int column_index) {
-
-            // + 1 for the head node.
-            auto& current_header = headers[column_index + 1];
-
-            n.m_header = &current_header;
-            current_header.increase_count();
-
-            if (last_vertical_nodes[column_index] == nullptr) {
-                n.m_up = &current_header;
-                current_header.m_down = &n;
-            } else {
-                n.m_up = last_vertical_nodes[column_index];
-                last_vertical_nodes[column_index]->m_down = &n;
-            }
-
-            last_vertical_nodes[column_index] = &n;
-        };
-
-        for (std::size_t row_num = 0; row_num < nodes.size() / 4; ++row_num) {
-
-            auto const row_index = row_num * 4;
-
-            auto const zero_index = calculate_column_index(0, row_num);
-            vertically_link(nodes[row_index], zero_index);
-
-            for (int i = 1; i < 4; ++i) {
-                auto const index = calculate_column_index(i, row_num);
-
-                auto& current_node = nodes[row_index + i];
-                auto& last_node = nodes[row_index + i - 1];
-
-                current_node.m_left = &last_node;
-                last_node.m_right = &current_node;
-                
-                vertically_link(current_node, index);
+    template <typename Rules>
+    basic_toroidal_list<Rules>::basic_toroidal_list() {
+        using traits = rule_traits<Rules>;
+        constexpr auto first_extra = 9 * 9 * 4;
+
+        // Units and edges each cell lies on, so rows can look them up.
+        auto cell_units = std::array<std::array<int, 2>, sudoku::field_size>{};
+        auto cell_edges = std::array<std::array<int, 8>, sudoku::field_size>{};
+        auto unit_counts = std::array<int, sudoku::field_size>{};
+        auto edge_counts = std::array<int, sudoku::field_size>{};
+
+        for (int unit = 0; unit < traits::unit_count; ++unit) {
+            for (auto cell : Rules::units[unit]) {
+                cell_units[cell][unit_counts[cell]++] = unit;
             }
-
-            // Finally, make the horizontal wrap-around links.
-            nodes[row_index + 3].m_right = &nodes[row_index];
-            nodes[row_index].m_left = &nodes[row_index + 3];
         }
 
-        // Make the vertical wrap-around links.
-        for (auto* n : last_vertical_nodes) {
-            n->m_header->m_up = n;
-            n->m_down = n->m_header;
-        }
-    }
-
-    void toroidal_list::cover_row(int index) noexcept {
-        assert(index >= 0 && index < rows && "Row index out of range.");
-
-        auto& node = m_storage->nodes[index * 4];
-
-        node.traverse(right_tag{}, [] (auto& right) {
-            right.m_header->cover();
-        });
-
-        node.m_header->cover();
-    }
-
-    auto toroidal_list::select_next_head() noexcept -> toroidal_list::column_head& {
-        auto min_count = std::numeric_limits<int>::max();
-        column_head* min_head = &m_storage->headers[0];
-
-        min_head->traverse(right_tag{}, [&min_count, &min_head] (auto& right) mutable {
-
-            // Sadly, we need this because std::tie takes lvalue references so
-            // simply passing &right does not work.
-            auto* right_ptr = &right;
-            std::tie(min_count, min_head) = std::min(std::tie(min_count, min_head),
-                    std::tie(right.m_count, right_ptr), 
-                    [] (auto a, auto b) {
-                        return std::get<0>(a) < std::get<0>(b);
-            });
-        });
-
-        return *min_head;
-    }
-
-    auto toroidal_list::solve_impl(std::vector<node*>& solutions, int index) noexcept
-        -> bool {
-
-        auto& root = m_storage->headers[0];
-
-        if (&root == root.m_right) {
-            return true;
+        for (int edge = 0; edge < traits::edge_count; ++edge) {
+            for (auto cell : knight_edges[edge]) {
+                cell_edges[cell][edge_counts[cell]++] = edge;
+            }
         }
 
-        column_head* next_column = &select_next_head();
-        next_column->cover();
+        for (int row_num = 0; row_num < rows; ++row_num) {
+            auto row = std::array<int, 4 + traits::max_row_columns>{
+                calculate_column_index(0, row_num),
+                calculate_column_index(1, row_num),
+                calculate_column_index(2, row_num),
+                calculate_column_index(3, row_num)
+            };
 
-        auto found_solution = next_column->traverse_until(down_tag{}, [&] (auto& down) {
-            auto* down_ptr = &down;
+            auto const num = row_num % 9;
+            auto const cell = row_num / 9;
+            auto size = std::size_t{4};
 
-            solutions[index] = down_ptr;
-
-            down.traverse(right_tag{}, [] (auto& right) {
-                right.m_header->cover();
-            });
-
-            if (solve_impl(solutions, index + 1)) {
-                return true;
+            for (int i = 0; i < unit_counts[cell]; ++i) {
+                row[size++] = first_extra + 9 * cell_units[cell][i] + num;
             }
 
-            down_ptr = solutions[index];
-            next_column = down_ptr->m_header;
-
-            down_ptr->traverse(left_tag{}, [] (auto& left) {
-                left.m_header->uncover();
-            });
-
-            return false;
-        }); 
+            // Secondary columns follow all of the primary ones.
+            for (int i = 0; i < edge_counts[cell]; ++i) {
+                row[size++] = first_extra + traits::primary_columns
+                    + 9 * cell_edges[cell][i] + num;
+            }
 
-        if (found_solution) {
-            return true;
+            this->add_row(row.begin(), row.begin() + size);
         }
-
-        next_column->uncover();
-        return false;
     }
 
-    auto toroidal_list::solve() noexcept -> std::vector<int> {
-        auto result = std::vector<node*>(9 * 9);
-        solve_impl(result, 0);
-
-        auto range_end = std::find(result.begin(), result.end(), nullptr);
-
-        auto indices = std::vector<int>();
-        indices.reserve(result.size());
-
-        std::transform(result.begin(), range_end, std::back_inserter(indices), 
-            [&nodes = m_storage->nodes] (auto* node) {
-                return (node - nodes.data()) / 4;
-            });
-
-        return indices;
-    }
+    template class basic_toroidal_list<classic_rules>;
+    template class basic_toroidal_list<x_rules>;
+    template class basic_toroidal_list<windoku_rules>;
+    template class basic_toroidal_list<anti_knight_rules>;
 } /* namespace solve */
@@ -0,0 +1,391 @@
+#include "trace.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using std::literals::string_view_literals::operator""sv;
+
+namespace {
+    struct event {
+        std::int64_t start;
+        std::int64_t end;
+        std::uint64_t item;
+        solve::trace::phase p;
+    };
+
+    struct thread_buffer {
+        // The batch worker the thread last served as, if any.
+        std::optional<unsigned> worker;
+        std::vector<event> events;
+        // Whether the thread ever opened its counters, and which of them
+        // worked when it did.
+        bool counted = false;
+        std::array<bool, solve::perf::counter_count> available = {};
+        std::array<solve::trace::phase_counters, solve::trace::phase_count> phases = {};
+
+        // Adds the counter totals of `other` to this one.
+        void merge_counters(thread_buffer const& other) noexcept {
+            if (!other.counted) {
+                return;
+            }
+
+            for (std::size_t i = 0; i < solve::perf::counter_count; ++i) {
+                available[i] = (!counted || available[i]) && other.available[i];
+            }
+
+            counted = true;
+
+            for (std::size_t p = 0; p < solve::trace::phase_count; ++p) {
+                phases[p].calls += other.phases[p].calls;
+
+                for (std::size_t i = 0; i < solve::perf::counter_count; ++i) {
+                    phases[p].totals.values[i] += other.phases[p].totals.values[i];
+                }
+            }
+        }
+    };
+
+    // Buffers are owned here rather than by their threads, so that events
+    // outlive the worker threads of a batch.
+    struct registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<thread_buffer>> buffers;
+        // Counter totals of threads that exited without events to keep.
+        thread_buffer retired = {};
+    };
+
+    auto global_registry() -> registry& {
+        static auto instance = registry();
+        return instance;
+    }
+
+    // What each thread holds on to itself. Its counters are file
+    // descriptors and have to be closed when the thread exits, or a process
+    // starting workers for every batch runs out of them. Buffers without
+    // events are folded into the registry's totals then as well.
+    struct thread_state {
+        thread_buffer* buffer = nullptr;
+        std::unique_ptr<solve::perf::thread_counters> counters;
+
+        thread_state() = default;
+        thread_state(thread_state const&) = delete;
+        auto operator=(thread_state const&) -> thread_state& = delete;
+
+        ~thread_state() {
+            if (buffer == nullptr) {
+                return;
+            }
+
+            counters.reset();
+
+            auto& reg = global_registry();
+            auto lock = std::lock_guard(reg.mutex);
+
+            if (!buffer->events.empty()) {
+                return;
+            }
+
+            reg.retired.merge_counters(*buffer);
+
+            auto const found = std::find_if(reg.buffers.begin(), reg.buffers.end(),
+                    [this] (auto const& b) { return b.get() == buffer; });
+            if (found != reg.buffers.end()) {
+                reg.buffers.erase(found);
+            }
+        }
+    };
+
+    auto local_state() -> thread_state& {
+        thread_local auto state = thread_state();
+        return state;
+    }
+
+    auto local_buffer() -> thread_buffer& {
+        auto& state = local_state();
+
+        if (state.buffer == nullptr) {
+            auto& reg = global_registry();
+            auto lock = std::lock_guard(reg.mutex);
+
+            auto& buffer = reg.buffers.emplace_back(std::make_unique<thread_buffer>());
+            buffer->events.reserve(1024);
+
+            state.buffer = buffer.get();
+        }
+
+        return *state.buffer;
+    }
+
+    auto epoch = std::chrono::steady_clock::time_point();
+} /* namespace */
+
+namespace solve::trace {
+    auto phase_to_string(phase p) noexcept -> std::string_view {
+        switch (p) {
+            case phase::parse:
+                return "parse"sv;
+            case phase::solve:
+                return "solve"sv;
+            case phase::propagate:
+                return "propagate"sv;
+            case phase::encode:
+                return "encode"sv;
+            case phase::search:
+                return "search"sv;
+            case phase::decode:
+                return "decode"sv;
+            case phase::output:
+                return "output"sv;
+            default:
+                return ""sv;
+        }
+    }
+
+    namespace detail {
+        std::atomic<bool> enabled = false;
+        std::atomic<bool> counting = false;
+
+        auto now() noexcept -> std::int64_t {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - epoch).count();
+        }
+
+        void record(phase p, std::int64_t start, std::int64_t end, std::uint64_t item) {
+            local_buffer().events.push_back(event{start, end, item, p});
+        }
+
+        auto read_counters() noexcept -> perf::sample {
+            auto& buffer = local_buffer();
+            auto& state = local_state();
+
+            if (state.counters == nullptr) {
+                state.counters = std::make_unique<perf::thread_counters>();
+
+                buffer.counted = true;
+                for (std::size_t i = 0; i < perf::counter_count; ++i) {
+                    buffer.available[i] = state.counters->available(static_cast<perf::counter>(i));
+                }
+            }
+
+            return state.counters->read();
+        }
+
+        void accumulate(phase p, perf::sample const& start) noexcept {
+            auto& buffer = local_buffer();
+            auto const end = local_state().counters->read();
+            auto& totals = buffer.phases[static_cast<std::size_t>(p)];
+
+            totals.calls += 1;
+            for (std::size_t i = 0; i < perf::counter_count; ++i) {
+                totals.totals.values[i] += end.values[i] - start.values[i];
+            }
+        }
+    } /* namespace detail */
+
+    void enable() noexcept {
+        epoch = std::chrono::steady_clock::now();
+        detail::enabled.store(true, std::memory_order_release);
+    }
+
+    void disable() noexcept {
+        detail::enabled.store(false, std::memory_order_release);
+    }
+
+    void set_worker(unsigned worker) {
+        if (enabled()) {
+            local_buffer().worker = worker;
+        }
+    }
+
+    void enable_counters() noexcept {
+        detail::counting.store(true, std::memory_order_release);
+    }
+
+    auto collect_counters() -> counter_report {
+        auto& reg = global_registry();
+        auto lock = std::lock_guard(reg.mutex);
+        auto totals = reg.retired;
+
+        for (auto const& buffer : reg.buffers) {
+            totals.merge_counters(*buffer);
+        }
+
+        auto report = counter_report();
+        report.phases = totals.phases;
+        report.available = totals.available;
+        return report;
+    }
+
+    void reset_counters() {
+        auto& reg = global_registry();
+        auto lock = std::lock_guard(reg.mutex);
+
+        for (auto const& buffer : reg.buffers) {
+            buffer->phases = {};
+        }
+
+        reg.retired.phases = {};
+    }
+
+    auto format_counter_report(counter_report const& report) -> std::string {
+        auto out = fmt::memory_buffer();
+        auto const& available = report.available;
+
+        if (std::none_of(available.begin(), available.end(), [] (bool b) { return b; })) {
+            return "Hardware counters unavailable (perf_event_open failed, see "
+                "/proc/sys/kernel/perf_event_paranoid).\n";
+        }
+
+        fmt::format_to(std::back_inserter(out), "{:<10} {:>10}", "phase", "calls");
+        for (std::size_t i = 0; i < perf::counter_count; ++i) {
+            fmt::format_to(std::back_inserter(out), " {:>14}",
+                    perf::counter_to_string(static_cast<perf::counter>(i)));
+        }
+        fmt::format_to(std::back_inserter(out), " {:>6}\n", "IPC");
+
+        for (std::size_t p = 0; p < phase_count; ++p) {
+            auto const& phase_total = report.phases[p];
+
+            if (phase_total.calls == 0) {
+                continue;
+            }
+
+            fmt::format_to(std::back_inserter(out), "{:<10} {:>10}",
+                    phase_to_string(static_cast<phase>(p)), phase_total.calls);
+
+            for (std::size_t i = 0; i < perf::counter_count; ++i) {
+                if (available[i]) {
+                    fmt::format_to(std::back_inserter(out), " {:>14.1f}",
+                            static_cast<double>(phase_total.totals.values[i])
+                            / static_cast<double>(phase_total.calls));
+                } else {
+                    fmt::format_to(std::back_inserter(out), " {:>14}", "n/a");
+                }
+            }
+
+            auto const cycles = phase_total.totals[perf::counter::cycles];
+            if (available[0] && available[1] && cycles != 0) {
+                fmt::format_to(std::back_inserter(out), " {:>6.2f}\n",
+                        static_cast<double>(phase_total.totals[perf::counter::instructions])
+                        / static_cast<double>(cycles));
+            } else {
+                fmt::format_to(std::back_inserter(out), " {:>6}\n", "n/a");
+            }
+        }
+
+        return fmt::to_string(out);
+    }
+
+    auto write_chrome_json(std::filesystem::path const& path)
+        -> tl::expected<void, io_error> {
+
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+                std::fopen(path.c_str(), "w"), &std::fclose);
+
+        if (file == nullptr) {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not open {} for writing.", path.string())));
+        }
+
+        auto write_error = [&path] {
+            return tl::unexpected(io_error(io_error::err_code::WRITE_ERROR,
+                        fmt::format("Could not write to {}.", path.string())));
+        };
+
+        auto& reg = global_registry();
+        auto lock = std::lock_guard(reg.mutex);
+        auto out = fmt::memory_buffer();
+        auto first = true;
+
+        // Every batch starts threads of its own, so workers share one track
+        // per index across batches. Other threads get tracks after those.
+        auto tracks = unsigned{0};
+        for (auto const& buffer : reg.buffers) {
+            if (buffer->worker.has_value()) {
+                tracks = std::max(tracks, *buffer->worker + 1);
+            }
+        }
+
+        auto named = std::vector<bool>(tracks);
+
+        fmt::format_to(std::back_inserter(out), "{{\"traceEvents\":[\n");
+
+        for (auto const& buffer : reg.buffers) {
+            if (buffer->events.empty()) {
+                continue;
+            }
+
+            auto const tid = buffer->worker.value_or(tracks);
+
+            if (!buffer->worker.has_value()) {
+                ++tracks;
+            }
+
+            if (tid >= named.size() || !named[tid]) {
+                fmt::format_to(std::back_inserter(out),
+                        "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+                        "\"args\":{{\"name\":\"{} {}\"}}}}",
+                        first ? "" : ",\n", tid,
+                        buffer->worker.has_value() ? "worker" : "thread", tid);
+                first = false;
+
+                if (tid < named.size()) {
+                    named[tid] = true;
+                }
+            }
+
+            for (auto const& e : buffer->events) {
+                // Timestamps are in microseconds.
+                fmt::format_to(std::back_inserter(out),
+                        "{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                        "\"ts\":{:.3f},\"dur\":{:.3f}",
+                        first ? "" : ",\n", phase_to_string(e.p), tid, e.start / 1000.0,
+                        (e.end - e.start) / 1000.0);
+                first = false;
+
+                if (e.item != no_item) {
+                    fmt::format_to(std::back_inserter(out),
+                            ",\"args\":{{\"puzzle\":{}}}", e.item);
+                }
+
+                fmt::format_to(std::back_inserter(out), "}}");
+
+                if (out.size() > (1u << 20)) {
+                    if (std::fwrite(out.data(), 1, out.size(), file.get()) != out.size()) {
+                        return write_error();
+                    }
+
+                    out.clear();
+                }
+            }
+        }
+
+        fmt::format_to(std::back_inserter(out), "\n],\"displayTimeUnit\":\"ns\"}}\n");
+
+        // Whatever is still buffered only reaches the disk on fclose.
+        if (std::fwrite(out.data(), 1, out.size(), file.get()) != out.size()
+                || std::fclose(file.release()) != 0) {
+            return write_error();
+        }
+
+        return {};
+    }
+
+    void clear() {
+        auto& reg = global_registry();
+        auto lock = std::lock_guard(reg.mutex);
+
+        for (auto const& buffer : reg.buffers) {
+            buffer->events.clear();
+        }
+    }
+} /* namespace solve::trace */
@@ -0,0 +1,140 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "input.hpp"
+#include "perf_counters.hpp"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace solve::trace {
+    enum class phase : std::uint8_t {
+        parse,
+        solve,
+        propagate,
+        encode,
+        search,
+        decode,
+        output
+    };
+
+    constexpr inline auto phase_count = std::size_t{7};
+
+    [[nodiscard]] auto phase_to_string(phase p) noexcept -> std::string_view;
+
+    namespace detail {
+        extern std::atomic<bool> enabled;
+        extern std::atomic<bool> counting;
+
+        [[nodiscard]] auto now() noexcept -> std::int64_t;
+        void record(phase p, std::int64_t start, std::int64_t end, std::uint64_t item);
+
+        [[nodiscard]] auto read_counters() noexcept -> perf::sample;
+        void accumulate(phase p, perf::sample const& start) noexcept;
+    } /* namespace detail */
+
+    constexpr inline auto no_item = std::numeric_limits<std::uint64_t>::max();
+
+    // Starts recording phases from here on. Until this or enable_counters()
+    // is called, every scope costs two relaxed loads.
+    void enable() noexcept;
+    // Stops recording again. What was recorded so far is kept.
+    void disable() noexcept;
+
+    [[nodiscard]] inline auto enabled() noexcept -> bool {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+    // Files the current thread's events under the given batch worker index,
+    // so that the workers of consecutive batches show up as one track each
+    // instead of a new set of threads per batch.
+    void set_worker(unsigned worker);
+
+    // Starts attributing hardware counters to phases from here on. Every
+    // scope then costs two extra system calls, one on either end, so keep an
+    // eye on how much that inflates the shorter phases.
+    void enable_counters() noexcept;
+
+    [[nodiscard]] inline auto counting() noexcept -> bool {
+        return detail::counting.load(std::memory_order_relaxed);
+    }
+
+    struct phase_counters {
+        std::uint64_t calls = 0;
+        perf::sample totals;
+    };
+
+    struct counter_report {
+        // A counter only counts as available if every thread that recorded
+        // anything managed to open it.
+        std::array<bool, perf::counter_count> available = {};
+        std::array<phase_counters, phase_count> phases = {};
+    };
+
+    // Sums the counters of all threads so far. Must not run concurrently
+    // with any thread that's still recording.
+    [[nodiscard]] auto collect_counters() -> counter_report;
+
+    // Zeroes the counter totals of all threads, same restriction as above.
+    void reset_counters();
+
+    // Averages per occurrence of each phase, as a table for humans.
+    [[nodiscard]] auto format_counter_report(counter_report const& report) -> std::string;
+
+    // Records the time between its construction and destruction as one
+    // occurrence of a phase on the current thread, optionally tagged with the
+    // puzzle it belongs to.
+    class scope {
+        private:
+        std::int64_t m_start = -1;
+        std::uint64_t m_item;
+        phase m_phase;
+        bool m_counting = false;
+        perf::sample m_counters;
+
+        public:
+        explicit scope(phase p, std::uint64_t item = no_item) noexcept
+            : m_item{item}, m_phase{p} {
+
+            if (enabled()) {
+                m_start = detail::now();
+            }
+
+            if (counting()) {
+                m_counting = true;
+                m_counters = detail::read_counters();
+            }
+        }
+
+        scope(scope const&) = delete;
+        auto operator=(scope const&) -> scope& = delete;
+
+        ~scope() {
+            if (m_counting) {
+                detail::accumulate(m_phase, m_counters);
+            }
+
+            if (m_start >= 0) {
+                detail::record(m_phase, m_start, detail::now(), m_item);
+            }
+        }
+    };
+
+    // Writes everything recorded so far as Chrome trace event JSON, which
+    // chrome://tracing and Perfetto can open. Must not run concurrently
+    // with any thread that's still recording.
+    [[nodiscard]] auto write_chrome_json(std::filesystem::path const& path)
+        -> tl::expected<void, io_error>;
+
+    // Drops every event recorded so far, same restriction as above.
+    void clear();
+} /* namespace solve::trace */
+
+#endif // TRACE_HPP
@@ -1,7 +1,14 @@
 #ifndef UTILITY_HPP
 #define UTILITY_HPP
 
+#include <cassert>
+#include <charconv>
+#include <cstddef>
 #include <cstdlib>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 #include <variant>
 #include <utility>
 
@@ -13,6 +20,45 @@
 
 
 namespace solve::util {
+    [[nodiscard]] inline auto count_trailing_zeros(unsigned value) noexcept -> int {
+        assert(value != 0 && "Trailing zeros of zero are undefined.");
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(value);
+#else
+        auto count = 0;
+        for (; (value & 1u) == 0; value >>= 1) {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    [[nodiscard]] inline auto popcount(unsigned value) noexcept -> int {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcount(value);
+#else
+        auto count = 0;
+        for (; value != 0; value &= value - 1) {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    // Parses all of `text` as a decimal number, for command line arguments.
+    // Anything else, including numbers that don't fit into T, gives nothing.
+    template <typename T>
+    [[nodiscard]] auto parse_number(std::string_view text) noexcept -> std::optional<T> {
+        auto result = T{};
+        auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return std::nullopt;
+        }
+
+        return result;
+    }
+
     template <typename... Fns>
     struct overload_set : public Fns... {
        using Fns::operator()...;
@@ -32,5 +78,76 @@ namespace solve::util {
                 return false;
             }, std::forward<Variant0>(a), std::forward<Variant1>(b));
     }
+
+    // Poor man's std::span until we can move to C++20. Only supports a
+    // dynamic extent, which is all we need for handing batches of puzzles
+    // around.
+    template <typename T>
+    class span {
+        public:
+        using element_type = T;
+        using value_type = std::remove_cv_t<T>;
+        using size_type = std::size_t;
+        using pointer = T*;
+        using reference = T&;
+        using iterator = T*;
+
+        private:
+        pointer m_data = nullptr;
+        size_type m_size = 0;
+
+        public:
+        constexpr span() noexcept = default;
+        constexpr span(pointer data, size_type size) noexcept
+            : m_data{data}, m_size{size} {}
+
+        template <typename Container, typename = std::enable_if_t<
+            std::is_convertible_v<decltype(std::declval<Container&>().data()), pointer>>>
+        constexpr span(Container& c) noexcept
+            : m_data{c.data()}, m_size{c.size()} {}
+
+        template <typename U, typename = std::enable_if_t<
+            std::is_convertible_v<U(*)[], T(*)[]>>>
+        constexpr span(span<U> other) noexcept
+            : m_data{other.data()}, m_size{other.size()} {}
+
+        [[nodiscard]] constexpr auto data() const noexcept -> pointer {
+            return m_data;
+        }
+
+        [[nodiscard]] constexpr auto size() const noexcept -> size_type {
+            return m_size;
+        }
+
+        [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] constexpr auto begin() const noexcept -> iterator {
+            return m_data;
+        }
+
+        [[nodiscard]] constexpr auto end() const noexcept -> iterator {
+            return m_data + m_size;
+        }
+
+        [[nodiscard]] constexpr auto operator[](size_type index) const noexcept
+            -> reference {
+
+            assert(index < m_size && "Span index out of range.");
+            return m_data[index];
+        }
+
+        [[nodiscard]] constexpr auto subspan(size_type offset, size_type count) const
+            noexcept -> span {
+
+            assert(offset + count <= m_size && "Subspan out of range.");
+            return span(m_data + offset, count);
+        }
+    };
+
+    template <typename Container>
+    span(Container&) -> span<std::remove_pointer_t<
+        decltype(std::declval<Container&>().data())>>;
 } /* namespace solve */
 #endif // UTILITY_HPP
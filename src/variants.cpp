@@ -0,0 +1,72 @@
+#include "variants.hpp"
+
+#include <cstdint>
+
+using std::literals::string_view_literals::operator""sv;
+
+namespace {
+    template <typename Rules>
+    [[nodiscard]] auto verify_rules(solve::sudoku const& s) noexcept -> bool {
+        for (auto const& unit : Rules::units) {
+            auto seen = std::uint16_t{0};
+
+            for (auto cell : unit) {
+                auto const value = s.data[cell];
+                if (value < 1 || value > 9) {
+                    return false;
+                }
+
+                seen |= static_cast<std::uint16_t>(1u << (value - 1));
+            }
+
+            if (seen != 0x1ff) {
+                return false;
+            }
+        }
+
+        if constexpr (Rules::anti_knight) {
+            for (auto const& [a, b] : solve::knight_edges) {
+                if (s.data[a] == s.data[b]) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+} /* namespace */
+
+namespace solve {
+    auto variant_name(puzzle_variant variant) noexcept -> std::string_view {
+        switch (variant) {
+            case puzzle_variant::classic:
+                return "classic"sv;
+            case puzzle_variant::x:
+                return "x"sv;
+            case puzzle_variant::windoku:
+                return "windoku"sv;
+            case puzzle_variant::anti_knight:
+                return "anti-knight"sv;
+        }
+
+        return "unknown"sv;
+    }
+
+    auto parse_variant(std::string_view name) noexcept -> std::optional<puzzle_variant> {
+        for (auto variant : {puzzle_variant::classic, puzzle_variant::x,
+                puzzle_variant::windoku, puzzle_variant::anti_knight}) {
+
+            if (variant_name(variant) == name) {
+                return variant;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    auto verify_variant_rules(sudoku const& s, puzzle_variant variant) noexcept -> bool {
+        return visit_rules(variant, [&s] (auto rules) {
+            return verify_rules<decltype(rules)>(s);
+        });
+    }
+} /* namespace solve */
@@ -0,0 +1,125 @@
+#ifndef VARIANTS_HPP
+#define VARIANTS_HPP
+
+#include "data.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace solve {
+    enum class puzzle_variant : std::uint8_t {
+        classic,
+        // Both main diagonals hold every digit once.
+        x,
+        // So do the four 3x3 windows between the blocks.
+        windoku,
+        // No two cells a knight's move apart hold the same digit.
+        anti_knight
+    };
+
+    [[nodiscard]] auto variant_name(puzzle_variant variant) noexcept -> std::string_view;
+    [[nodiscard]] auto parse_variant(std::string_view name) noexcept
+        -> std::optional<puzzle_variant>;
+
+    using extra_unit = std::array<std::uint8_t, 9>;
+
+    // Rule sets are plain data: units that have to hold every digit exactly
+    // once on top of rows, columns and blocks, and whether cells a knight's
+    // move apart have to differ. Everything else, like the shape of the
+    // matrix, is derived from these at compile time by rule_traits.
+    struct classic_rules {
+        constexpr static inline auto units = std::array<extra_unit, 0>{};
+        constexpr static inline auto anti_knight = false;
+    };
+
+    struct x_rules {
+        constexpr static inline auto units = std::array<extra_unit, 2>{{
+            {0, 10, 20, 30, 40, 50, 60, 70, 80},
+            {8, 16, 24, 32, 40, 48, 56, 64, 72}
+        }};
+        constexpr static inline auto anti_knight = false;
+    };
+
+    struct windoku_rules {
+        constexpr static inline auto units = std::array<extra_unit, 4>{{
+            {10, 11, 12, 19, 20, 21, 28, 29, 30},
+            {14, 15, 16, 23, 24, 25, 32, 33, 34},
+            {46, 47, 48, 55, 56, 57, 64, 65, 66},
+            {50, 51, 52, 59, 60, 61, 68, 69, 70}
+        }};
+        constexpr static inline auto anti_knight = false;
+    };
+
+    struct anti_knight_rules {
+        constexpr static inline auto units = std::array<extra_unit, 0>{};
+        constexpr static inline auto anti_knight = true;
+    };
+
+    using knight_edge = std::array<std::uint8_t, 2>;
+
+    // Every pair of cells a knight's move apart, each listed once.
+    constexpr inline auto knight_edges = [] {
+        auto result = std::array<knight_edge, 4 * 8 * 7>{};
+        auto const moves = std::array<std::array<int, 2>, 4>{{{1, 2}, {2, 1}, {-1, 2}, {-2, 1}}};
+        auto count = std::size_t{0};
+
+        for (int y = 0; y < 9; ++y) {
+            for (int x = 0; x < 9; ++x) {
+                for (auto const& [dx, dy] : moves) {
+                    if (x + dx >= 0 && x + dx < 9 && y + dy < 9) {
+                        result[count++] = {static_cast<std::uint8_t>(x + 9 * y),
+                            static_cast<std::uint8_t>(x + dx + 9 * (y + dy))};
+                    }
+                }
+            }
+        }
+
+        return result;
+    }();
+
+    // The parts of the exact cover matrix a rule set adds to the classic one.
+    // Every extra unit gets one primary column per digit. Every knight edge
+    // gets one secondary column per digit, since two cells a knight's move
+    // apart may just as well both hold other digits.
+    template <typename Rules>
+    struct rule_traits {
+        constexpr static inline auto unit_count = static_cast<int>(Rules::units.size());
+        constexpr static inline auto edge_count = Rules::anti_knight
+            ? static_cast<int>(knight_edges.size()) : 0;
+
+        constexpr static inline auto primary_columns = 9 * unit_count;
+        constexpr static inline auto secondary_columns = 9 * edge_count;
+        // Over all rows. Each unit cell and each end of an edge shows up in
+        // nine rows, one per digit.
+        constexpr static inline auto nodes = 9 * (9 * unit_count + 2 * edge_count);
+        // Nothing lies on more than two units or eight edges.
+        constexpr static inline auto max_row_columns = (unit_count > 0 ? 2 : 0)
+            + (Rules::anti_knight ? 8 : 0);
+    };
+
+    // Checks the rules on top of the classic ones. Doesn't look at rows,
+    // columns or blocks at all.
+    [[nodiscard]] auto verify_variant_rules(sudoku const& s, puzzle_variant variant) noexcept
+        -> bool;
+
+    // Calls `f` with a default constructed rule set matching `variant`.
+    template <typename Fun>
+    decltype(auto) visit_rules(puzzle_variant variant, Fun&& f) {
+        switch (variant) {
+            case puzzle_variant::x:
+                return f(x_rules{});
+            case puzzle_variant::windoku:
+                return f(windoku_rules{});
+            case puzzle_variant::anti_knight:
+                return f(anti_knight_rules{});
+            case puzzle_variant::classic:
+                break;
+        }
+
+        return f(classic_rules{});
+    }
+} /* namespace solve */
+
+#endif // VARIANTS_HPP
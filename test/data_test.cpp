@@ -53,3 +53,19 @@ TEST_CASE("Iterator tests") {
             }));
     }
 }
+
+TEST_CASE("Bitboard tests") {
+    auto grid = sudoku{};
+    grid.data[0] = 1;
+    grid.data[10] = 9;
+    grid.data[80] = 5;
+
+    auto board = bitboard(grid);
+
+    REQUIRE(board.cells[bitboard::index(0, 0)] == 0b1);
+    REQUIRE(board.cells[bitboard::index(1, 1)] == 0b1'0000'0000);
+    REQUIRE(board.cells[bitboard::index(8, 8)] == 0b1'0000);
+    REQUIRE(std::count(board.cells.begin(), board.cells.end(), 0)
+            == static_cast<std::ptrdiff_t>(board.cells.size() - 3));
+    REQUIRE(board.to_sudoku().data == grid.data);
+}
@@ -0,0 +1,692 @@
+#include "file_io.hpp"
+#include "line_index.hpp"
+#include "pipeline.hpp"
+#include "solution_store.hpp"
+#include "solver.hpp"
+#include "trace.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace solve;
+
+static constexpr auto puzzle =
+    "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..";
+static constexpr auto solution =
+    "483921657967345821251876493548132976729564138136798245372689514814253769695417382";
+
+static auto temp_file(char const* name) -> std::filesystem::path {
+    return std::filesystem::temp_directory_path() / name;
+}
+
+static auto slurp(std::filesystem::path const& path) -> std::string {
+    auto file = std::ifstream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Skips one JSON value at the start of `text`, or returns false if there
+// isn't a well formed one.
+static auto skip_json(std::string_view& text) -> bool {
+    auto skip_space = [&text] {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())) != 0) {
+            text.remove_prefix(1);
+        }
+    };
+
+    auto skip_string = [&text] {
+        if (text.empty() || text.front() != '"') {
+            return false;
+        }
+
+        for (std::size_t i = 1; i < text.size(); ++i) {
+            if (text[i] == '\\') {
+                ++i;
+            } else if (text[i] == '"') {
+                text.remove_prefix(i + 1);
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    skip_space();
+    if (text.empty()) {
+        return false;
+    }
+
+    auto const open = text.front();
+
+    if (open == '"') {
+        return skip_string();
+    } else if (open == '{' || open == '[') {
+        auto const close = open == '{' ? '}' : ']';
+        text.remove_prefix(1);
+        skip_space();
+
+        if (!text.empty() && text.front() == close) {
+            text.remove_prefix(1);
+            return true;
+        }
+
+        while (true) {
+            if (open == '{') {
+                skip_space();
+                if (!skip_string()) {
+                    return false;
+                }
+
+                skip_space();
+                if (text.empty() || text.front() != ':') {
+                    return false;
+                }
+                text.remove_prefix(1);
+            }
+
+            if (!skip_json(text)) {
+                return false;
+            }
+
+            skip_space();
+            if (text.empty()) {
+                return false;
+            } else if (text.front() == close) {
+                text.remove_prefix(1);
+                return true;
+            } else if (text.front() != ',') {
+                return false;
+            }
+
+            text.remove_prefix(1);
+        }
+    }
+
+    for (auto literal : {"true", "false", "null"}) {
+        if (text.substr(0, std::string_view(literal).size()) == literal) {
+            text.remove_prefix(std::string_view(literal).size());
+            return true;
+        }
+    }
+
+    auto const number = std::string(text.substr(0, 32));
+    char* end = nullptr;
+    (void)std::strtod(number.c_str(), &end);
+
+    if (end == number.c_str()) {
+        return false;
+    }
+
+    text.remove_prefix(static_cast<std::size_t>(end - number.c_str()));
+    return true;
+}
+
+// The number after `"key":` in `text`, or -1 if there is none.
+static auto json_number(std::string_view text, std::string_view key) -> long {
+    auto const needle = "\"" + std::string(key) + "\":";
+    auto const found = text.find(needle);
+
+    if (found == std::string_view::npos) {
+        return -1;
+    }
+
+    return std::strtol(std::string(text.substr(found + needle.size(), 24)).c_str(), nullptr, 10);
+}
+
+TEST_CASE("File I/O tests") {
+    auto const backend = GENERATE(io_backend::automatic, io_backend::posix);
+    auto options = stream_options();
+    options.backend = backend;
+    options.buffer_size = 4096;
+    options.queue_depth = 3;
+
+    auto const path = temp_file("ssolve_file_io_test.txt");
+
+    SECTION("What is written is read back in order") {
+        auto expected = std::string();
+        for (int i = 0; expected.size() < 5 * options.buffer_size + 123; ++i) {
+            expected += std::to_string(i) + '\n';
+        }
+
+        {
+            auto writer = file_writer::open(path, options);
+            REQUIRE(writer.has_value());
+
+            for (std::size_t i = 0; i < expected.size(); i += 1000) {
+                REQUIRE(writer->write(std::string_view(expected).substr(i, 1000)).has_value());
+            }
+
+            REQUIRE(writer->flush().has_value());
+        }
+
+        REQUIRE(slurp(path) == expected);
+
+        auto reader = file_reader::open(path, options);
+        REQUIRE(reader.has_value());
+
+        auto read = std::string();
+        for (auto piece = reader->next(); piece.has_value() && !piece->empty();
+                piece = reader->next()) {
+
+            read.append(*piece);
+        }
+
+        REQUIRE(read == expected);
+    }
+
+    SECTION("Writes after a flush go after what was flushed") {
+        {
+            auto writer = file_writer::open(path, options);
+            REQUIRE(writer.has_value());
+
+            REQUIRE(writer->write("first\n").has_value());
+            REQUIRE(writer->flush().has_value());
+            REQUIRE(writer->write("second\n").has_value());
+            REQUIRE(writer->flush().has_value());
+        }
+
+        REQUIRE(slurp(path) == "first\nsecond\n");
+    }
+
+    SECTION("Streams of puzzles are solved in order") {
+        // 82 bytes per line don't divide the buffer size, so lines straddle
+        // buffers. The last line has no line break.
+        auto input = std::string();
+        auto expected = std::string();
+        for (int i = 0; i < 200; ++i) {
+            input += puzzle;
+            input += i + 1 < 200 ? "\n" : "";
+            expected += solution;
+            expected += '\n';
+        }
+
+        std::ofstream(path, std::ios::binary) << input;
+
+        auto const output_path = temp_file("ssolve_file_io_test.out");
+        auto reader = file_reader::open(path, options);
+        auto writer = file_writer::open(output_path, options);
+        REQUIRE(reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto pipeline = pipeline_options();
+        pipeline.chunk_size = 7;
+        pipeline.batch.thread_count = 2;
+
+        auto const result = solve_stream(*reader, *writer, pipeline);
+        REQUIRE(result.has_value());
+        REQUIRE(writer->flush().has_value());
+        REQUIRE(result->puzzles == 200);
+        REQUIRE(result->solved == 200);
+        REQUIRE(slurp(output_path) == expected);
+
+        std::filesystem::remove(output_path);
+    }
+
+    SECTION("Runs continue from checkpoints") {
+        auto input = std::string();
+        auto expected = std::string();
+        for (int i = 0; i < 200; ++i) {
+            input += puzzle;
+            input += '\n';
+            expected += solution;
+            expected += '\n';
+        }
+
+        std::ofstream(path, std::ios::binary) << input;
+
+        // A run that got through 50 lines and had written some more output
+        // before it died.
+        auto const output_path = temp_file("ssolve_file_io_test.out");
+        auto const checkpoint_path = temp_file("ssolve_file_io_test.checkpoint");
+        auto const saved = checkpoint{50 * 82, 50, 50 * 82, input.size()};
+
+        std::ofstream(output_path, std::ios::binary) << expected.substr(0, 60 * 82) << "123";
+        REQUIRE(write_checkpoint(checkpoint_path, saved).has_value());
+
+        auto const loaded = read_checkpoint(checkpoint_path);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->input_offset == saved.input_offset);
+        REQUIRE(loaded->line == saved.line);
+        REQUIRE(loaded->output_size == saved.output_size);
+        REQUIRE(loaded->input_size == saved.input_size);
+
+        auto reader = file_reader::open(path, options, byte_range{loaded->input_offset});
+        auto writer = file_writer::resume(output_path, loaded->output_size, options);
+        REQUIRE(reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto pipeline = pipeline_options();
+        pipeline.chunk_size = 16;
+        pipeline.start = *loaded;
+        pipeline.checkpoint_path = checkpoint_path;
+        pipeline.checkpoint_interval = std::chrono::seconds(0);
+
+        auto const result = solve_stream(*reader, *writer, pipeline);
+        REQUIRE(result.has_value());
+        REQUIRE(result->puzzles == 150);
+        REQUIRE(slurp(output_path) == expected);
+
+        auto const done = read_checkpoint(checkpoint_path);
+        REQUIRE(done.has_value());
+        REQUIRE(done->input_offset == input.size());
+        REQUIRE(done->line == 200);
+        REQUIRE(done->output_size == expected.size());
+
+        std::filesystem::remove(output_path);
+        std::filesystem::remove(checkpoint_path);
+    }
+
+    SECTION("Format errors name the line") {
+        std::ofstream(path, std::ios::binary) << puzzle << '\n' << puzzle << '\n'
+            << "123\n" << puzzle << '\n';
+
+        auto reader = file_reader::open(path, options);
+        auto writer = file_writer::open(temp_file("ssolve_file_io_test.out"), options);
+        REQUIRE(reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto const result = solve_stream(*reader, *writer);
+        REQUIRE_FALSE(result.has_value());
+        REQUIRE(result.error().code() == io_error::err_code::FORMAT_ERROR);
+        REQUIRE(result.error().details().value().rfind("Line 3:", 0) == 0);
+
+        std::filesystem::remove(temp_file("ssolve_file_io_test.out"));
+    }
+
+    SECTION("Solution files are checked line by line") {
+        // A wrong digit in a filled cell, a changed given, a malformed line,
+        // and two puzzles without a solution at the end.
+        auto broken = std::string(solution);
+        broken[80] = broken[80] == '1' ? '2' : '1';
+        auto changed = std::string(solution);
+        std::swap(changed[2], changed[3]);
+
+        auto puzzles = std::string();
+        auto solutions = std::string();
+        for (int i = 0; i < 100; ++i) {
+            puzzles += puzzle;
+            puzzles += '\n';
+
+            if (i < 98) {
+                solutions += i == 10 ? broken : i == 20 ? changed
+                    : i == 30 ? std::string("123") : std::string(solution);
+                solutions += '\n';
+            }
+        }
+
+        auto const solutions_path = temp_file("ssolve_file_io_test.solutions");
+        auto const report_path = temp_file("ssolve_file_io_test.out");
+        std::ofstream(path, std::ios::binary) << puzzles;
+        std::ofstream(solutions_path, std::ios::binary) << solutions;
+
+        auto puzzle_reader = file_reader::open(path, options);
+        auto solution_reader = file_reader::open(solutions_path, options);
+        auto writer = file_writer::open(report_path, options);
+        REQUIRE(puzzle_reader.has_value());
+        REQUIRE(solution_reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto pipeline = pipeline_options();
+        pipeline.chunk_size = 7;
+        pipeline.batch.thread_count = 2;
+
+        auto const result = verify_stream(*puzzle_reader, *solution_reader, *writer, pipeline);
+        REQUIRE(result.has_value());
+        REQUIRE(writer->flush().has_value());
+        REQUIRE(result->lines == 100);
+        REQUIRE(result->mismatches == 5);
+        REQUIRE(slurp(report_path) == "11: solution breaks the rules\n"
+                "21: solution changes the givens\n"
+                "31: malformed solution\n"
+                "99-100: no solution\n");
+
+        std::filesystem::remove(solutions_path);
+        std::filesystem::remove(report_path);
+    }
+
+    SECTION("Shards split the file at line starts") {
+        auto expected = std::string();
+        for (int i = 0; i < 1000; ++i) {
+            expected += std::string(static_cast<std::size_t>(i % 97), 'x') + '\n';
+        }
+
+        std::ofstream(path, std::ios::binary) << expected;
+
+        for (unsigned count : {1u, 2u, 3u, 64u, 5000u}) {
+            auto joined = std::string();
+            auto previous_end = std::uint64_t{0};
+
+            for (unsigned k = 0; k < count; ++k) {
+                auto const range = shard_range(path, k, count);
+                REQUIRE(range.has_value());
+                REQUIRE(range->begin == previous_end);
+                REQUIRE((range->begin == 0 || expected[range->begin - 1] == '\n'));
+                previous_end = range->end;
+
+                auto reader = file_reader::open(path, options, *range);
+                REQUIRE(reader.has_value());
+
+                for (auto piece = reader->next(); piece.has_value() && !piece->empty();
+                        piece = reader->next()) {
+
+                    joined.append(*piece);
+                }
+            }
+
+            REQUIRE(previous_end == expected.size());
+            REQUIRE(joined == expected);
+        }
+    }
+
+    SECTION("Line indices find lines and balance shards") {
+        // Every line is a puzzle with its number in the first fields, the
+        // last one has no line break.
+        auto input = std::string();
+        for (int i = 0; i < 1000; ++i) {
+            auto line = std::string(puzzle);
+            line[0] = static_cast<char>('1' + i % 9);
+            line[1] = static_cast<char>('1' + i / 9 % 9);
+            input += line;
+            input += i + 1 < 1000 ? "\n" : "";
+        }
+
+        std::ofstream(path, std::ios::binary) << input;
+
+        auto const threads = GENERATE(1u, 3u);
+        auto const built = line_index::build(path, 64, threads);
+        REQUIRE(built.has_value());
+        REQUIRE(built->line_count() == 1000);
+        REQUIRE(built->file_size() == input.size());
+
+        auto const index_path = line_index::default_path(path);
+        REQUIRE(built->save(index_path).has_value());
+        auto const index = line_index::load(index_path);
+        REQUIRE(index.has_value());
+        REQUIRE(index->stride() == 64);
+        REQUIRE(index->line_count() == 1000);
+        REQUIRE(index->matches(path));
+
+        for (std::uint64_t line : {0, 1, 63, 64, 65, 500, 999}) {
+            auto const read = read_puzzle(path, *index, line);
+            REQUIRE(read.has_value());
+            REQUIRE(read->data[0] == 1 + static_cast<int>(line % 9));
+            REQUIRE(read->data[1] == 1 + static_cast<int>(line / 9 % 9));
+        }
+
+        auto const range = read_puzzles(path, *index, 990, 50);
+        REQUIRE(range.has_value());
+        REQUIRE(range->size() == 10);
+        REQUIRE_FALSE(read_puzzle(path, *index, 1000).has_value());
+
+        auto joined = std::string();
+        for (unsigned k = 0; k < 6; ++k) {
+            auto const shard = index->shard(k, 6);
+            auto const lines = index->shard_first_line(k + 1, 6) - index->shard_first_line(k, 6);
+            REQUIRE((lines >= 1000 / 6 - 64 && lines <= 1000 / 6 + 64));
+            joined += input.substr(shard.begin, shard.end - shard.begin);
+        }
+
+        REQUIRE(joined == input);
+
+        // A header claiming far more lines than the file holds.
+        {
+            auto file = std::fstream(index_path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(16);
+            file.write("\xff\xff\xff\xff\xff\xff\x00\x00", 8);
+        }
+
+        auto const corrupt = line_index::load(index_path);
+        REQUIRE_FALSE(corrupt.has_value());
+        REQUIRE(corrupt.error().code() == io_error::err_code::FORMAT_ERROR);
+        std::filesystem::remove(index_path);
+    }
+
+    SECTION("Solution stores remember solutions across runs") {
+        auto const store_path = temp_file("ssolve_file_io_test.store");
+        auto lock_path = store_path;
+        lock_path += ".lock";
+        std::filesystem::remove(store_path);
+
+        // Distinct puzzles with the same solution, enough of them to make
+        // the table grow a couple of times.
+        auto const solved = [] {
+            auto result = sudoku();
+            for (std::size_t i = 0; i < sudoku::field_size; ++i) {
+                result.data[i] = static_cast<std::int8_t>(solution[i] - '0');
+            }
+            return result;
+        }();
+
+        auto variant = [&solved] (unsigned k) {
+            auto result = solved;
+            for (unsigned bit = 0; bit < 20; ++bit) {
+                if ((k >> bit & 1) != 0) {
+                    result.data[bit * 4] = sudoku::empty_field;
+                }
+            }
+            return result;
+        };
+
+        constexpr auto count = 50000u;
+
+        {
+            auto writer = solution_store::open(store_path);
+            REQUIRE(writer.has_value());
+            REQUIRE(writer->writable());
+
+            // A second process, or anyone else, only gets to read.
+            auto reader = solution_store::open(store_path);
+            REQUIRE(reader.has_value());
+            REQUIRE_FALSE(reader->writable());
+            REQUIRE_FALSE(reader->find(variant(1)).has_value());
+
+            for (unsigned k = 0; k < count; ++k) {
+                REQUIRE(writer->insert(variant(k), solved).has_value());
+            }
+
+            REQUIRE(writer->insert(variant(7), solved).has_value());
+            REQUIRE(writer->size() == count);
+            REQUIRE(writer->find(variant(12345)).value().data == solved.data);
+
+            // The reader only sees the grown table once it refreshes.
+            REQUIRE(reader->size() < count);
+            REQUIRE(reader->refresh().has_value());
+            REQUIRE(reader->size() == count);
+            REQUIRE(reader->find(variant(count - 1)).value().data == solved.data);
+            REQUIRE_FALSE(reader->find(variant(count)).has_value());
+        }
+
+        auto reopened = solution_store::open(store_path);
+        REQUIRE(reopened.has_value());
+        REQUIRE(reopened->writable());
+        REQUIRE(reopened->size() == count);
+        REQUIRE(reopened->find(variant(4242)).value().data == solved.data);
+
+        // A valid grid that doesn't keep the puzzle's givens is never handed
+        // out as its solution.
+        auto unrelated = solved;
+        for (std::size_t y = 0; y < 9; ++y) {
+            std::swap(unrelated.data[9 * y], unrelated.data[9 * y + 1]);
+        }
+
+        REQUIRE(verify_sudoku(unrelated));
+
+        auto const parsed = parse_sudoku(puzzle);
+        REQUIRE(parsed.has_value());
+        REQUIRE(reopened->insert(*parsed, unrelated).has_value());
+        REQUIRE_FALSE(reopened->find(*parsed).has_value());
+
+        // Stored solutions are used instead of solving. Without the four
+        // cells of a swappable rectangle, the solution has a twin, and the
+        // store holds whichever of the two the solver doesn't pick.
+        auto ambiguous_text = std::string(solution);
+        for (auto cell : {1, 6, 10, 15}) {
+            ambiguous_text[cell] = '.';
+        }
+
+        auto twin = solved;
+        std::swap(twin.data[1], twin.data[6]);
+        std::swap(twin.data[10], twin.data[15]);
+        REQUIRE(verify_sudoku(twin));
+
+        auto const ambiguous = parse_sudoku(ambiguous_text);
+        REQUIRE(ambiguous.has_value());
+        auto const stored = solver_context().solve(*ambiguous).data == solved.data
+            ? twin : solved;
+        REQUIRE(reopened->insert(*ambiguous, stored).has_value());
+
+        auto stored_text = std::string();
+        for (auto value : stored.data) {
+            stored_text += static_cast<char>('0' + value);
+        }
+
+        std::ofstream(path, std::ios::binary) << ambiguous_text << '\n' << "..3"
+            << std::string(78, '.') << '\n';
+
+        auto const output_path = temp_file("ssolve_file_io_test.out");
+        auto reader = file_reader::open(path, options);
+        auto writer = file_writer::open(output_path, options);
+        REQUIRE(reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto pipeline = pipeline_options();
+        pipeline.store = &*reopened;
+
+        auto const result = solve_stream(*reader, *writer, pipeline);
+        REQUIRE(result.has_value());
+        REQUIRE(result->solved == 2);
+        REQUIRE(writer->flush().has_value());
+        REQUIRE(slurp(output_path).substr(0, 81) == stored_text);
+        REQUIRE(reopened->size() == count + 3);
+
+        std::filesystem::remove(output_path);
+        std::filesystem::remove(store_path);
+        std::filesystem::remove(lock_path);
+    }
+
+    SECTION("Traces tag every phase of a puzzle with the same id") {
+        // The store knows the first puzzle, so only every other line of the
+        // first chunk gets solved at all. The rest come out of the store.
+        auto const store_path = temp_file("ssolve_file_io_test.store");
+        auto lock_path = store_path;
+        lock_path += ".lock";
+        std::filesystem::remove(store_path);
+
+        auto store = solution_store::open(store_path);
+        REQUIRE(store.has_value());
+        REQUIRE(store->insert(parse_sudoku(puzzle).value(),
+                    parse_sudoku(solution).value()).has_value());
+
+        constexpr auto lines = 40u;
+        constexpr auto chunk_size = 7u;
+
+        auto input = std::string();
+        for (unsigned i = 0; i < lines; ++i) {
+            input += i % 2 == 0 ? puzzle : solution;
+            input += '\n';
+        }
+
+        std::ofstream(path, std::ios::binary) << input;
+
+        auto const output_path = temp_file("ssolve_file_io_test.out");
+        auto const trace_path = temp_file("ssolve_file_io_test.json");
+        auto reader = file_reader::open(path, options);
+        auto writer = file_writer::open(output_path, options);
+        REQUIRE(reader.has_value());
+        REQUIRE(writer.has_value());
+
+        auto pipeline = pipeline_options();
+        pipeline.chunk_size = chunk_size;
+        pipeline.batch.thread_count = 2;
+        pipeline.batch.schedule_by_difficulty = false;
+
+        for (auto* used : {static_cast<solution_store*>(nullptr), &*store}) {
+            pipeline.store = used;
+
+            trace::clear();
+            trace::enable();
+            auto const result = solve_stream(*reader, *writer, pipeline);
+            trace::disable();
+
+            REQUIRE(result.has_value());
+            REQUIRE(result->puzzles == lines);
+            REQUIRE(trace::write_chrome_json(trace_path).has_value());
+
+            auto const json = slurp(trace_path);
+            auto rest = std::string_view(json);
+            REQUIRE(skip_json(rest));
+            REQUIRE(rest.find_first_not_of(" \n") == std::string_view::npos);
+
+            // Every event is on a line of its own.
+            auto ids = std::map<std::string, std::set<long>>();
+            auto tracks = std::set<long>();
+
+            for (auto begin = std::size_t{0}; begin < json.size();) {
+                auto const end = json.find('\n', begin);
+                auto const line = std::string_view(json).substr(begin, end - begin);
+                begin = end == std::string::npos ? json.size() : end + 1;
+
+                if (line.find("\"ph\":\"X\"") == std::string_view::npos) {
+                    continue;
+                }
+
+                auto const name_start = line.find("\"name\":\"") + 8;
+                auto const name = line.substr(name_start, line.find('"', name_start) - name_start);
+                auto const id = json_number(line, "puzzle");
+
+                tracks.insert(json_number(line, "tid"));
+                if (id >= 0) {
+                    ids[std::string(name)].insert(id);
+                }
+            }
+
+            auto all = std::set<long>();
+            for (long i = 0; i < lines; ++i) {
+                all.insert(i);
+            }
+
+            REQUIRE(ids["parse"] == all);
+            REQUIRE(ids["output"] == all);
+
+            REQUIRE(result->solved == lines);
+
+            if (used == nullptr) {
+                REQUIRE(ids["solve"] == all);
+            } else {
+                // The first chunk adds the solution to the store, later ones
+                // find both lines there.
+                REQUIRE(ids["solve"] == std::set<long>{1, 3, 5});
+            }
+
+            // One track per worker, however many chunks started them.
+            REQUIRE(tracks == std::set<long>{0, 1});
+
+            reader = file_reader::open(path, options);
+            writer = file_writer::open(output_path, options);
+            REQUIRE(reader.has_value());
+            REQUIRE(writer.has_value());
+        }
+
+        std::filesystem::remove(output_path);
+        std::filesystem::remove(trace_path);
+        std::filesystem::remove(store_path);
+        std::filesystem::remove(lock_path);
+    }
+
+    SECTION("Missing files are reported") {
+        auto reader = file_reader::open(temp_file("ssolve_does_not_exist.txt"), options);
+        REQUIRE_FALSE(reader.has_value());
+        REQUIRE(reader.error().code() == io_error::err_code::NO_SUCH_FILE);
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,47 @@
+#include "histogram.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+
+using namespace solve;
+
+TEST_CASE("Histogram buckets") {
+    auto const values = std::array<std::uint64_t, 9>{0, 1, 63, 64, 65, 1000, 123456789,
+        UINT64_MAX / 3, UINT64_MAX};
+
+    for (auto value : values) {
+
+        auto const index = latency_histogram::bucket_index(value);
+
+        REQUIRE(index < latency_histogram::bucket_count);
+        REQUIRE(latency_histogram::bucket_lower_bound(index) <= value);
+        REQUIRE(value <= latency_histogram::bucket_upper_bound(index));
+    }
+
+    for (unsigned i = 0; i + 1 < latency_histogram::bucket_count; ++i) {
+        REQUIRE(latency_histogram::bucket_upper_bound(i) + 1
+                == latency_histogram::bucket_lower_bound(i + 1));
+    }
+}
+
+TEST_CASE("Histogram percentiles") {
+    auto first = latency_histogram();
+    auto second = latency_histogram();
+
+    for (std::uint64_t value = 1; value <= 1000; ++value) {
+        (value % 2 == 0 ? first : second).record(value * 1000);
+    }
+
+    first.merge(second);
+
+    REQUIRE(first.count() == 1000);
+    REQUIRE(first.min() == 1000);
+    REQUIRE(first.max() == 1000000);
+    REQUIRE(first.mean() == Approx(500500.0));
+    REQUIRE(first.value_at_percentile(100.0) == 1000000);
+    REQUIRE(first.value_at_percentile(50.0) == Approx(500000.0).epsilon(0.035));
+    REQUIRE(first.value_at_percentile(99.0) == Approx(990000.0).epsilon(0.035));
+    REQUIRE(latency_histogram().value_at_percentile(50.0) == 0);
+}
@@ -0,0 +1,577 @@
+#include "batch.hpp"
+#include "data.hpp"
+#include "solver.hpp"
+#include "utility.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::literals::string_view_literals::operator""sv;
+
+static constexpr auto usage =
+    "Usage: perf_regression [options] <baseline.json>\n"
+    "\n"
+    "Generates every corpus listed in <baseline.json> from its seed, solves it\n"
+    "on one thread and compares the result against the baseline. The number of\n"
+    "search nodes has to match exactly, as it only changes with the search\n"
+    "itself. With --throughput check, throughput is divided by that of a fixed\n"
+    "pointer chasing loop and may drop by at most the tolerance. That is only\n"
+    "meaningful against a baseline written on the same host. Exits with 1 if\n"
+    "anything regressed.\n"
+    "\n"
+    "Options:\n"
+    "  --tolerance <x>       Allowed drop in normalized throughput (default 0.25)\n"
+    "  --throughput <check|skip>\n"
+    "                        Whether to compare throughput at all, which only\n"
+    "                        makes sense for optimized builds (default skip)\n"
+    "  --repeat <n>          Repetitions per corpus, the fastest one counts\n"
+    "                        (default 5 when measuring throughput, otherwise 2,\n"
+    "                        which is enough to compare their node counts)\n"
+    "  --write-baseline      Measure and rewrite <baseline.json> instead\n"sv;
+
+struct regression_options {
+    std::string_view baseline;
+    double tolerance = 0.25;
+    bool check_throughput = false;
+    std::optional<unsigned> repeat;
+    bool write_baseline = false;
+};
+
+// One corpus and what it measured when the baseline was written.
+struct corpus {
+    std::string name;
+    std::uint64_t seed = 1;
+    std::uint64_t count = 0;
+    unsigned min_givens = 0;
+    unsigned max_givens = 0;
+    std::string engine;
+    std::uint64_t search_nodes = 0;
+    double normalized_throughput = 0.0;
+};
+
+struct configuration {
+    std::string_view name;
+    solve::backend engine;
+    bool lanes;
+};
+
+// Same names as in sudoku_bench.
+static constexpr configuration configurations[] = {
+    {"dancing_links"sv, solve::backend::dancing_links, false},
+    {"hybrid"sv, solve::backend::hybrid, false},
+    {"hybrid+lanes"sv, solve::backend::hybrid, true},
+};
+
+static auto find_configuration(std::string_view name) -> configuration const* {
+    for (auto const& config : configurations) {
+        if (config.name == name) {
+            return &config;
+        }
+    }
+
+    return nullptr;
+}
+
+static auto parse_arguments(int argc, char const** argv) -> std::optional<regression_options> {
+    auto result = regression_options();
+
+    for (int i = 1; i < argc; ++i) {
+        auto const arg = std::string_view(argv[i]);
+
+        if (arg == "--tolerance"sv && i + 1 < argc) {
+            auto* end = static_cast<char*>(nullptr);
+            result.tolerance = std::strtod(argv[++i], &end);
+
+            if (*end != '\0' || !(result.tolerance >= 0.0 && result.tolerance < 1.0)) {
+                return std::nullopt;
+            }
+        } else if (arg == "--throughput"sv && i + 1 < argc) {
+            auto const value = std::string_view(argv[++i]);
+            if (value != "check"sv && value != "skip"sv) {
+                return std::nullopt;
+            }
+
+            result.check_throughput = value == "check"sv;
+        } else if (arg == "--repeat"sv && i + 1 < argc) {
+            auto const value = solve::util::parse_number<unsigned>(argv[++i]);
+            if (!value.has_value() || *value == 0) {
+                return std::nullopt;
+            }
+
+            result.repeat = *value;
+        } else if (arg == "--write-baseline"sv) {
+            result.write_baseline = true;
+        } else if (arg.empty() || arg[0] == '-' || !result.baseline.empty()) {
+            return std::nullopt;
+        } else {
+            result.baseline = arg;
+        }
+    }
+
+    if (result.baseline.empty()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+// Just enough JSON for the baseline: an object with a "corpora" array of
+// flat objects holding strings and numbers.
+class baseline_reader {
+    private:
+    std::string_view m_text;
+    std::size_t m_position = 0;
+
+    void skip_space() noexcept {
+        while (m_position < m_text.size()
+                && (m_text[m_position] == ' ' || m_text[m_position] == '\n'
+                    || m_text[m_position] == '\r' || m_text[m_position] == '\t')) {
+
+            ++m_position;
+        }
+    }
+
+    [[nodiscard]] auto consume(char c) noexcept -> bool {
+        skip_space();
+        if (m_position < m_text.size() && m_text[m_position] == c) {
+            ++m_position;
+            return true;
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] auto string() noexcept -> std::optional<std::string_view> {
+        if (!consume('"')) {
+            return std::nullopt;
+        }
+
+        auto const end = m_text.find('"', m_position);
+        if (end == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        auto const result = m_text.substr(m_position, end - m_position);
+        m_position = end + 1;
+        return result;
+    }
+
+    [[nodiscard]] auto number() noexcept -> std::optional<std::string_view> {
+        skip_space();
+        auto const start = m_position;
+
+        while (m_position < m_text.size()
+                && std::string_view("0123456789+-.eE").find(m_text[m_position])
+                    != std::string_view::npos) {
+
+            ++m_position;
+        }
+
+        if (start == m_position) {
+            return std::nullopt;
+        }
+
+        return m_text.substr(start, m_position - start);
+    }
+
+    // Reads the members of one corpus, the opening brace already consumed.
+    [[nodiscard]] auto corpus_members(corpus& result) -> bool {
+        if (consume('}')) {
+            return true;
+        }
+
+        do {
+            auto const key = string();
+            if (!key.has_value() || !consume(':')) {
+                return false;
+            }
+
+            if (*key == "name"sv || *key == "backend"sv) {
+                auto const value = string();
+                if (!value.has_value()) {
+                    return false;
+                }
+
+                (*key == "name"sv ? result.name : result.engine) = std::string(*value);
+                continue;
+            }
+
+            auto const value = number();
+            if (!value.has_value()) {
+                return false;
+            }
+
+            auto const text = std::string(*value);
+            auto* end = static_cast<char*>(nullptr);
+
+            if (*key == "normalized_throughput"sv) {
+                result.normalized_throughput = std::strtod(text.c_str(), &end);
+            } else {
+                auto const integer = std::strtoull(text.c_str(), &end, 10);
+
+                if (*key == "seed"sv) {
+                    result.seed = integer;
+                } else if (*key == "count"sv) {
+                    result.count = integer;
+                } else if (*key == "search_nodes"sv) {
+                    result.search_nodes = integer;
+                } else if (*key == "min_givens"sv || *key == "max_givens"sv) {
+                    (*key == "min_givens"sv ? result.min_givens : result.max_givens)
+                        = static_cast<unsigned>(std::min<unsigned long long>(integer, 81));
+                } else {
+                    return false;
+                }
+            }
+
+            if (*end != '\0') {
+                return false;
+            }
+        } while (consume(','));
+
+        return consume('}');
+    }
+
+    public:
+    explicit baseline_reader(std::string_view text) noexcept : m_text(text) {}
+
+    [[nodiscard]] auto read() -> std::optional<std::vector<corpus>> {
+        auto result = std::vector<corpus>();
+
+        if (!consume('{')) {
+            return std::nullopt;
+        }
+
+        auto const key = string();
+        if (key != "corpora"sv || !consume(':') || !consume('[')) {
+            return std::nullopt;
+        }
+
+        if (!consume(']')) {
+            do {
+                if (!consume('{') || !corpus_members(result.emplace_back())) {
+                    return std::nullopt;
+                }
+            } while (consume(','));
+
+            if (!consume(']')) {
+                return std::nullopt;
+            }
+        }
+
+        if (!consume('}')) {
+            return std::nullopt;
+        }
+
+        skip_space();
+        if (m_position != m_text.size()) {
+            return std::nullopt;
+        }
+
+        return result;
+    }
+};
+
+static auto read_baseline(std::string const& path) -> std::optional<std::vector<corpus>> {
+    auto file = std::ifstream(path);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    auto const text = std::string(std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+
+    return baseline_reader(text).read();
+}
+
+static auto write_baseline(std::string const& path, std::vector<corpus> const& corpora)
+    -> bool {
+
+    auto file = std::ofstream(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "{\n  \"corpora\": [";
+
+    for (std::size_t i = 0; i < corpora.size(); ++i) {
+        auto const& c = corpora[i];
+
+        file << fmt::format("{}\n    {{\n"
+                "      \"name\": \"{}\",\n"
+                "      \"seed\": {},\n"
+                "      \"count\": {},\n"
+                "      \"min_givens\": {},\n"
+                "      \"max_givens\": {},\n"
+                "      \"backend\": \"{}\",\n"
+                "      \"search_nodes\": {},\n"
+                "      \"normalized_throughput\": {:.6g}\n"
+                "    }}",
+                i == 0 ? "" : ",", c.name, c.seed, c.count, c.min_givens, c.max_givens,
+                c.engine, c.search_nodes, c.normalized_throughput);
+    }
+
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file.flush());
+}
+
+// Only the raw output of mt19937_64 is pinned down by the standard, the
+// distributions and std::shuffle aren't. Building the corpora from the raw
+// output alone gives the same puzzles, and with them the same node counts,
+// with every standard library.
+template <typename Random>
+static auto below(Random& random, unsigned bound) -> unsigned {
+    return static_cast<unsigned>(random() % bound);
+}
+
+template <typename Random, typename T, std::size_t N>
+static void shuffle(Random& random, std::array<T, N>& values) {
+    for (auto i = static_cast<unsigned>(N); i > 1; --i) {
+        std::swap(values[i - 1], values[below(random, i)]);
+    }
+}
+
+// The same kind of puzzles as sudoku_generate writes: a shuffled solution
+// grid with a random number of its givens left in.
+static auto generate_corpus(corpus const& c) -> std::vector<solve::sudoku> {
+    auto random = std::mt19937_64(c.seed);
+    auto result = std::vector<solve::sudoku>(c.count);
+
+    auto shuffled = [&random] {
+        auto order = std::array<unsigned, 9>();
+        auto groups = std::array<unsigned, 3>{0, 1, 2};
+        shuffle(random, groups);
+
+        for (unsigned group = 0; group < 3; ++group) {
+            auto within = std::array<unsigned, 3>{0, 1, 2};
+            shuffle(random, within);
+
+            for (unsigned i = 0; i < 3; ++i) {
+                order[3 * group + i] = 3 * groups[group] + within[i];
+            }
+        }
+
+        return order;
+    };
+
+    for (auto& s : result) {
+        auto digits = std::array<std::int8_t, 9>();
+        std::iota(digits.begin(), digits.end(), std::int8_t{1});
+        shuffle(random, digits);
+
+        auto const rows = shuffled();
+        auto const columns = shuffled();
+        auto const transpose = (random() & 1) != 0;
+
+        auto cells = std::array<unsigned, solve::sudoku::field_size>();
+        std::iota(cells.begin(), cells.end(), 0u);
+        shuffle(random, cells);
+
+        auto const givens = c.min_givens + below(random, c.max_givens - c.min_givens + 1);
+
+        s.data.fill(0);
+        for (unsigned k = 0; k < givens; ++k) {
+            auto const x = cells[k] % 9;
+            auto const y = cells[k] / 9;
+            auto const r = transpose ? columns[x] : rows[y];
+            auto const col = transpose ? rows[y] : columns[x];
+            s.data[cells[k]] = digits[(r * 3 + r / 3 + col) % 9];
+        }
+    }
+
+    return result;
+}
+
+// Keeps the calibration loop from being optimized away.
+static std::uint32_t volatile calibration_sink = 0;
+
+// Steps per second through a single random cycle over 256 KiB, the best of
+// `repeat` runs. Like the search, this is mostly dependent loads and a few
+// branches, so dividing by it cancels out most of the difference in clock
+// speed and cache latency between two machines.
+static auto calibrate(unsigned repeat) -> double {
+    constexpr auto size = std::size_t{1} << 16;
+    constexpr auto steps = std::uint64_t{1} << 24;
+
+    auto random = std::mt19937_64(1);
+    auto order = std::vector<std::uint32_t>(size);
+    std::iota(order.begin(), order.end(), 0u);
+
+    for (auto i = size; i > 1; --i) {
+        std::swap(order[i - 1], order[random() % i]);
+    }
+
+    auto next = std::vector<std::uint32_t>(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        next[order[i]] = order[(i + 1) % size];
+    }
+
+    auto best = 0.0;
+
+    for (unsigned run = 0; run < repeat; ++run) {
+        auto const start = std::chrono::steady_clock::now();
+        auto position = std::uint32_t{0};
+
+        for (std::uint64_t i = 0; i < steps; ++i) {
+            position = next[position];
+        }
+
+        auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        best = run == 0 ? seconds : std::min(best, seconds);
+        calibration_sink = position;
+    }
+
+    return best > 0 ? static_cast<double>(steps) / best : 0.0;
+}
+
+struct measurement {
+    std::uint64_t search_nodes = 0;
+    double puzzles_per_second = 0.0;
+    std::size_t solved = 0;
+    // Whether every repetition tried the same rows, as it should.
+    bool deterministic = true;
+};
+
+static auto measure(std::vector<solve::sudoku> const& puzzles, configuration const& config,
+        unsigned repeat) -> measurement {
+
+    auto solutions = std::vector<solve::sudoku>(puzzles.size());
+    auto arena = solve::solver_arena();
+    arena.reserve(1);
+
+    auto options = solve::batch_options();
+    options.thread_count = 1;
+    options.engine = config.engine;
+    options.lane_threshold = config.lanes ? 1 : 0;
+    options.arena = &arena;
+
+    auto result = measurement();
+    auto best = 0.0;
+
+    for (unsigned run = 0; run < repeat; ++run) {
+        auto const nodes = arena.context(0).search_nodes();
+        auto const start = std::chrono::steady_clock::now();
+        result.solved = solve::solve_batch(puzzles, solutions, options);
+        auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        auto const visited = arena.context(0).search_nodes() - nodes;
+
+        if (run == 0) {
+            result.search_nodes = visited;
+        } else if (visited != result.search_nodes) {
+            result.deterministic = false;
+        }
+
+        best = run == 0 ? seconds : std::min(best, seconds);
+    }
+
+    result.puzzles_per_second = best > 0 ? puzzles.size() / best : 0.0;
+    return result;
+}
+
+auto main(int argc, char const** argv) -> int {
+    auto const options = parse_arguments(argc, argv);
+
+    if (!options.has_value()) {
+        fmt::print(stderr, "{}", usage);
+        return 1;
+    }
+
+    auto const path = std::string(options->baseline);
+    auto corpora = read_baseline(path);
+
+    if (!corpora.has_value()) {
+        fmt::print(stderr, "Could not read the baseline from {}.\n", path);
+        return 1;
+    }
+
+    // Only timings need calibrating and the best of several runs. Node
+    // counts are the same every time, so two runs show whether they are.
+    auto const timed = options->check_throughput || options->write_baseline;
+    auto const repeat = options->repeat.value_or(timed ? 5 : 2);
+    auto const calibration = timed ? calibrate(repeat) : 0.0;
+
+    if (timed) {
+        fmt::print("calibration: {:.0f} steps/s\n", calibration);
+    }
+
+    auto failed = false;
+
+    for (auto& c : *corpora) {
+        auto const* config = find_configuration(c.engine);
+
+        if (config == nullptr || c.min_givens > c.max_givens) {
+            fmt::print(stderr, "Corpus {} is malformed.\n", c.name);
+            return 1;
+        }
+
+        auto const puzzles = generate_corpus(c);
+        auto const result = measure(puzzles, *config, repeat);
+        auto const normalized = calibration > 0
+            ? result.puzzles_per_second / calibration * 1e6 : 0.0;
+
+        fmt::print("{:<16} {:<14} {:>8} solved {:>12} nodes {:>10.0f} puzzles/s",
+                c.name, c.engine, result.solved, result.search_nodes,
+                result.puzzles_per_second);
+
+        if (timed) {
+            fmt::print(" {:>9.4f} normalized", normalized);
+        }
+
+        fmt::print("\n");
+
+        if (!result.deterministic) {
+            fmt::print("  FAIL: repetitions disagree on the number of search nodes\n");
+            failed = true;
+        }
+
+        if (options->write_baseline) {
+            c.search_nodes = result.search_nodes;
+            c.normalized_throughput = normalized;
+            continue;
+        }
+
+        if (result.search_nodes != c.search_nodes) {
+            fmt::print("  FAIL: {} search nodes, the baseline has {}\n",
+                    result.search_nodes, c.search_nodes);
+            failed = true;
+        }
+
+        if (options->check_throughput
+                && normalized < c.normalized_throughput * (1.0 - options->tolerance)) {
+
+            fmt::print("  FAIL: normalized throughput {:.4f} is {:.1f}% below the baseline "
+                    "{:.4f}\n", normalized,
+                    100.0 * (1.0 - normalized / c.normalized_throughput),
+                    c.normalized_throughput);
+            failed = true;
+        }
+    }
+
+    if (options->write_baseline) {
+        if (failed || !write_baseline(path, *corpora)) {
+            fmt::print(stderr, "Did not write the baseline to {}.\n", path);
+            return 1;
+        }
+
+        fmt::print("Wrote the baseline to {}.\n", path);
+        return 0;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+#include "hint.hpp"
+#include "lanes.hpp"
+#include "propagation.hpp"
+#include "solver.hpp"
+#include "test_helpers.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace solve;
+
+TEST_CASE("Unit tables") {
+    for (unsigned cell = 0; cell < sudoku::field_size; ++cell) {
+        for (auto unit : cell_units(cell)) {
+            auto const& cells = unit_cells(unit);
+            REQUIRE(std::count(cells.begin(), cells.end(), cell) == 1);
+        }
+
+        auto const& peers = cell_peers(cell);
+        REQUIRE(std::count(peers.begin(), peers.end(), cell) == 0);
+    }
+}
+
+TEST_CASE("Propagation tests") {
+    SECTION("Singles solve easy puzzles on their own") {
+        auto grid = candidate_grid(from_string("..3.2.6..9..3.5..1..18.64....81.29..7......."
+                    "8..67.82....26.95..8..2.3..9..5.1.3.."));
+
+        REQUIRE(propagate(grid) == propagation_result::solved);
+        REQUIRE(verify_sudoku(grid.values()));
+        REQUIRE(verify_sudoku(grid.candidates()));
+    }
+
+    SECTION("Hard puzzles are only partially filled in") {
+        auto const puzzle = from_string("8..........36......7..9.2...5...7.......457....."
+                    "1...3...1....68..85...1..9....4..");
+        auto grid = candidate_grid(puzzle);
+
+        REQUIRE(propagate(grid) == propagation_result::stuck);
+        REQUIRE(grid.unsolved() > 0);
+
+        auto const solution = solve_sudoku(puzzle);
+        for (std::size_t i = 0; i < sudoku::field_size; ++i) {
+            if (!grid.is_open(i)) {
+                REQUIRE(grid.values().data[i] == solution.data[i]);
+            } else {
+                REQUIRE((grid.candidates(i) & bitboard::digit_mask(solution.data[i])) != 0);
+            }
+        }
+    }
+
+    SECTION("Conflicting givens are detected") {
+        auto grid = candidate_grid(from_string("11..............................................."
+                    "................................"));
+
+        REQUIRE(grid.contradiction());
+        REQUIRE(propagate(grid) == propagation_result::contradiction);
+    }
+}
+
+TEST_CASE("Lane propagation") {
+    auto const easy = from_string("..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95"
+            "..8..2.3..9..5.1.3..");
+    auto const hard = from_string("8..........36......7..9.2...5...7.......457....."
+            "1...3...1....68..85...1..9....4..");
+    auto conflicting = sudoku{};
+    conflicting.data[0] = 1;
+    conflicting.data[1] = 1;
+    auto out_of_range = easy;
+    out_of_range.data[0] = 10;
+
+    // More puzzles than the lanes hold would trip an assertion, fewer leave
+    // some lanes idle.
+    auto const count = GENERATE(std::size_t{4}, std::size_t{lane_width});
+    auto puzzles = std::vector<sudoku>();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const& samples = std::array{easy, hard, conflicting, out_of_range, sudoku{}};
+        puzzles.push_back(samples[i % samples.size()]);
+    }
+
+    auto results = std::vector<sudoku>(count);
+    auto outcomes = std::vector<propagation_result>(count);
+    propagate_lanes(puzzles, results, outcomes);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto grid = candidate_grid(puzzles[i]);
+        auto const expected = propagate(grid);
+
+        if (expected == propagation_result::contradiction) {
+            REQUIRE(outcomes[i] == propagation_result::contradiction);
+            continue;
+        }
+
+        // Without locked candidates, the lanes may get stuck where propagate
+        // doesn't, but never the other way around, and never disagree.
+        REQUIRE(outcomes[i] != propagation_result::contradiction);
+        REQUIRE((outcomes[i] == propagation_result::stuck
+                    || expected == propagation_result::solved));
+
+        for (std::size_t cell = 0; cell < sudoku::field_size; ++cell) {
+            if (results[i].data[cell] != sudoku::empty_field) {
+                REQUIRE(results[i].data[cell] == grid.values().data[cell]);
+            }
+        }
+    }
+
+    REQUIRE(outcomes[0] == propagation_result::solved);
+    REQUIRE(verify_sudoku(results[0]));
+}
+
+TEST_CASE("Hint tests") {
+    auto const solved = from_string("4173698256321589479587243168254371697915864323469127582896435715"
+            "73291684164875293");
+
+    SECTION("A single missing cell is a naked single") {
+        auto puzzle = solved;
+        puzzle.data[40] = sudoku::empty_field;
+
+        auto const h = next_hint(puzzle);
+        REQUIRE(h.has_value());
+        REQUIRE(h->x == 4);
+        REQUIRE(h->y == 4);
+        REQUIRE(h->value == solved.data[40]);
+        REQUIRE(h->reason == technique::naked_single);
+    }
+
+    SECTION("Following hints solves a puzzle") {
+        auto puzzle = from_string("8..........36......7..9.2...5...7.......457....."
+                    "1...3...1....68..85...1..9....4..");
+        auto const solution = solve_sudoku(puzzle);
+        auto used_search = false;
+
+        for (auto h = next_hint(puzzle); h.has_value(); h = next_hint(puzzle)) {
+            REQUIRE(puzzle.data[h->x + 9 * h->y] == sudoku::empty_field);
+            REQUIRE(h->value == solution.data[h->x + 9 * h->y]);
+
+            used_search = used_search || h->reason == technique::search;
+            puzzle.data[h->x + 9 * h->y] = h->value;
+        }
+
+        REQUIRE(used_search);
+        REQUIRE(puzzle.data == solution.data);
+    }
+
+    SECTION("Full and broken grids get no hint") {
+        REQUIRE_FALSE(next_hint(solved).has_value());
+
+        auto broken = solved;
+        broken.data[0] = broken.data[1];
+        broken.data[2] = sudoku::empty_field;
+        REQUIRE_FALSE(next_hint(broken).has_value());
+    }
+}
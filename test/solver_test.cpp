@@ -1,7 +1,19 @@
+#include "affinity.hpp"
+#include "batch.hpp"
+#include "exact_cover.hpp"
+#include "incremental.hpp"
+#include "session.hpp"
 #include "solver.hpp"
+#include "ssolve.h"
+#include "test_helpers.hpp"
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
 using namespace solve;
 
 TEST_CASE("Solver tests") {
@@ -9,4 +21,502 @@ TEST_CASE("Solver tests") {
     auto solve_result = solve_sudoku(empty);
 
     REQUIRE(verify_sudoku(solve_result));
+
+    auto context = solver_context();
+    auto const puzzle = from_string("4.....8.5.3..........7......2.....6.....8.4......1......."
+            "6.3.7.5..2.....1.4......");
+    auto const solution = context.solve(puzzle, backend::dancing_links);
+
+    REQUIRE(verify_sudoku(solution));
+    REQUIRE(context.solve(puzzle, backend::hybrid).data == solution.data);
+}
+
+TEST_CASE("Solution enumeration") {
+    auto const solved = from_string("4173698256321589479587243168254371697915864323469127582896435715"
+            "73291684164875293");
+
+    SECTION("Every solution is found exactly once") {
+        auto puzzle = solved;
+        std::fill(puzzle.data.begin(), puzzle.data.begin() + 27, sudoku::empty_field);
+
+        auto solutions = std::vector<sudoku>();
+        for (auto const& solution : solution_range(puzzle)) {
+            REQUIRE(verify_sudoku(solution));
+            REQUIRE(std::equal(solution.data.begin() + 27, solution.data.end(),
+                        solved.data.begin() + 27));
+            solutions.push_back(solution);
+        }
+
+        REQUIRE(solutions.size() == 156);
+
+        std::sort(solutions.begin(), solutions.end(), [] (auto const& a, auto const& b) {
+            return a.data < b.data;
+        });
+        REQUIRE(std::adjacent_find(solutions.begin(), solutions.end(),
+                    [] (auto const& a, auto const& b) {
+                        return a.data == b.data;
+                    }) == solutions.end());
+    }
+
+    SECTION("Unique and solved puzzles yield a single solution") {
+        auto range = solution_range(solved);
+        REQUIRE(std::distance(range.begin(), range.end()) == 1);
+    }
+
+    SECTION("Conflicting puzzles yield nothing") {
+        auto puzzle = solved;
+        puzzle.data[1] = puzzle.data[0];
+        puzzle.data[5] = sudoku::empty_field;
+
+        auto range = solution_range(puzzle);
+        REQUIRE(range.begin() == range.end());
+    }
+
+    SECTION("Enumeration can stop early") {
+        auto count = 0;
+        for (auto const& solution : solution_range(sudoku{})) {
+            REQUIRE(verify_sudoku(solution));
+
+            if (++count == 1000) {
+                break;
+            }
+        }
+
+        REQUIRE(count == 1000);
+    }
+}
+
+// incremental_solver and solver_session answer the same queries, one with
+// a matrix of its own and the other with the one its thread shares.
+TEMPLATE_TEST_CASE("Incremental solving", "", incremental_solver, solver_session) {
+    auto const solved = from_string("4173698256321589479587243168254371697915864323469127582896435715"
+            "73291684164875293");
+
+    auto puzzle = solved;
+    std::fill(puzzle.data.begin(), puzzle.data.begin() + 27, sudoku::empty_field);
+
+    auto solver = TestType(puzzle);
+    REQUIRE(solver.grid().data == puzzle.data);
+    REQUIRE(solver.count_solutions(1000) == 156);
+
+    SECTION("Queries leave the matrix untouched") {
+        REQUIRE(solver.is_solvable());
+        REQUIRE_FALSE(solver.has_unique_solution());
+        REQUIRE(solver.count_solutions(1000) == 156);
+    }
+
+    SECTION("Edits narrow down and widen the solution space") {
+        for (unsigned i = 0; i < 18; ++i) {
+            REQUIRE(solver.set_cell(i % 9, i / 9, solved.data[i]));
+        }
+
+        REQUIRE(solver.has_unique_solution());
+        REQUIRE(solver.solution()->data == solved.data);
+
+        // Not the most recent edit, so this has to peel off the ones above.
+        solver.clear_cell(3, 0);
+        REQUIRE(solver.grid().data[3] == sudoku::empty_field);
+        REQUIRE(solver.has_unique_solution());
+
+        for (unsigned i = 0; i < 18; ++i) {
+            solver.clear_cell(i % 9, i / 9);
+        }
+
+        REQUIRE(solver.grid().data == puzzle.data);
+        REQUIRE(solver.count_solutions(1000) == 156);
+    }
+
+    SECTION("Conflicting edits are rejected") {
+        REQUIRE(solver.set_cell(0, 0, 4));
+        REQUIRE_FALSE(solver.set_cell(1, 0, 4));
+        REQUIRE_FALSE(solver.set_cell(0, 0, solved.data[27]));
+        REQUIRE(solver.grid().data[0] == 4);
+
+        // Replacing a digit frees it up again.
+        REQUIRE(solver.set_cell(0, 0, 6));
+        REQUIRE(solver.set_cell(0, 1, 4));
+
+        solver.clear_cell(0, 0);
+        solver.clear_cell(0, 1);
+        REQUIRE(solver.count_solutions(1000) == 156);
+    }
+
+    SECTION("Dead ends are recognized") {
+        auto empty = TestType();
+
+        for (unsigned x = 0; x < 8; ++x) {
+            REQUIRE(empty.set_cell(x, 0, static_cast<std::int8_t>(x + 1)));
+        }
+
+        REQUIRE(empty.set_cell(8, 1, 9));
+        REQUIRE_FALSE(empty.is_solvable());
+        REQUIRE_FALSE(empty.solution().has_value());
+
+        empty.clear_cell(8, 1);
+        REQUIRE(empty.is_solvable());
+    }
+}
+
+TEST_CASE("Solver sessions") {
+    auto const solved = from_string("4173698256321589479587243168254371697915864323469127582896435715"
+            "73291684164875293");
+
+    auto puzzle = solved;
+    std::fill(puzzle.data.begin(), puzzle.data.begin() + 27, sudoku::empty_field);
+
+    // Tens of thousands of these have to fit into a few megabytes.
+    REQUIRE(sizeof(solver_session) <= 256);
+
+    auto session = solver_session(puzzle);
+
+    SECTION("Sessions share the thread's matrix without interfering") {
+        auto other = solver_session();
+        REQUIRE(other.set_cell(0, 0, 4));
+        REQUIRE(other.is_solvable());
+        REQUIRE_FALSE(other.has_unique_solution());
+
+        REQUIRE(session.count_solutions(1000) == 156);
+        REQUIRE(verify_sudoku(*session.solution()));
+    }
+
+    SECTION("Candidates follow the edits") {
+        REQUIRE(session.set_cell(0, 0, 4));
+        REQUIRE(session.candidates(0, 0) & bitboard::digit_mask(4));
+        REQUIRE_FALSE(session.candidates(0, 1) & bitboard::digit_mask(4));
+
+        REQUIRE(session.set_cell(0, 0, 6));
+        REQUIRE(session.candidates(0, 1) & bitboard::digit_mask(4));
+
+        session.clear_cell(0, 0);
+        REQUIRE(session.candidates(0, 0) & bitboard::digit_mask(6));
+    }
+}
+
+struct queens_shape {
+    static constexpr int primary_columns = 16;
+    static constexpr int secondary_columns = 30;
+    static constexpr int rows = 64;
+    static constexpr int nodes = 4 * 64;
+};
+
+TEST_CASE("Exact cover") {
+    SECTION("Runtime sized matrices find the only cover") {
+        auto const rows = std::vector<std::vector<int>>{
+            {2, 4, 5}, {0, 3, 6}, {1, 2, 5}, {0, 3}, {1, 6}, {3, 4, 6}
+        };
+
+        auto matrix = exact_cover<>(7, 0, rows);
+        REQUIRE(matrix.row_count() == 6);
+
+        auto solution = matrix.solve();
+        std::sort(solution.begin(), solution.end());
+        REQUIRE(solution == std::vector<int>{0, 3, 4});
+
+        matrix.reset();
+        matrix.cover_row(1);
+        REQUIRE_FALSE(matrix.row_available(3));
+        REQUIRE(matrix.solve().empty());
+    }
+
+    SECTION("Secondary columns may stay uncovered") {
+        // Eight queens: ranks and files are primary, diagonals secondary.
+        auto rows = std::vector<std::array<int, 4>>();
+        for (int rank = 0; rank < 8; ++rank) {
+            for (int file = 0; file < 8; ++file) {
+                rows.push_back({rank, 8 + file, 16 + rank + file, 31 + rank - file + 7});
+            }
+        }
+
+        auto matrix = exact_cover<queens_shape>(rows);
+        auto cursor = cover_matrix::solution_cursor(matrix);
+        auto count = 0;
+        auto indices = std::vector<int>();
+
+        while (cursor.next()) {
+            indices.clear();
+            cursor.current(indices);
+            REQUIRE(indices.size() == 8);
+            ++count;
+        }
+
+        REQUIRE(count == 92);
+    }
+
+    SECTION("Searches count the rows they try") {
+        auto const rows = std::vector<std::vector<int>>{
+            {0, 1}, {0}, {1}, {2}
+        };
+
+        auto matrix = exact_cover<>(3, 0, rows);
+        REQUIRE(matrix.nodes_visited() == 0);
+
+        REQUIRE_FALSE(matrix.solve().empty());
+        auto const first = matrix.nodes_visited();
+        REQUIRE(first > 0);
+
+        matrix.reset();
+        REQUIRE_FALSE(matrix.solve().empty());
+        REQUIRE(matrix.nodes_visited() == 2 * first);
+
+        auto context = solver_context();
+        auto const solution = context.solve(sudoku{}, backend::dancing_links);
+        REQUIRE(verify_sudoku(solution));
+        REQUIRE(context.search_nodes() > 0);
+    }
+}
+
+TEST_CASE("Variant solving") {
+    auto const variant = GENERATE(puzzle_variant::x, puzzle_variant::windoku,
+            puzzle_variant::anti_knight);
+    auto context = solver_context();
+
+    auto const solution = context.solve(sudoku{}, backend::dancing_links, variant);
+    REQUIRE(verify_sudoku(solution, variant));
+
+    SECTION("Holes are filled in under the same rules") {
+        auto puzzle = solution;
+        for (std::size_t i = 0; i < sudoku::field_size; i += 2) {
+            puzzle.data[i] = sudoku::empty_field;
+        }
+
+        for (auto engine : {backend::dancing_links, backend::hybrid}) {
+            auto const result = context.solve(puzzle, engine, variant);
+            REQUIRE(verify_sudoku(result, variant));
+
+            for (std::size_t i = 1; i < sudoku::field_size; i += 2) {
+                REQUIRE(result.data[i] == solution.data[i]);
+            }
+        }
+    }
+
+    SECTION("Classic grids breaking the extra rules are rejected") {
+        auto const classic = from_string("41736982563215894795872431682543716979158643234691275828964"
+                "3571573291684164875293");
+        REQUIRE_FALSE(verify_sudoku(classic, variant));
+
+        // Singles fill this back in, which the variant rules don't allow.
+        auto puzzle = classic;
+        puzzle.data[0] = sudoku::empty_field;
+        auto status = std::vector<puzzle_status>(1);
+        auto solutions = std::vector<sudoku>(1);
+        auto options = batch_options();
+        options.variant = variant;
+        options.status = status;
+
+        REQUIRE(solve_batch(util::span(&puzzle, 1), solutions, options) == 0);
+        REQUIRE(status[0] == puzzle_status::unsolvable);
+        REQUIRE(verify_sudoku(solutions[0]));
+    }
+
+    SECTION("Conflicting givens leave the matrix usable") {
+        auto puzzle = sudoku{};
+        auto const& [a, b] = knight_edges[0];
+        auto const cells = variant == puzzle_variant::anti_knight ? std::array{a, b}
+            : variant == puzzle_variant::x ? std::array<std::uint8_t, 2>{0, 80}
+            : std::array<std::uint8_t, 2>{10, 30};
+        puzzle.data[cells[0]] = 5;
+        puzzle.data[cells[1]] = 5;
+
+        REQUIRE_FALSE(verify_sudoku(context.solve(puzzle, backend::dancing_links, variant),
+                    variant));
+        REQUIRE(context.solve(sudoku{}, backend::dancing_links, variant).data
+                == solution.data);
+    }
+
+    REQUIRE(parse_variant(variant_name(variant)) == variant);
+}
+
+TEST_CASE("C API") {
+    auto* context = static_cast<ssolve_context*>(nullptr);
+    auto options = ssolve_options();
+    ssolve_default_options(&options);
+    REQUIRE(ssolve_context_create(&options, &context) == SSOLVE_OK);
+
+    auto const puzzle = std::string("4.....8.5.3..........7......2.....6.....8.4......1......."
+            "6.3.7.5..2.....1.4......");
+    auto const solution = std::string("4173698256321589479587243168254371697915864323469127582896"
+            "43571573291684164875293");
+
+    SECTION("Single puzzles in both formats") {
+        auto text = std::string(81, ' ');
+        REQUIRE(ssolve_solve(context, SSOLVE_FORMAT_TEXT, puzzle.data(), text.data())
+                == SSOLVE_OK);
+        REQUIRE(text == solution);
+
+        auto packed = std::array<unsigned char, 41>();
+        auto packed_solution = std::array<unsigned char, 41>();
+        for (std::size_t i = 0; i < puzzle.size(); ++i) {
+            auto const value = puzzle[i] == '.' ? 0 : puzzle[i] - '0';
+            packed[i / 2] |= static_cast<unsigned char>(i % 2 == 0 ? value : value << 4);
+        }
+
+        REQUIRE(ssolve_solve(context, SSOLVE_FORMAT_PACKED, packed.data(),
+                    packed_solution.data()) == SSOLVE_OK);
+        REQUIRE((packed_solution[0] & 0xf) == 4);
+        REQUIRE((packed_solution[40] & 0xf) == 3);
+
+        auto count = std::uint64_t{0};
+        REQUIRE(ssolve_count_solutions(context, SSOLVE_FORMAT_TEXT, puzzle.data(), 2, &count)
+                == SSOLVE_OK);
+        REQUIRE(count == 1);
+    }
+
+    SECTION("Batches report each puzzle's outcome") {
+        auto broken = puzzle;
+        broken[1] = '4';
+        auto garbage = puzzle;
+        garbage[2] = 'x';
+
+        auto lines = puzzle + "\n" + broken + "\n" + garbage + "\n";
+        auto errors = std::array<ssolve_error, 3>();
+        auto solved = std::size_t{0};
+
+        REQUIRE(ssolve_solve_batch(context, SSOLVE_FORMAT_TEXT, lines.data(), 82, 3,
+                    lines.data(), 82, errors.data(), &solved) == SSOLVE_INVALID_PUZZLE);
+        REQUIRE(solved == 1);
+        REQUIRE(errors == std::array{SSOLVE_OK, SSOLVE_UNSOLVABLE, SSOLVE_INVALID_PUZZLE});
+        REQUIRE(lines.substr(0, 82) == solution + "\n");
+        REQUIRE(lines.substr(164) == garbage + "\n");
+    }
+
+    SECTION("Bad arguments are rejected") {
+        auto out = std::string(81, ' ');
+        REQUIRE(ssolve_solve(context, static_cast<ssolve_format>(7), puzzle.data(), out.data())
+                == SSOLVE_INVALID_ARGUMENT);
+        REQUIRE(ssolve_solve_batch(context, SSOLVE_FORMAT_TEXT, puzzle.data(), 80, 1,
+                    out.data(), 81, nullptr, nullptr) == SSOLVE_INVALID_ARGUMENT);
+
+        options.variant = static_cast<ssolve_variant>(9);
+        auto* other = static_cast<ssolve_context*>(nullptr);
+        REQUIRE(ssolve_context_create(&options, &other) == SSOLVE_INVALID_ARGUMENT);
+        REQUIRE(other == nullptr);
+    }
+
+    ssolve_context_destroy(context);
+}
+
+TEST_CASE("Verification tests") {
+    auto solved = from_string("4173698256321589479587243168254371697915864323469127582896435715"
+            "73291684164875293");
+
+    REQUIRE(verify_sudoku(solved));
+    REQUIRE(verify_sudoku(bitboard(solved)));
+
+    SECTION("Swapped cells break columns and blocks") {
+        std::swap(solved.data[0], solved.data[1]);
+        REQUIRE_FALSE(verify_sudoku(solved));
+    }
+
+    SECTION("Swapped rows break blocks only") {
+        std::swap_ranges(solved.data.begin(), solved.data.begin() + 9,
+                solved.data.begin() + 27);
+        REQUIRE_FALSE(verify_sudoku(solved));
+    }
+
+    SECTION("Swapped bands keep the sudoku valid") {
+        std::swap_ranges(solved.data.begin(), solved.data.begin() + 27,
+                solved.data.begin() + 27);
+        REQUIRE(verify_sudoku(solved));
+    }
+
+    SECTION("Empty and out of range cells are rejected") {
+        solved.data[80] = sudoku::empty_field;
+        REQUIRE_FALSE(verify_sudoku(solved));
+
+        solved.data[80] = 10;
+        REQUIRE_FALSE(verify_sudoku(solved));
+    }
+}
+
+TEST_CASE("Batch tests") {
+    auto puzzles = std::vector<sudoku>{
+        from_string("4.....8.5.3..........7......2.....6.....8.4......1......."
+                    "6.3.7.5..2.....1.4......"),
+        sudoku{},
+        from_string("12345678.........9..............................................."
+                    "................"),
+        from_string("..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95"
+                    "..8..2.3..9..5.1.3.."),
+        from_string("11..............................................................."
+                    "................")
+    };
+
+    auto solutions = std::vector<sudoku>(puzzles.size());
+    auto status = std::vector<puzzle_status>(puzzles.size());
+
+    auto options = batch_options{};
+    options.thread_count = 3;
+    options.status = status;
+
+    auto solved = solve_batch(puzzles, solutions, options);
+
+    REQUIRE(solved == 3);
+    REQUIRE(status == std::vector<puzzle_status>{puzzle_status::ok, puzzle_status::ok,
+            puzzle_status::unsolvable, puzzle_status::ok, puzzle_status::unsolvable});
+
+    for (std::size_t i = 0; i < puzzles.size(); ++i) {
+        if (status[i] != puzzle_status::ok) {
+            continue;
+        }
+
+        for (std::size_t j = 0; j < sudoku::field_size; ++j) {
+            if (puzzles[i].data[j] != sudoku::empty_field) {
+                REQUIRE(puzzles[i].data[j] == solutions[i].data[j]);
+            }
+        }
+    }
+
+    auto static_status = std::vector<puzzle_status>(puzzles.size());
+    auto static_solutions = std::vector<sudoku>(puzzles.size());
+    options.schedule_by_difficulty = false;
+    options.status = static_status;
+
+    REQUIRE(solve_batch(puzzles, static_solutions, options) == 3);
+    REQUIRE(static_status == status);
+
+    // Pinned workers reusing their contexts across batches.
+    auto const cpus = allowed_cpus();
+    auto arena = solver_arena();
+    auto pinned_solutions = std::vector<sudoku>(puzzles.size());
+    auto pinned_options = batch_options{};
+    pinned_options.cpus = cpus;
+    pinned_options.arena = &arena;
+
+    for (int run = 0; run < 2; ++run) {
+        REQUIRE(solve_batch(puzzles, pinned_solutions, pinned_options) == 3);
+        for (std::size_t i = 0; i < puzzles.size(); ++i) {
+            REQUIRE(pinned_solutions[i].data == static_solutions[i].data);
+        }
+
+        // The calling thread may run anywhere it could before.
+        REQUIRE(allowed_cpus() == cpus);
+    }
+
+    // The same puzzles propagated in SIMD lanes, in both schedules.
+    for (auto by_difficulty : {false, true}) {
+        auto lane_status = std::vector<puzzle_status>(puzzles.size());
+        auto lane_solutions = std::vector<sudoku>(puzzles.size());
+        options.schedule_by_difficulty = by_difficulty;
+        options.lane_threshold = 1;
+        options.status = lane_status;
+
+        REQUIRE(solve_batch(puzzles, lane_solutions, options) == 3);
+        REQUIRE(lane_status == status);
+        for (std::size_t i = 0; i < puzzles.size(); ++i) {
+            REQUIRE(lane_solutions[i].data == static_solutions[i].data);
+        }
+    }
+
+    options.status = status;
+    solutions[1].data[0] = sudoku::empty_field;
+    REQUIRE(verify_batch(solutions, options) == 2);
+    REQUIRE(status[1] == puzzle_status::invalid);
+
+    REQUIRE(verify_solutions(puzzles, solutions, options) == 2);
+    REQUIRE(status[0] == puzzle_status::ok);
+
+    // Valid sudokus, but each one drops the givens of the other puzzle.
+    std::swap(solutions[0], solutions[3]);
+    REQUIRE(verify_solutions(puzzles, solutions, options) == 0);
+    REQUIRE(status[0] == puzzle_status::invalid);
 }
@@ -0,0 +1,22 @@
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+#include "data.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+// Builds a grid from 81 characters, '.' for empty cells, without the error
+// handling parse_sudoku needs for real input.
+inline auto from_string(std::string_view str) -> solve::sudoku {
+    auto result = solve::sudoku{};
+
+    for (std::size_t i = 0; i < solve::sudoku::field_size; ++i) {
+        result.data[i] = str[i] == '.' ? solve::sudoku::empty_field
+            : static_cast<std::int8_t>(str[i] - '0');
+    }
+
+    return result;
+}
+
+#endif // TEST_HELPERS_HPP